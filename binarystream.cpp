@@ -0,0 +1,294 @@
+#include <fstream>
+
+#include "binarystream.h"
+#include "logging.h"
+
+/*!
+ */
+uint64_t fnv1aHash(const void *data, size_t size, uint64_t hash)
+{
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/*!
+ */
+void BinaryWriter::writeRaw(const void *data, size_t size)
+{
+    const char *bytes = static_cast<const char*>(data);
+    _buffer.insert(_buffer.end(), bytes, bytes + size);
+}
+
+/*!
+ */
+void BinaryWriter::write(const std::string &value)
+{
+    write(static_cast<uint64_t>(value.size()));
+    writeRaw(value.data(), value.size());
+}
+
+/*!
+ */
+void BinaryWriter::write(std::chrono::sys_days value)
+{
+    write(static_cast<int32_t>(value.time_since_epoch().count()));
+}
+
+/*!
+ */
+void BinaryWriter::write(const std::chrono::year_month_day &value)
+{
+    write(static_cast<int16_t>(static_cast<int>(value.year())));
+    write(static_cast<uint8_t>(static_cast<unsigned>(value.month())));
+    write(static_cast<uint8_t>(static_cast<unsigned>(value.day())));
+}
+
+/*!
+ */
+void BinaryWriter::write(const std::vector<bool> &values)
+{
+    write(static_cast<uint64_t>(values.size()));
+    for (bool value : values)
+    {
+        write(static_cast<uint8_t>(value ? 1 : 0));
+    }
+}
+
+/*!
+ */
+void BinaryWriter::align(size_t alignment)
+{
+    _buffer.resize((_buffer.size() + alignment - 1) / alignment * alignment, 0);
+}
+
+/*!
+ */
+const std::vector<char>& BinaryWriter::buffer() const
+{
+    return _buffer;
+}
+
+/*!
+ */
+bool BinaryWriter::saveToFile(const std::filesystem::path &file, const char (&magic)[8], uint32_t version) const
+{
+    std::filesystem::path temporaryFile = file;
+    temporaryFile += ".tmp";
+
+    {
+        std::ofstream stream(temporaryFile, std::ios::binary | std::ios::trunc);
+        if (!stream)
+        {
+            Log::error() << "Unable to open '" << temporaryFile.string() << "' for writing.";
+            return false;
+        }
+
+        uint64_t checksum = fnv1aHash(_buffer.data(), _buffer.size());
+        uint32_t reserved = 0;
+
+        stream.write(magic, sizeof(magic));
+        stream.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        stream.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+        stream.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        stream.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+        if (!stream)
+        {
+            Log::error() << "Unable to write '" << temporaryFile.string() << "'.";
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryFile, file, error);
+    if (error)
+    {
+        Log::error() << "Unable to rename '" << temporaryFile.string() << "' to '" << file.string() << "': " << error.message();
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+ */
+BinaryReader::BinaryReader(const char *data, size_t size) :
+    _data(data),
+    _size(size)
+{
+}
+
+/*!
+ */
+BinaryReader::BinaryReader(const std::vector<char> &data) :
+    _data(data.data()),
+    _size(data.size())
+{
+}
+
+/*!
+ */
+std::optional<std::vector<char>> BinaryReader::loadFile(const std::filesystem::path &file, const char (&magic)[8], uint32_t version)
+{
+    std::ifstream stream(file, std::ios::binary);
+    if (!stream)
+    {
+        Log::warning() << "Unable to open '" << file.string() << "'.";
+        return std::nullopt;
+    }
+
+    std::vector<char> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    if (!checkHeader(data.data(), data.size(), file, magic, version))
+    {
+        return std::nullopt;
+    }
+
+    data.erase(data.begin(), data.begin() + headerSize);
+
+    return data;
+}
+
+/*!
+ */
+bool BinaryReader::checkHeader(const char *data, size_t size, const std::filesystem::path &file, const char (&magic)[8], uint32_t version)
+{
+    if (size < headerSize || std::memcmp(data, magic, sizeof(magic)) != 0)
+    {
+        Log::warning() << "'" << file.string() << "' has an unknown format.";
+        return false;
+    }
+
+    uint32_t fileVersion = 0;
+    uint64_t checksum = 0;
+    std::memcpy(&fileVersion, data + sizeof(magic), sizeof(fileVersion));
+    std::memcpy(&checksum, data + headerSize - sizeof(checksum), sizeof(checksum));
+
+    if (fileVersion != version)
+    {
+        Log::warning() << "'" << file.string() << "' has version " << fileVersion << ", expected " << version << ".";
+        return false;
+    }
+
+    if (checksum != fnv1aHash(data + headerSize, size - headerSize))
+    {
+        Log::warning() << "'" << file.string() << "' is corrupted.";
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+ */
+bool BinaryReader::ok() const
+{
+    return !_failed;
+}
+
+/*!
+ */
+bool BinaryReader::atEnd() const
+{
+    return _position == _size;
+}
+
+/*!
+ */
+size_t BinaryReader::position() const
+{
+    return _position;
+}
+
+/*!
+ */
+void BinaryReader::align(size_t alignment)
+{
+    size_t padding = (alignment - _position % alignment) % alignment;
+    if (require(padding))
+    {
+        _position += padding;
+    }
+}
+
+/*!
+ */
+bool BinaryReader::require(size_t bytes)
+{
+    if (_failed || _size - _position < bytes)
+    {
+        _failed = true;
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+ */
+uint64_t BinaryReader::readCount()
+{
+    uint64_t count = 0;
+    read(count);
+
+    if (count > _size - _position)
+    {
+        _failed = true;
+        return 0;
+    }
+
+    return count;
+}
+
+/*!
+ */
+void BinaryReader::read(std::string &value)
+{
+    uint64_t size = readCount();
+    value.assign(_data + _position, _data + _position + size);
+    _position += size;
+}
+
+/*!
+ */
+void BinaryReader::read(std::chrono::sys_days &value)
+{
+    int32_t days = 0;
+    read(days);
+    value = std::chrono::sys_days{std::chrono::days{days}};
+}
+
+/*!
+ */
+void BinaryReader::read(std::chrono::year_month_day &value)
+{
+    int16_t year = 0;
+    uint8_t month = 0;
+    uint8_t day = 0;
+    read(year);
+    read(month);
+    read(day);
+    value = std::chrono::year_month_day{std::chrono::year{year}, std::chrono::month{month}, std::chrono::day{day}};
+}
+
+/*!
+ */
+void BinaryReader::read(std::vector<bool> &values)
+{
+    values.clear();
+    uint64_t count = readCount();
+    values.reserve(count);
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        uint8_t value = 0;
+        read(value);
+        values.push_back(value != 0);
+    }
+}
@@ -0,0 +1,347 @@
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <set>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//! FNV-1a hash over raw bytes. Used to detect corrupted or outdated binary files.
+extern uint64_t fnv1aHash(const void *data, size_t size, uint64_t hash = 14695981039346656037ULL);
+
+/*!
+ * Writes values into a plain byte buffer. Values are stored in host byte order, so the
+ * resulting files are meant to be read on the same platform only. Classes can take
+ * part by implementing writeState(BinaryWriter&).
+ */
+class BinaryWriter
+{
+public:
+    //! Alignment of blocks written by writeArray(). Sufficient for all plain values.
+    static const size_t alignment = 8;
+
+    //! Write an arithmetic value or an enum.
+    template<typename T> requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+    void write(T value)
+    {
+        const char *bytes = reinterpret_cast<const char*>(&value);
+        _buffer.insert(_buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    //! Write raw bytes without any size information.
+    void writeRaw(const void *data, size_t size);
+
+    //! Write a string (length followed by the characters).
+    void write(const std::string &value);
+
+    //! Write a date as number of days since 1/1/1970.
+    void write(std::chrono::sys_days value);
+
+    //! Write a date field by field. Invalid dates (used as "not set") survive a round trip.
+    void write(const std::chrono::year_month_day &value);
+
+    //! Write a vector of bools.
+    void write(const std::vector<bool> &values);
+
+    //! Write a class which knows how to write itself.
+    template<typename T> requires requires(const T &t, BinaryWriter &w) { t.writeState(w); }
+    void write(const T &value)
+    {
+        value.writeState(*this);
+    }
+
+    template<typename A, typename B>
+    void write(const std::pair<A, B> &value)
+    {
+        write(value.first);
+        write(value.second);
+    }
+
+    template<typename T, size_t N>
+    void write(const std::array<T, N> &values)
+    {
+        for (const T &value : values)
+        {
+            write(value);
+        }
+    }
+
+    template<typename T>
+    void write(const std::optional<T> &value)
+    {
+        write(value.has_value());
+        if (value.has_value())
+        {
+            write(*value);
+        }
+    }
+
+    template<typename T>
+    void write(const std::vector<T> &values)
+    {
+        write(static_cast<uint64_t>(values.size()));
+        for (const T &value : values)
+        {
+            write(value);
+        }
+    }
+
+    template<typename T, typename C>
+    void write(const std::set<T, C> &values)
+    {
+        write(static_cast<uint64_t>(values.size()));
+        for (const T &value : values)
+        {
+            write(value);
+        }
+    }
+
+    template<typename T, typename C>
+    void write(const std::multiset<T, C> &values)
+    {
+        write(static_cast<uint64_t>(values.size()));
+        for (const T &value : values)
+        {
+            write(value);
+        }
+    }
+
+    template<typename K, typename V, typename C>
+    void write(const std::map<K, V, C> &values)
+    {
+        write(static_cast<uint64_t>(values.size()));
+        for (const auto &[key, value] : values)
+        {
+            write(key);
+            write(value);
+        }
+    }
+
+    //! Write a vector of plain values as one block (count, padding, raw values). Can be read
+    //! back without copying by BinaryReader::readArray().
+    template<typename T> requires std::is_trivially_copyable_v<T>
+    void writeArray(const std::vector<T> &values)
+    {
+        write(static_cast<uint64_t>(values.size()));
+        align(alignment);
+        writeRaw(values.data(), values.size() * sizeof(T));
+    }
+
+    //! Pad with zeros until the size of the buffer is a multiple of the given alignment.
+    void align(size_t alignment);
+
+    //! Get the bytes written so far.
+    const std::vector<char>& buffer() const;
+
+    //! Write the buffer to the given file, preceded by a header with the magic, the format version
+    //! and a checksum. A temporary file is written first and renamed afterwards, so an existing
+    //! file is never left half-written.
+    bool saveToFile(const std::filesystem::path &file, const char (&magic)[8], uint32_t version) const;
+
+private:
+    //! The serialized data.
+    std::vector<char> _buffer;
+
+}; // class BinaryWriter
+
+/*!
+ * Counterpart of BinaryWriter. Reading past the end of the data does not throw, but marks
+ * the reader as failed. Check ok() after reading.
+ */
+class BinaryReader
+{
+public:
+    //! Constructor. The data must outlive the reader.
+    BinaryReader(const char *data, size_t size);
+
+    //! Constructor. The data must outlive the reader.
+    BinaryReader(const std::vector<char> &data);
+
+    //! Size of the header written by BinaryWriter::saveToFile(). Keeps the data behind it aligned.
+    static const size_t headerSize = 24;
+
+    //! Load a file written by BinaryWriter::saveToFile(). Checks magic, version and checksum and
+    //! returns the data without the header. Logs a warning and returns nothing on failure.
+    static std::optional<std::vector<char>> loadFile(const std::filesystem::path &file, const char (&magic)[8], uint32_t version);
+
+    //! Check magic, version and checksum of the complete content of a file written by
+    //! BinaryWriter::saveToFile(). The data starts at headerSize. Logs a warning on failure.
+    static bool checkHeader(const char *data, size_t size, const std::filesystem::path &file, const char (&magic)[8], uint32_t version);
+
+    //! False if any read went past the end of the data.
+    bool ok() const;
+
+    //! Check if all data has been consumed.
+    bool atEnd() const;
+
+    //! Current read position.
+    size_t position() const;
+
+    //! Read an arithmetic value or an enum.
+    template<typename T> requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+    void read(T &value)
+    {
+        if (!require(sizeof(T)))
+        {
+            value = T{};
+            return;
+        }
+
+        std::memcpy(&value, _data + _position, sizeof(T));
+        _position += sizeof(T);
+    }
+
+    //! Read a string.
+    void read(std::string &value);
+
+    //! Read a date written as days since 1/1/1970.
+    void read(std::chrono::sys_days &value);
+
+    //! Read a date written field by field.
+    void read(std::chrono::year_month_day &value);
+
+    //! Read a vector of bools.
+    void read(std::vector<bool> &values);
+
+    //! Read a block written by BinaryWriter::writeArray(). The values are not copied, the span
+    //! points into the data of the reader. Returns an empty span on failure.
+    template<typename T> requires std::is_trivially_copyable_v<T>
+    std::span<const T> readArray()
+    {
+        uint64_t count = 0;
+        read(count);
+        align(BinaryWriter::alignment);
+
+        if (!ok() || count > (_size - _position) / sizeof(T)
+            || reinterpret_cast<uintptr_t>(_data + _position) % alignof(T) != 0)
+        {
+            _failed = true;
+            return {};
+        }
+
+        std::span<const T> values(reinterpret_cast<const T*>(_data + _position), count);
+        _position += count * sizeof(T);
+        return values;
+    }
+
+    //! Skip the padding written by BinaryWriter::align().
+    void align(size_t alignment);
+
+    //! Read a class which knows how to read itself.
+    template<typename T> requires requires(T &t, BinaryReader &r) { t.readState(r); }
+    void read(T &value)
+    {
+        value.readState(*this);
+    }
+
+    template<typename A, typename B>
+    void read(std::pair<A, B> &value)
+    {
+        read(value.first);
+        read(value.second);
+    }
+
+    template<typename T, size_t N>
+    void read(std::array<T, N> &values)
+    {
+        for (T &value : values)
+        {
+            read(value);
+        }
+    }
+
+    template<typename T>
+    void read(std::optional<T> &value)
+    {
+        bool hasValue = false;
+        read(hasValue);
+        value.reset();
+        if (hasValue)
+        {
+            T temporary{};
+            read(temporary);
+            value = temporary;
+        }
+    }
+
+    template<typename T>
+    void read(std::vector<T> &values)
+    {
+        values.clear();
+        uint64_t count = readCount();
+        values.resize(count);
+        for (T &value : values)
+        {
+            read(value);
+        }
+    }
+
+    template<typename T, typename C>
+    void read(std::set<T, C> &values)
+    {
+        values.clear();
+        uint64_t count = readCount();
+        for (uint64_t i = 0; i < count && ok(); i++)
+        {
+            T value{};
+            read(value);
+            values.insert(value);
+        }
+    }
+
+    template<typename T, typename C>
+    void read(std::multiset<T, C> &values)
+    {
+        values.clear();
+        uint64_t count = readCount();
+        for (uint64_t i = 0; i < count && ok(); i++)
+        {
+            T value{};
+            read(value);
+            values.insert(value);
+        }
+    }
+
+    template<typename K, typename V, typename C>
+    void read(std::map<K, V, C> &values)
+    {
+        values.clear();
+        uint64_t count = readCount();
+        for (uint64_t i = 0; i < count && ok(); i++)
+        {
+            K key{};
+            read(key);
+            read(values[key]);
+        }
+    }
+
+private:
+    //! Make sure the given amount of bytes can be read.
+    bool require(size_t bytes);
+
+    //! Read the number of elements of a container. Every element takes at least one byte,
+    //! so larger values indicate corrupted data.
+    uint64_t readCount();
+
+    //! Data to read from.
+    const char *_data;
+
+    //! Size of the data.
+    size_t _size;
+
+    //! Current position.
+    size_t _position = 0;
+
+    //! Set if a read failed.
+    bool _failed = false;
+
+}; // class BinaryReader
@@ -0,0 +1,253 @@
+#include <sstream>
+
+#include "checkpoint.h"
+#include "decaytable.h"
+#include "engineparameters.h"
+#include "logging.h"
+#include "mapstats.h"
+#include "players.h"
+#include "rating.h"
+#include "stringtools.h"
+
+namespace
+{
+
+//! Identifies checkpoint files.
+const char magic[8] = { 'E', 'L', 'O', 'C', 'H', 'K', 'P', 'T' };
+
+}
+
+/*!
+ */
+CheckpointParameters CheckpointParameters::fromOptions(const Options &options)
+{
+    CheckpointParameters parameters;
+
+    parameters.version = PROJECT_VERSION;
+    parameters.ladderAbbreviation = options.ladderAbbreviation;
+    parameters.gameMode = options.gameMode;
+    parameters.timeShiftInHours = options.timeShiftInHours;
+    parameters.cncnetDuplicates = options.cncnetDuplicates;
+    parameters.noDuplicates = options.noDuplicates;
+    parameters.tournamentFile = options.tournamentFile.string();
+    const EngineParameters &engineParameters = EngineParameters::current(options.gameMode);
+    parameters.tau = engineParameters.tau;
+    parameters.initialVolatility = engineParameters.initialVolatility;
+    parameters.exponentFactor2v2 = engineParameters.exponentFactor2v2;
+    parameters.convergence = glicko::convergence;
+    parameters.decayFactor = gamemodes::decayFactor(options.gameMode);
+    parameters.maxDeviationAfterActive = gamemodes::maxDeviationAfterActive(options.gameMode);
+    parameters.decayTableMinDeviation = DecayTable::minDeviation;
+    parameters.decayTableTrajectories = DecayTable::trajectoryCount;
+    parameters.volatilitySolver = static_cast<int32_t>(options.volatilitySolver);
+    parameters.initialRatingSearch = static_cast<int32_t>(options.initialRatingSearch);
+
+    return parameters;
+}
+
+/*!
+ */
+std::string CheckpointParameters::toString() const
+{
+    std::ostringstream stream;
+    stream << "V" << version << ", ladder " << ladderAbbreviation << ", time shift " << timeShiftInHours
+           << "h, duplicates " << (cncnetDuplicates ? "cncnet" : (noDuplicates ? "none" : "default"))
+           << ", tournament file '" << tournamentFile << "', tau " << tau << ", volatility " << initialVolatility
+           << ", 2v2 exponent " << exponentFactor2v2 << ", convergence " << convergence
+           << ", decay " << decayFactor << ", max deviation " << maxDeviationAfterActive
+           << ", decay table " << decayTableMinDeviation << "/" << decayTableTrajectories
+           << ", volatility solver " << volatilitySolver << ", initial rating search " << initialRatingSearch;
+    return stream.str();
+}
+
+/*!
+ */
+void CheckpointParameters::writeState(BinaryWriter &writer) const
+{
+    writer.write(version);
+    writer.write(ladderAbbreviation);
+    writer.write(gameMode);
+    writer.write(timeShiftInHours);
+    writer.write(cncnetDuplicates);
+    writer.write(noDuplicates);
+    writer.write(tournamentFile);
+    writer.write(tau);
+    writer.write(initialVolatility);
+    writer.write(exponentFactor2v2);
+    writer.write(convergence);
+    writer.write(decayFactor);
+    writer.write(maxDeviationAfterActive);
+    writer.write(decayTableMinDeviation);
+    writer.write(decayTableTrajectories);
+    writer.write(volatilitySolver);
+    writer.write(initialRatingSearch);
+}
+
+/*!
+ */
+void CheckpointParameters::readState(BinaryReader &reader)
+{
+    reader.read(version);
+    reader.read(ladderAbbreviation);
+    reader.read(gameMode);
+    reader.read(timeShiftInHours);
+    reader.read(cncnetDuplicates);
+    reader.read(noDuplicates);
+    reader.read(tournamentFile);
+    reader.read(tau);
+    reader.read(initialVolatility);
+    reader.read(exponentFactor2v2);
+    reader.read(convergence);
+    reader.read(decayFactor);
+    reader.read(maxDeviationAfterActive);
+    reader.read(decayTableMinDeviation);
+    reader.read(decayTableTrajectories);
+    reader.read(volatilitySolver);
+    reader.read(initialRatingSearch);
+}
+
+/*!
+ */
+void GameDigest::add(const Game &game)
+{
+    // Everything, which is used while computing ratings and stats.
+    auto addValue = [this](const auto &value) { hash = fnv1aHash(&value, sizeof(value), hash); };
+    auto addString = [&](const std::string &value) { addValue(value.size()); hash = fnv1aHash(value.data(), value.size(), hash); };
+
+    addValue(game.id());
+    addValue(game.timestamp());
+    addValue(game.duration());
+    addValue(game.fps());
+    addValue(game.gameType());
+    addValue(game.playerCount());
+    addValue(game.isDraw());
+    addString(game.mapName());
+
+    for (uint32_t i = 0; i < game.playerCount(); i++)
+    {
+        addValue(game.userId(i));
+        addValue(game.faction(i));
+        addValue(game.hasWon(i));
+        addString(game.playerName(i));
+    }
+
+    count++;
+}
+
+/*!
+ */
+void GameDigest::writeState(BinaryWriter &writer) const
+{
+    writer.write(count);
+    writer.write(hash);
+}
+
+/*!
+ */
+void GameDigest::readState(BinaryReader &reader)
+{
+    reader.read(count);
+    reader.read(hash);
+}
+
+/*!
+ */
+bool Checkpoint::load(const std::filesystem::path &file, const CheckpointParameters &parameters)
+{
+    std::optional<std::vector<char>> data = BinaryReader::loadFile(file, magic, formatVersion);
+    if (!data.has_value())
+    {
+        return false;
+    }
+
+    _data = std::move(*data);
+
+    BinaryReader reader(_data);
+    CheckpointParameters checkpointParameters;
+    reader.read(checkpointParameters);
+    reader.read(_lastRatingDay);
+    reader.read(_digest);
+
+    if (!reader.ok())
+    {
+        Log::warning() << "Checkpoint '" << file.string() << "' is incomplete.";
+        return false;
+    }
+
+    if (!(checkpointParameters == parameters))
+    {
+        Log::warning() << "Checkpoint '" << file.string() << "' was written with different parameters.";
+        Log::warning() << "Checkpoint: " << checkpointParameters.toString();
+        Log::warning() << "Current: " << parameters.toString();
+        return false;
+    }
+
+    _stateOffset = reader.position();
+
+    Log::info() << "Loaded checkpoint '" << file.string() << "' with " << _digest.count << " games up to "
+                << stringtools::fromDate(_lastRatingDay) << ".";
+
+    return true;
+}
+
+/*!
+ */
+std::chrono::sys_days Checkpoint::lastRatingDay() const
+{
+    return _lastRatingDay;
+}
+
+/*!
+ */
+const GameDigest& Checkpoint::digest() const
+{
+    return _digest;
+}
+
+/*!
+ */
+bool Checkpoint::restore(Players &players, MapStats &stats, gamemodes::GameMode gameMode) const
+{
+    BinaryReader reader(_data.data() + _stateOffset, _data.size() - _stateOffset);
+
+    // Map statistics first, players are only changed if everything else is fine.
+    MapStats restoredStats(gameMode);
+    reader.read(restoredStats);
+    if (!reader.ok())
+    {
+        Log::warning() << "Checkpoint data for map statistics is incomplete.";
+        return false;
+    }
+
+    if (!players.readState(reader, gameMode))
+    {
+        return false;
+    }
+
+    stats = std::move(restoredStats);
+
+    return true;
+}
+
+/*!
+ */
+bool Checkpoint::save(const std::filesystem::path &file, const CheckpointParameters &parameters, std::chrono::sys_days lastRatingDay,
+                      const GameDigest &digest, const Players &players, const MapStats &stats)
+{
+    BinaryWriter writer;
+    writer.write(parameters);
+    writer.write(lastRatingDay);
+    writer.write(digest);
+    writer.write(stats);
+    writer.write(players);
+
+    if (!writer.saveToFile(file, magic, formatVersion))
+    {
+        return false;
+    }
+
+    Log::info() << "Saved checkpoint with " << digest.count << " games up to " << stringtools::fromDate(lastRatingDay)
+                << " to '" << file.string() << "'.";
+
+    return true;
+}
@@ -0,0 +1,113 @@
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "binarystream.h"
+#include "game.h"
+#include "gamemode.h"
+#include "options.h"
+
+// Forward declarations:
+class MapStats;
+class Players;
+
+/*!
+ * Everything that affects the ratings besides the games themselves. A checkpoint can only be
+ * used if it has been written with exactly the same parameters.
+ */
+struct CheckpointParameters
+{
+    std::string version;
+    std::string ladderAbbreviation;
+    int32_t gameMode = gamemodes::Unknown;
+    int32_t timeShiftInHours = 0;
+    bool cncnetDuplicates = false;
+    bool noDuplicates = false;
+    std::string tournamentFile;
+    double tau = 0.0;
+    double initialVolatility = 0.0;
+    double exponentFactor2v2 = 0.0;
+    double convergence = 0.0;
+    double decayFactor = 0.0;
+    double maxDeviationAfterActive = 0.0;
+    double decayTableMinDeviation = 0.0; // Decay is looked up, see DecayTable.
+    uint64_t decayTableTrajectories = 0;
+    int32_t volatilitySolver = 0;
+    int32_t initialRatingSearch = 0;
+
+    //! Collect the parameters of the current run.
+    static CheckpointParameters fromOptions(const Options &options);
+
+    bool operator==(const CheckpointParameters &other) const = default;
+
+    //! Short description used for logging.
+    std::string toString() const;
+
+    void writeState(BinaryWriter &writer) const;
+    void readState(BinaryReader &reader);
+};
+
+/*!
+ * Fingerprint of all games processed so far. Used to detect games that have been added,
+ * removed or changed after a checkpoint had been written.
+ */
+struct GameDigest
+{
+    uint64_t count = 0;
+    uint64_t hash = fnv1aHash(nullptr, 0);
+
+    //! Add a game to the digest. The order of the games matters.
+    void add(const Game &game);
+
+    bool operator==(const GameDigest &other) const = default;
+
+    void writeState(BinaryWriter &writer) const;
+    void readState(BinaryReader &reader);
+};
+
+/*!
+ * Snapshot of the rating state after a completed rating period. Allows to process only the
+ * games, which have been played since, instead of replaying the whole history on every run.
+ */
+class Checkpoint
+{
+public:
+    //! Bump this whenever the layout of the file changes.
+    static const uint32_t formatVersion = 10;
+
+    //! Load the checkpoint and check if it has been written with the given parameters.
+    //! Returns false and logs a warning if the checkpoint can't be used.
+    bool load(const std::filesystem::path &file, const CheckpointParameters &parameters);
+
+    //! The last rating period, which has been applied before the checkpoint was written.
+    std::chrono::sys_days lastRatingDay() const;
+
+    //! Fingerprint of all games up to (including) the last rating period.
+    const GameDigest& digest() const;
+
+    //! Restore players and map statistics. Each player in the checkpoint has to exist already.
+    //! Nothing is changed if restoring fails.
+    bool restore(Players &players, MapStats &stats, gamemodes::GameMode gameMode) const;
+
+    //! Write a checkpoint. There must not be any pending games.
+    static bool save(const std::filesystem::path &file, const CheckpointParameters &parameters, std::chrono::sys_days lastRatingDay,
+                     const GameDigest &digest, const Players &players, const MapStats &stats);
+
+private:
+    //! Content of the checkpoint file.
+    std::vector<char> _data;
+
+    //! Position of the map statistics and player data within _data.
+    size_t _stateOffset = 0;
+
+    //! Last applied rating period.
+    std::chrono::sys_days _lastRatingDay{};
+
+    //! Fingerprint of the games.
+    GameDigest _digest;
+
+}; // class Checkpoint
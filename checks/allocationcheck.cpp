@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "logging.h"
+#include "rating.h"
+
+/*
+ * Checks, that rating updates don't allocate once their buffers have been sized. Replaces the
+ * global operator new and counts its calls over provisional, batch and single-game updates.
+ */
+
+namespace
+{
+
+//! Number of calls of operator new so far.
+std::atomic<uint64_t> allocationCount = 0;
+
+//! Rounds of updates counted.
+const int rounds = 1000;
+
+//! Opponents and results of a provisional player, who lost all games of the day.
+const size_t provisionalGames = 30;
+
+//! Opponents and results of a day of an established player.
+const size_t batchGames = 12;
+
+/*!
+ */
+std::array<double, 3> opponent(size_t index)
+{
+    double elo = 1200.0 + 50.0 * static_cast<double>(index % 16);
+    double deviation = 80.0 + 10.0 * static_cast<double>(index % 7);
+
+    return Rating(elo, deviation, glicko::initialVolatility).toArray();
+}
+
+/*!
+ */
+uint64_t countAllocations(const char *name, void (*update)(const std::vector<std::array<double, 3>>&, const std::vector<double>&),
+                          const std::vector<std::array<double, 3>> &opponents, const std::vector<double> &results)
+{
+    // The first round sizes the buffers of the kernel.
+    update(opponents, results);
+
+    uint64_t before = allocationCount;
+    for (int i = 0; i < rounds; i++)
+    {
+        update(opponents, results);
+    }
+    uint64_t allocations = allocationCount - before;
+
+    std::cout << name << ": " << allocations << " allocations in " << rounds << " rounds." << std::endl;
+
+    return allocations;
+}
+
+}
+
+/*!
+ */
+void* operator new(size_t size)
+{
+    allocationCount++;
+
+    if (void *pointer = std::malloc(size == 0 ? 1 : size))
+    {
+        return pointer;
+    }
+
+    throw std::bad_alloc();
+}
+
+/*!
+ */
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+/*!
+ */
+void operator delete(void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+/*!
+ */
+int main()
+{
+    // Messages are not formatted below the log level, just like in a regular run.
+    Log::setGlobalLogLevel(Log::Warning);
+
+    std::vector<std::array<double, 3>> provisionalOpponents;
+    std::vector<double> provisionalResults;
+    for (size_t i = 0; i < provisionalGames; i++)
+    {
+        provisionalOpponents.push_back(opponent(i));
+        provisionalResults.push_back(0.0);
+    }
+
+    std::vector<std::array<double, 3>> batchOpponents;
+    std::vector<double> batchResults;
+    for (size_t i = 0; i < batchGames; i++)
+    {
+        batchOpponents.push_back(opponent(i));
+        batchResults.push_back((i % 3 == 0) ? 0.0 : 1.0);
+    }
+
+    uint64_t allocations = 0;
+
+    allocations += countAllocations("Provisional update", [](const auto &opponents, const auto &results) {
+        Rating rating;
+        rating.updateWithNoWin(opponents, results, false);
+        rating.apply();
+    }, provisionalOpponents, provisionalResults);
+
+    allocations += countAllocations("Batch update", [](const auto &opponents, const auto &results) {
+        Rating rating(1500.0, 90.0, glicko::initialVolatility);
+        rating.updateNormally(opponents, results);
+        rating.apply();
+    }, batchOpponents, batchResults);
+
+    allocations += countAllocations("Single-game update", [](const auto &opponents, const auto &results) {
+        Rating rating(1500.0, 90.0, glicko::initialVolatility);
+        for (size_t i = 0; i < opponents.size(); i++)
+        {
+            rating.update(opponents[i], results[i], Rating::CalculationType::Normal);
+        }
+        rating.apply();
+    }, batchOpponents, batchResults);
+
+    if (allocations != 0)
+    {
+        std::cout << "Rating updates are supposed to work without allocations." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
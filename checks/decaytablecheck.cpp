@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "decaytable.h"
+#include "gamemode.h"
+#include "logging.h"
+#include "rating.h"
+
+/*
+ * Checks, that decaying several days at once by the DecayTable matches decaying day by day
+ * within DecayTable::tolerance. Covers all game modes, deviations up to the initial deviation,
+ * active and inactive players and as many days as it takes to reach the maximum deviation.
+ */
+
+namespace
+{
+
+//! Step between the start deviations (elo). Not a divisor of the distance between trajectories.
+const double deviationStep = 0.37;
+
+//! Days decayed for each start deviation.
+const int maxDays = 1000;
+
+}
+
+/*!
+ */
+int main()
+{
+    Log::setGlobalLogLevel(Log::Warning);
+
+    uint64_t comparisons = 0;
+    uint64_t failures = 0;
+    double largestDifference = 0.0;
+
+    for (int mode = 0; mode < gamemodes::GameModeCount; mode++)
+    {
+        gamemodes::GameMode gameMode = static_cast<gamemodes::GameMode>(mode);
+        double factor = gamemodes::decayFactor(gameMode);
+        double maxDeviationAfterActive = gamemodes::maxDeviationAfterActive(gameMode);
+        const DecayTable &table = DecayTable::forGameMode(gameMode);
+
+        for (bool wasActive : { false, true })
+        {
+            for (double deviation = deviationStep; deviation <= glicko::initialDeviation; deviation += deviationStep)
+            {
+                Rating dayByDay(glicko::initialRating, deviation, glicko::initialVolatility);
+
+                for (int days = 1; days <= maxDays; days++)
+                {
+                    dayByDay.decay(wasActive, factor, maxDeviationAfterActive);
+
+                    Rating lookedUp(glicko::initialRating, deviation, glicko::initialVolatility);
+                    lookedUp.decay(wasActive, days, table, maxDeviationAfterActive);
+
+                    double difference = std::abs(lookedUp.eloDeviation() - dayByDay.eloDeviation());
+                    largestDifference = std::max(largestDifference, difference);
+                    comparisons++;
+
+                    if (difference > DecayTable::tolerance)
+                    {
+                        if (failures++ < 10)
+                        {
+                            std::cout << gamemodes::shortName(gameMode) << (wasActive ? ", active" : ", inactive")
+                                      << ": deviation " << deviation << " after " << days << " days is "
+                                      << lookedUp.eloDeviation() << " instead of " << dayByDay.eloDeviation() << "." << std::endl;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::cout << comparisons << " comparisons, largest difference " << largestDifference << ", "
+              << failures << " beyond the tolerance of " << DecayTable::tolerance << "." << std::endl;
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "engineparameters.h"
+#include "logging.h"
+#include "rating.h"
+
+/*
+ * Compares the initial rating searches on random first days of new players with wins and
+ * losses. Reports trials and time per player of the grid and the root search and the largest
+ * difference of the ratings they find. The grid compares the changes as whole numbers, so on
+ * flat days it stops anywhere the rating changes by less than 1 elo and the searches can be
+ * far apart. The root search must find ratings at least as self-consistent as the grid.
+ *
+ * Also times the start values bracketing the root, the only trials independent of each other,
+ * once in a row and once with a thread each.
+ */
+
+namespace
+{
+
+//! Number of random first days.
+const size_t days = 2000;
+
+//! Games of a first day.
+const int minGames = 2;
+const int maxGames = 30;
+
+//! Change (elo) the root search may exceed the change of the grid by.
+const double maxExcessChange = 0.1;
+
+//! A first day of a new player.
+struct FirstDay
+{
+    std::vector<std::array<double, 3>> opponents;
+    std::vector<double> results;
+};
+
+/*!
+ */
+std::vector<FirstDay> randomFirstDays()
+{
+    std::mt19937 generator(20240601);
+    std::uniform_int_distribution<int> gameCount(minGames, maxGames);
+    std::uniform_real_distribution<double> elo(600.0, 2400.0);
+    std::uniform_real_distribution<double> deviation(60.0, 250.0);
+    std::uniform_real_distribution<double> winRate(0.05, 0.95);
+
+    std::vector<FirstDay> firstDays(days);
+    for (FirstDay &firstDay : firstDays)
+    {
+        int games = gameCount(generator);
+        std::bernoulli_distribution win(winRate(generator));
+
+        for (int i = 0; i < games; i++)
+        {
+            firstDay.opponents.push_back(Rating(elo(generator), deviation(generator), glicko::initialVolatility).toArray());
+            firstDay.results.push_back(win(generator) ? 1.0 : 0.0);
+        }
+
+        // The search only runs for players with wins and losses.
+        firstDay.results[0] = 1.0;
+        firstDay.results[1] = 0.0;
+    }
+
+    return firstDays;
+}
+
+/*!
+ */
+double change(double elo, const FirstDay &firstDay)
+{
+    // Same as a trial of the searches.
+    Rating rating(elo, glicko::initialDeviation, EngineParameters::current().initialVolatility);
+    rating.updateWithNoWin(firstDay.opponents, firstDay.results, false);
+    rating.apply();
+
+    return std::abs(rating.elo() - elo);
+}
+
+/*!
+ */
+std::vector<double> search(glicko::InitialRatingSearch initialRatingSearch, const char *name, const std::vector<FirstDay> &firstDays)
+{
+    glicko::setInitialRatingSearch(initialRatingSearch);
+    glicko::solverStatistics() = {};
+
+    std::vector<double> elos;
+    for (const FirstDay &firstDay : firstDays)
+    {
+        Rating rating;
+        rating.updateWithFirstWin(firstDay.opponents, firstDay.results, false, false);
+        rating.apply();
+        elos.push_back(rating.elo());
+    }
+
+    const glicko::SolverStatistics &statistics = glicko::solverStatistics();
+    double microseconds = std::chrono::duration<double, std::micro>(statistics.initialRatingTime).count();
+
+    std::cout << name << ": " << statistics.initialRatingSearches << " players, "
+              << static_cast<double>(statistics.initialRatingTrials) / statistics.initialRatingSearches << " trials and "
+              << microseconds / statistics.initialRatingSearches << " us per player, "
+              << microseconds / statistics.initialRatingTrials << " us per trial." << std::endl;
+
+    return elos;
+}
+
+/*!
+ */
+void bracketPoints(const std::vector<FirstDay> &firstDays)
+{
+    std::vector<double> elos(glicko::initialRatingBracketPoints);
+    for (uint32_t i = 0; i < elos.size(); i++)
+    {
+        elos[i] = glicko::maxInitialRating - i * (glicko::maxInitialRating - glicko::minInitialRating) / (elos.size() - 1);
+    }
+
+    std::vector<double> changes(elos.size());
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (const FirstDay &firstDay : firstDays)
+    {
+        for (size_t i = 0; i < elos.size(); i++)
+        {
+            changes[i] = change(elos[i], firstDay);
+        }
+    }
+    std::chrono::steady_clock::duration sequential = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (const FirstDay &firstDay : firstDays)
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < elos.size(); i++)
+        {
+            threads.emplace_back([&, i]() { changes[i] = change(elos[i], firstDay); });
+        }
+
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+    std::chrono::steady_clock::duration parallel = std::chrono::steady_clock::now() - start;
+
+    std::cout << elos.size() << " bracket points: " << std::chrono::duration<double, std::micro>(sequential).count() / firstDays.size()
+              << " us per player in a row, " << std::chrono::duration<double, std::micro>(parallel).count() / firstDays.size()
+              << " us with a thread each." << std::endl;
+}
+
+}
+
+/*!
+ */
+int main()
+{
+    Log::setGlobalLogLevel(Log::Warning);
+
+    std::vector<FirstDay> firstDays = randomFirstDays();
+
+    std::vector<double> gridElos = search(glicko::InitialRatingSearch::Grid, "Grid", firstDays);
+    std::vector<double> rootElos = search(glicko::InitialRatingSearch::Root, "Root", firstDays);
+    bracketPoints(firstDays);
+
+    double largestDifference = 0.0;
+    size_t failures = 0;
+    for (size_t i = 0; i < firstDays.size(); i++)
+    {
+        largestDifference = std::max(largestDifference, std::abs(gridElos[i] - rootElos[i]));
+
+        double gridChange = change(gridElos[i], firstDays[i]);
+        double rootChange = change(rootElos[i], firstDays[i]);
+        if (rootChange > gridChange + maxExcessChange)
+        {
+            if (failures++ < 10)
+            {
+                std::cout << "Day " << i << " with " << firstDays[i].results.size() << " games: grid " << gridElos[i]
+                          << " changes by " << gridChange << ", root " << rootElos[i] << " by " << rootChange << "." << std::endl;
+            }
+        }
+    }
+
+    std::cout << "Largest difference " << largestDifference << " elo, " << failures << " players changing more with "
+              << "the root search." << std::endl;
+
+    return (failures == 0) ? 0 : 1;
+}
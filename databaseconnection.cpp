@@ -1,7 +1,9 @@
 
 #include <queue>
 
+#include "cplusplus.h"
 #include "databaseconnection.h"
+#include "knownplayers.h"
 #include "players.h"
 #include "stringtools.h"
 
@@ -62,28 +64,54 @@ bool DatabaseConnection::ladderExists(const std::string &abbreviation) const
 
 /*!
  */
-void DatabaseConnection::removeDuplicate(std::map<uint32_t, std::set<uint32_t>> &duplicates, uint32_t userId)
+const std::string& DatabaseConnection::ladder() const
 {
-    duplicates[userId].clear();
-
-    Log::info() << "Removing duplicates for " << userId << ".";
+    return _ladder;
+}
 
-    for (auto it = duplicates.begin(); it != duplicates.end(); ++it)
-    {
-        std::set<uint32_t> &set = it->second;
-        if (set.contains(userId))
-        {
-            Log::info() << userId << " is not a duplicate of " << it->first << ".";
-            set.erase(userId);
-        }
-    }
+/*!
+ */
+void DatabaseConnection::setLadder(const std::string &abbreviation)
+{
+    _ladder = abbreviation;
+    _gameMode = gamemodes::toGameMode(abbreviation);
 }
 
 /*!
  */
-const std::string& DatabaseConnection::ladder() const
+void DatabaseConnection::queryInChunks(const std::string &query, const std::set<uint32_t> &ids, const std::function<void(sql::ResultSet&)> &handler)
 {
-    return _ladder;
+    const size_t chunkSize = 500;
+    auto it = ids.begin();
+
+    while (it != ids.end())
+    {
+        std::vector<uint32_t> chunk;
+        chunk.reserve(chunkSize);
+        std::stringstream chunkQuery;
+        chunkQuery << query;
+
+        for (size_t i = 0; i < chunkSize && it != ids.end(); ++i, ++it)
+        {
+            chunkQuery << ((i > 0) ? "," : "");
+            chunkQuery << "?";
+            chunk.push_back(*it);
+        }
+
+        chunkQuery << ");";
+
+        std::unique_ptr<sql::PreparedStatement> statement(_connection->prepareStatement(chunkQuery.str()));
+        for (size_t i = 0; i < chunk.size(); i++)
+        {
+            statement->setUInt(i + 1, chunk[i]);
+        }
+
+        std::unique_ptr<sql::ResultSet> result(statement->executeQuery());
+        while (result->next())
+        {
+            handler(*result);
+        }
+    }
 }
 
 /*!
@@ -187,52 +215,97 @@ void DatabaseConnection::loadUsers(const std::set<uint32_t> &userIds, Players &p
         return;
     }
 
-    const size_t chunkSize = 500;
-    auto it = userIds.begin();
+    cacheAliases(userIds);
 
-    while (it != userIds.end())
+    for (uint32_t userId : userIds)
     {
-        std::vector<uint32_t> chunk;
-        chunk.reserve(chunkSize);
-        std::stringstream query;
+        auto it = _aliases.find(userId);
+        if (it == _aliases.end())
+        {
+            continue;
+        }
 
-        query << R"SQL(
-            SELECT
-                id,
-                alias
-            FROM users
-                WHERE id IN (
-        )SQL";
+        Player player(userId, userId, "", _gameMode);
+        if (!it->second.empty())
+        {
+            player.setAlias(it->second);
+        }
+        players.add(player, _ladder);
+    }
+}
 
-        for (size_t i = 0; i < chunkSize && it != userIds.end(); ++i, ++it)
+/*!
+ */
+void DatabaseConnection::cacheAliases(const std::set<uint32_t> &userIds)
+{
+    std::set<uint32_t> missingUserIds;
+    for (uint32_t userId : userIds)
+    {
+        if (!_aliases.contains(userId))
         {
-            query << ((i > 0) ? "," : "");
-            query << "?";
-            chunk.push_back(*it);
+            missingUserIds.insert(userId);
         }
+    }
 
-        query << ");";
+    queryInChunks("SELECT id, alias FROM users WHERE id IN (", missingUserIds, [this](sql::ResultSet &result) {
+        _aliases[result.getUInt("id")] = result.getString("alias");
+    });
+}
 
-        std::unique_ptr<sql::PreparedStatement> stmt(_connection->prepareStatement(query.str()));
-        for (size_t i = 0; i < chunk.size(); i++)
+/*!
+ */
+std::map<uint32_t, std::set<uint32_t>> DatabaseConnection::getWebLikeDuplicateAccounts(const std::set<uint32_t> &userIds)
+{
+    std::set<uint32_t> missingUserIds;
+    for (uint32_t userId : userIds)
+    {
+        if (!_webLikeDuplicates.contains(userId))
         {
-            stmt->setUInt(i + 1, chunk[i]);
+            missingUserIds.insert(userId);
         }
+    }
 
-        std::unique_ptr<sql::ResultSet> result(stmt->executeQuery());
+    // Last known ip address of each user.
+    std::map<uint32_t, uint32_t> ipAddressIds;
+    queryInChunks("SELECT id, ip_address_id FROM users WHERE id IN (", missingUserIds, [&](sql::ResultSet &result) {
+        int ipAddressId = result.getInt("ip_address_id");
+        if (ipAddressId > 0)
+        {
+            ipAddressIds[result.getUInt("id")] = static_cast<uint32_t>(ipAddressId);
+        }
+    });
 
-        while (result->next())
+    // All users, who ever used one of these ip addresses.
+    std::set<uint32_t> distinctIpAddressIds;
+    for (const auto &[userId, ipAddressId] : ipAddressIds)
+    {
+        distinctIpAddressIds.insert(ipAddressId);
+    }
+
+    std::map<uint32_t, std::set<uint32_t>> usersByIpAddress;
+    queryInChunks("SELECT ip_address_id, user_id FROM ip_address_histories WHERE ip_address_id IN (", distinctIpAddressIds, [&](sql::ResultSet &result) {
+        usersByIpAddress[result.getUInt("ip_address_id")].insert(result.getUInt("user_id"));
+    });
+
+    for (uint32_t userId : missingUserIds)
+    {
+        std::set<uint32_t> &userDuplicates = _webLikeDuplicates[userId];
+
+        auto ipAddress = ipAddressIds.find(userId);
+        if (ipAddress != ipAddressIds.end())
         {
-            uint32_t userId = result->getUInt("id");
-            std::string alias = result->getString("alias");
-            Player player(userId, userId, "", _gameMode);
-            if (!alias.empty())
-            {
-                player.setAlias(alias);
-            }
-            players.add(player, _ladder);
+            userDuplicates = usersByIpAddress[ipAddress->second];
+            userDuplicates.erase(userId);
         }
     }
+
+    std::map<uint32_t, std::set<uint32_t>> duplicates;
+    for (uint32_t userId : userIds)
+    {
+        duplicates[userId] = _webLikeDuplicates[userId];
+    }
+
+    return duplicates;
 }
 
 /*!
@@ -258,113 +331,21 @@ std::string DatabaseConnection::loadAlias(uint32_t userId)
 
 /*!
  */
-std::unordered_map<uint32_t, uint32_t> DatabaseConnection::cncnetDuplicateMapping(const std::map<uint32_t, uint32_t> &userIds)
+std::map<uint32_t, std::string> DatabaseConnection::loadAliases(const std::set<uint32_t> &userIds)
 {
-    std::unordered_map<uint32_t, uint32_t> result;
-    std::map<uint32_t, std::set<uint32_t>> temporaryDuplicates;
-
-    // First, use recent-IP algorithm to determine duplicates.
-    for (const auto& [userId, gameCount] : userIds)
-    {
-        Log::verbose() << "User " << userId << " has played " << gameCount << " games.";
-        temporaryDuplicates[userId] = std::set<uint32_t>();
-        std::set<uint32_t> duplicates = getWebLikeDuplicateAccounts(userId);
-        for (uint32_t duplicate : duplicates)
-        {
-            Log::verbose() << "User #" << duplicate << " is a duplicate of #" << userId << ".";
-            temporaryDuplicates[userId].insert(duplicate);
-            temporaryDuplicates[duplicate].insert(userId);
-
-            for (uint32_t x : duplicates)
-            {
-                if (x != duplicate)
-                {
-                    temporaryDuplicates[duplicate].insert(x);
-                }
-            }
-        }
-    }
-
-    // Next, add some well known duplicates, which are not detected by recent IP.
-    temporaryDuplicates[  152].insert({ 37747, 79486 });
-    temporaryDuplicates[  268].insert({    69 });
-    temporaryDuplicates[ 3968].insert({ 18319, 66877 });
-    temporaryDuplicates[17651].insert({ 40343, 43364, 44568 }); // This is actually wrong.
-    temporaryDuplicates[19083].insert({ 10459 });
-    temporaryDuplicates[33933].insert({ 300, 5878 });
-    temporaryDuplicates[40500].insert({    24,  1029, 68169 });
-    temporaryDuplicates[44616].insert({ 67416 });
-    temporaryDuplicates[37077].insert({ 58873, 59236, 59916, 68898, 68942, 71304 });
-    temporaryDuplicates[19548].insert({ 68698 });
-    temporaryDuplicates[69904].insert({ 73057, 75285, 78280});
-    temporaryDuplicates[47880].insert({ 71623 });
-    temporaryDuplicates[53313].insert({ 59298, 76620 });
-    temporaryDuplicates[54423].insert({ 20498 });
-    temporaryDuplicates[55626].insert({ 73649 });
-    temporaryDuplicates[58766].insert({ 58764, 66502 });
-    temporaryDuplicates[59413].insert({   554, 61680 });
-    temporaryDuplicates[60300].insert({ 61757, 65104, 65875 });
-    temporaryDuplicates[62077].insert({ 56736 });
-    temporaryDuplicates[63398].insert({ 63331 });
-    temporaryDuplicates[67132].insert({ 1179 });
-    temporaryDuplicates[67596].insert({ 36814 });
-    temporaryDuplicates[60828].insert({ 77657, 74819});
-    temporaryDuplicates[65311].insert({ 81488 });
-    removeDuplicate(temporaryDuplicates, 56589);
-    removeDuplicate(temporaryDuplicates, 6026);
-    removeDuplicate(temporaryDuplicates, 58860);
-
-    crunchDuplicates(temporaryDuplicates);
-
-    // Ouput all duplicates.
-    for (auto& [primaryUserId, duplicates] : temporaryDuplicates)
-    {
-        std::stringstream ss;
-        for (uint32_t id : duplicates)
-        {
-            ss << " " << id;
-        }
-        Log::verbose() << "Duplicates of #" << primaryUserId << ":" << ss.str();
-    }
+    cacheAliases(userIds);
 
-    // Next, find the best primary account for each player.
-    for (auto& [currentPrimary, duplicates] : temporaryDuplicates)
+    std::map<uint32_t, std::string> aliases;
+    for (uint32_t userId : userIds)
     {
-        uint32_t currentBestPrimary = 0;
-        uint32_t mostGames = 0;
-        duplicates.insert(currentPrimary);
-
-        for (uint32_t duplicate : duplicates)
-        {
-            std::string alias = loadAlias(duplicate);
-            if (!alias.empty())
-            {
-                currentBestPrimary = duplicate;
-                break;
-            }
-
-            auto it = userIds.find(duplicate);
-            uint32_t gamesPlayed = (it == userIds.end()) ? 0 : it->second;
-
-            if (gamesPlayed > mostGames)
-            {
-                mostGames = it->second;
-                currentBestPrimary = duplicate;
-            }
-        }
-
-        if (currentBestPrimary == 0)
+        auto it = _aliases.find(userId);
+        if (it != _aliases.end() && !it->second.empty())
         {
-            Log::critical() << "No best primary account found.";
-        }
-
-        for (uint32_t duplicate : duplicates)
-        {
-            result[duplicate] = currentBestPrimary;
+            aliases[userId] = it->second;
         }
     }
 
-    return result;
+    return aliases;
 }
 
 /*!
@@ -426,7 +407,43 @@ std::unordered_map<uint32_t, uint32_t> DatabaseConnection::duplicateToPrimaryMap
 
 /*!
  */
-std::map<uint32_t, Game> DatabaseConnection::fetchGames()
+std::string DatabaseConnection::rejectionExpression()
+{
+    // Same order as GameFilter::check(). Rules about the participants are in participantsCondition().
+    return
+        "CASE "
+        "  WHEN COALESCE(game_reports.duration, 0) * IF(COALESCE(game_reports.fps, 0) > 0, game_reports.fps, 60) DIV 60 "
+        "       BETWEEN 1 AND " + std::to_string(GameFilter::minDuration - 1) + " THEN " + std::to_string(GameFilter::Duration) + " "
+        "  WHEN COALESCE(game_reports.fps, 0) BETWEEN 2 AND " + std::to_string(GameFilter::minFps - 1)
+        + " THEN " + std::to_string(GameFilter::LowFps) + " "
+        "  ELSE 0 END";
+}
+
+/*!
+ */
+std::string DatabaseConnection::participantsCondition(const GameFilter &filter)
+{
+    // Counts the same rows per game as the ladder queries join. Only too few participants are
+    // rejected, the query might drop some of them.
+    std::string condition =
+        "EXISTS (SELECT 1 FROM player_game_reports pgr "
+        "        JOIN players p ON p.id = pgr.player_id "
+        "        JOIN stats2 s ON s.id = pgr.stats_id "
+        "        WHERE pgr.game_report_id = games.game_report_id "
+        "        HAVING COUNT(*) >= " + std::to_string(filter.playerCount());
+
+    if (!filter.acceptsBots())
+    {
+        condition += " AND SUM(p.user_id = " + std::to_string(dts::to_underlying(KnownPlayers::BlitzBot)) + ") = 0";
+    }
+
+    return condition + ")";
+}
+
+/*!
+ */
+std::map<uint32_t, Game> DatabaseConnection::fetchGames(const GameFilter &filter, const GameWatermark &since, GameWatermark &watermark,
+                                                        std::map<uint32_t, GameFilter::Rejection> &rejectedGames)
 {
     std::map<uint32_t, Game> games;
 
@@ -443,6 +460,7 @@ std::map<uint32_t, Game> DatabaseConnection::fetchGames()
             game_reports.duration,
             game_reports.fps,
             UNIX_TIMESTAMP(games.created_at) AS timestamp,
+            UNIX_TIMESTAMP(games.updated_at) AS updatedAt,
             games.created_at AS played
         FROM games
         JOIN ladder_history ON games.ladder_history_id = ladder_history.id
@@ -456,7 +474,6 @@ std::map<uint32_t, Game> DatabaseConnection::fetchGames()
         LEFT JOIN qm_maps qmap ON qmm.qm_map_id = qmap.id
         LEFT JOIN maps maps ON maps.id = qmap.map_id
         WHERE ladders.abbreviation = ? AND games.created_at >= '2022-01-01'
-        ORDER BY games.updated_at ASC;
     )sql";
 
     // In contrast to other ladder, RA can start at 2020-01.
@@ -474,6 +491,7 @@ std::map<uint32_t, Game> DatabaseConnection::fetchGames()
             game_reports.duration,
             game_reports.fps,
             UNIX_TIMESTAMP(games.created_at) AS timestamp,
+            UNIX_TIMESTAMP(games.updated_at) AS updatedAt,
             games.created_at AS played
         FROM games
         JOIN ladder_history ON games.ladder_history_id = ladder_history.id
@@ -487,7 +505,6 @@ std::map<uint32_t, Game> DatabaseConnection::fetchGames()
         LEFT JOIN qm_maps qmap ON qmm.qm_map_id = qmap.id
         LEFT JOIN maps maps ON maps.id = qmap.map_id
         WHERE ladders.abbreviation = 'ra' AND games.created_at >= '2020-01-01'
-        ORDER BY games.updated_at ASC
     )sql";
 
     // Games for ladder ra2 include ra2-new-maps and games playes between 2022-01-01 and 2022-05-01,
@@ -507,6 +524,7 @@ std::map<uint32_t, Game> DatabaseConnection::fetchGames()
             "  game_reports.duration, "
             "  game_reports.fps, "
             "  UNIX_TIMESTAMP(games.created_at) AS timestamp, "
+            "  UNIX_TIMESTAMP(games.updated_at) AS updatedAt, "
             "  games.created_at AS played "
             "FROM games "
             "JOIN ladder_history ON games.ladder_history_id = ladder_history.id "
@@ -531,7 +549,6 @@ std::map<uint32_t, Game> DatabaseConnection::fetchGames()
             "     AND COALESCE(maps.name, games.scen) LIKE '%\"' "
             "   ) "
             ") "
-            "ORDER BY games.updated_at ASC "
     );
 
     std::string ladderGamesYR(
@@ -547,6 +564,7 @@ std::map<uint32_t, Game> DatabaseConnection::fetchGames()
         "  game_reports.duration, "
         "  game_reports.fps, "
         "  UNIX_TIMESTAMP(games.created_at) AS timestamp, "
+        "  UNIX_TIMESTAMP(games.updated_at) AS updatedAt, "
         "  games.created_at AS played "
         "FROM games "
         "JOIN ladder_history ON games.ladder_history_id = ladder_history.id "
@@ -568,7 +586,6 @@ std::map<uint32_t, Game> DatabaseConnection::fetchGames()
         "    AND COALESCE(maps.name, games.scen) LIKE '\"%' "
         "    AND COALESCE(maps.name, games.scen) LIKE '%\"' "
         "  ) "
-        "ORDER BY games.updated_at ASC "
         );
 
     std::string sqlStatement;
@@ -590,20 +607,87 @@ std::map<uint32_t, Game> DatabaseConnection::fetchGames()
         sqlStatement = ladderGames;
     }
 
-    std::unique_ptr<sql::PreparedStatement> statement(
-        _connection->prepareStatement(sqlStatement));
+    bool isGenericStatement = (sqlStatement == ladderGames);
 
-    if (sqlStatement == ladderGames)
+    // Only fetch games, which are new or have been modified since the last fetch. Games modified
+    // within the same second as the watermark are fetched again, so none can be missed. Only
+    // games.updated_at is watched. Deleted games and report changes, which don't touch the game,
+    // are not noticed (see --games-cache).
+    if (!since.isEmpty())
     {
-        statement->setString(1, _ladder);
+        sqlStatement += " AND (games.id > ? OR games.updated_at >= FROM_UNIXTIME(?)) ";
     }
 
+    auto bindParameters = [&](sql::PreparedStatement &statement) {
+        int parameterIndex = 1;
+
+        if (isGenericStatement)
+        {
+            statement.setString(parameterIndex++, _ladder);
+        }
+
+        if (!since.isEmpty())
+        {
+            statement.setUInt(parameterIndex++, since.gameId);
+            statement.setUInt(parameterIndex++, since.updatedAt);
+        }
+    };
+
+    watermark = since;
+
+    // Only ids of rejected games, so they can be counted and removed from a games cache. Grouped
+    // over the rows of the ladder query, same order of rules as GameFilter::check().
+    std::string rejectedStatement =
+        "SELECT games.id AS gameId, MAX(UNIX_TIMESTAMP(games.updated_at)) AS updatedAt, "
+        "  CASE "
+        "    WHEN COUNT(*) < " + std::to_string(filter.playerCount()) + " THEN " + std::to_string(GameFilter::PlayerCount) + " "
+        "    WHEN MAX(" + rejectionExpression() + ") > 0 THEN MAX(" + rejectionExpression() + ") ";
+
+    if (!filter.acceptsBots())
+    {
+        rejectedStatement +=
+            "    WHEN SUM(players.user_id = " + std::to_string(dts::to_underlying(KnownPlayers::BlitzBot)) + ") > 0 "
+            "    THEN " + std::to_string(GameFilter::Bot) + " ";
+    }
+
+    rejectedStatement += "    ELSE 0 END AS rejection "
+        + sqlStatement.substr(sqlStatement.find("FROM games"))
+        + " GROUP BY games.id HAVING rejection > 0";
+
+    std::unique_ptr<sql::PreparedStatement> rejectedQuery(_connection->prepareStatement(rejectedStatement));
+    bindParameters(*rejectedQuery);
+
+    std::unique_ptr<sql::ResultSet> rejectedResult(rejectedQuery->executeQuery());
+    while (rejectedResult->next())
+    {
+        uint32_t gameId = rejectedResult->getUInt("gameId");
+        rejectedGames[gameId] = static_cast<GameFilter::Rejection>(rejectedResult->getUInt("rejection"));
+
+        watermark.gameId = std::max(watermark.gameId, gameId);
+        watermark.updatedAt = std::max(watermark.updatedAt, static_cast<uint32_t>(rejectedResult->getInt64("updatedAt")));
+    }
+
+    Log::info() << "Skipped " << rejectedGames.size() << " games while fetching.";
+
+    // Rows of rejected games are never transferred.
+    sqlStatement += " AND (" + rejectionExpression() + ") = 0 AND " + participantsCondition(filter) + " ";
+
+    // Order participants as well to get identical games on each fetch.
+    sqlStatement += " ORDER BY games.updated_at ASC, games.id ASC, player_game_reports.id ASC";
+
+    std::unique_ptr<sql::PreparedStatement> statement(
+        _connection->prepareStatement(sqlStatement));
+    bindParameters(*statement);
+
     std::unique_ptr<sql::ResultSet> result(statement->executeQuery());
 
     while (result->next())
     {
         uint32_t gameId = static_cast<uint32_t>(result->getInt("gameId"));
 
+        watermark.gameId = std::max(watermark.gameId, gameId);
+        watermark.updatedAt = std::max(watermark.updatedAt, static_cast<uint32_t>(result->getInt64("updatedAt")));
+
         if (!games.contains(gameId))
         {
             uint32_t fps = static_cast<uint32_t>(result->getInt("fps"));
@@ -699,48 +783,128 @@ void DatabaseConnection::writePlayerRatings(
             return;
         }
 
-        _connection->setAutoCommit(false);
+        // The ratings as they should be.
+        std::map<uint32_t, UserRating> ratings = userRatings(gameMode, players, activeRanks, allTimeRanks);
 
-        try
+        // The ratings as they are. Rows with null values never match.
+        std::map<uint32_t, UserRating> storedRatings;
+        std::set<uint32_t> invalidRows;
         {
-            // Remove old entries.
-            std::unique_ptr<sql::PreparedStatement> removeStmt(
-                _connection->prepareStatement("DELETE FROM user_ratings WHERE ladder_id = ?")
-            );
-            removeStmt->setUInt(1, ladderId);
-            removeStmt->execute();
-            Log::info() << "Removed old entries from 'user_ratings'.";
-
-            // Prepare statement to save user data.
-            std::unique_ptr<sql::PreparedStatement> insertStmt(
+            std::unique_ptr<sql::PreparedStatement> selectStmt(
                 _connection->prepareStatement(R"SQL(
-                    INSERT INTO user_ratings
-                    (user_id, ladder_id, rating, deviation, elo_rank, alltime_rank, rated_games, active, created_at, updated_at)
-                    VALUES (?, ?, ?, ?, ?, ?, ?, ?, NOW(), NOW())
+                    SELECT user_id, rating, deviation, elo_rank, alltime_rank, rated_games, active,
+                        (rating IS NULL OR deviation IS NULL OR elo_rank IS NULL OR alltime_rank IS NULL
+                         OR rated_games IS NULL OR active IS NULL) AS incomplete
+                    FROM user_ratings
+                    WHERE ladder_id = ?
                 )SQL")
             );
+            selectStmt->setUInt(1, ladderId);
+            std::unique_ptr<sql::ResultSet> result(selectStmt->executeQuery());
+
+            while (result->next())
+            {
+                uint32_t userId = result->getUInt("user_id");
+                UserRating rating;
+                rating.rating = result->getInt("rating");
+                rating.deviation = result->getInt("deviation");
+                rating.eloRank = result->getUInt("elo_rank");
+                rating.allTimeRank = result->getUInt("alltime_rank");
+                rating.ratedGames = result->getUInt("rated_games");
+                rating.active = result->getBoolean("active");
+
+                // Same user twice or incomplete.
+                if (!storedRatings.emplace(userId, rating).second || result->getBoolean("incomplete"))
+                {
+                    invalidRows.insert(userId);
+                }
+            }
+        }
+
+        // Only rows which changed are replaced. Rows of users, who are no longer part of the
+        // ladder, are removed.
+        std::set<uint32_t> removedRows = invalidRows;
+        std::vector<std::pair<uint32_t, UserRating>> insertedRows;
+
+        for (const auto &[userId, rating] : storedRatings)
+        {
+            auto it = ratings.find(userId);
+            if (it == ratings.end() || !(it->second == rating))
+            {
+                removedRows.insert(userId);
+            }
+        }
 
-            for (uint32_t userId : players.userIds())
+        for (const auto &[userId, rating] : ratings)
+        {
+            auto it = storedRatings.find(userId);
+            if (it == storedRatings.end() || !(it->second == rating) || invalidRows.contains(userId))
             {
-                const Player &player = players[userId];
-                uint32_t gameCount = player.gameCount();
-                factions::Faction faction = player.getBestFaction(false);
+                insertedRows.emplace_back(userId, rating);
+            }
+        }
+
+        Log::info() << insertedRows.size() << " of " << ratings.size() << " ratings have changed. Replacing or removing "
+                    << removedRows.size() << " rows in 'user_ratings'.";
 
-                if (!player.isActive(faction) || gameMode == gamemodes::Blitz2v2)
+        _connection->setAutoCommit(false);
+
+        try
+        {
+            const size_t chunkSize = 500;
+
+            // Remove changed and outdated entries.
+            auto removeIt = removedRows.begin();
+            while (removeIt != removedRows.end())
+            {
+                std::vector<uint32_t> chunk;
+                std::stringstream query;
+                query << "DELETE FROM user_ratings WHERE ladder_id = ? AND user_id IN (";
+
+                for (size_t i = 0; i < chunkSize && removeIt != removedRows.end(); ++i, ++removeIt)
                 {
-                    // Try to get any rating.
-                    faction = factions::Combined;
+                    query << ((i > 0) ? "," : "") << "?";
+                    chunk.push_back(*removeIt);
                 }
 
-                insertStmt->setUInt(1, userId);
-                insertStmt->setUInt(2, ladderId);
-                insertStmt->setInt(3, static_cast<int>(std::round(player.elo(faction))));
-                insertStmt->setInt(4, static_cast<int>(std::round(player.deviation(faction))));
-                insertStmt->setUInt(5, activeRanks.contains(userId) ? activeRanks[userId] : 0);
-                insertStmt->setUInt(6, allTimeRanks.contains(userId) ? allTimeRanks[userId] : 0);
-                insertStmt->setUInt(7, gameCount);
-                insertStmt->setBoolean(8, player.isActive());
+                query << ");";
+
+                std::unique_ptr<sql::PreparedStatement> removeStmt(_connection->prepareStatement(query.str()));
+                removeStmt->setUInt(1, ladderId);
+                for (size_t i = 0; i < chunk.size(); i++)
+                {
+                    removeStmt->setUInt(i + 2, chunk[i]);
+                }
+                removeStmt->execute();
+            }
+
+            // Insert new and changed entries, many rows at once.
+            for (size_t first = 0; first < insertedRows.size(); first += chunkSize)
+            {
+                size_t count = std::min(chunkSize, insertedRows.size() - first);
+                std::stringstream query;
+                query << "INSERT INTO user_ratings "
+                      << "(user_id, ladder_id, rating, deviation, elo_rank, alltime_rank, rated_games, active, created_at, updated_at) VALUES ";
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    query << ((i > 0) ? "," : "") << "(?, ?, ?, ?, ?, ?, ?, ?, NOW(), NOW())";
+                }
 
+                std::unique_ptr<sql::PreparedStatement> insertStmt(_connection->prepareStatement(query.str()));
+                for (size_t i = 0; i < count; i++)
+                {
+                    const auto &[userId, rating] = insertedRows[first + i];
+                    unsigned int parameter = static_cast<unsigned int>(i * 8);
+                    insertStmt->setUInt(parameter + 1, userId);
+                    insertStmt->setUInt(parameter + 2, ladderId);
+                    insertStmt->setInt(parameter + 3, rating.rating);
+                    insertStmt->setInt(parameter + 4, rating.deviation);
+                    insertStmt->setUInt(parameter + 5, rating.eloRank);
+                    insertStmt->setUInt(parameter + 6, rating.allTimeRank);
+                    insertStmt->setUInt(parameter + 7, rating.ratedGames);
+                    insertStmt->setBoolean(parameter + 8, rating.active);
+                }
                 insertStmt->execute();
             }
 
@@ -762,56 +926,3 @@ void DatabaseConnection::writePlayerRatings(
     }
 }
 
-/*!
- */
-void DatabaseConnection::crunchDuplicates(std::map<uint32_t, std::set<uint32_t>> &duplicates)
-{
-    // Unbalanced graph.
-    std::map<uint32_t, std::set<uint32_t>> adj;
-    for (const auto &kv : duplicates)
-    {
-        uint32_t k = kv.first;
-        adj[k];
-        for (uint32_t v : kv.second)
-        {
-            adj[k].insert(v);
-            adj[v].insert(k);
-        }
-    }
-
-    std::set<uint32_t> visited;
-    std::map<uint32_t, std::set<uint32_t>> result;
-
-    for (const auto &node : adj)
-    {
-        uint32_t start = node.first;
-        if (visited.count(start)) continue;
-
-        std::vector<uint32_t> stack = { start };
-        std::set<uint32_t> component;
-
-        while (!stack.empty())
-        {
-            uint32_t u = stack.back();
-            stack.pop_back();
-            if (visited.insert(u).second)
-            {
-                component.insert(u);
-                for (uint32_t w : adj[u])
-                {
-                    if (!visited.count(w)) stack.push_back(w);
-                }
-            }
-        }
-
-        if (!component.empty())
-        {
-            uint32_t rep = *component.begin();
-            std::set<uint32_t> others = component;
-            others.erase(rep);
-            result[rep] = std::move(others);
-        }
-    }
-
-    duplicates = result;
-}
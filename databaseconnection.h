@@ -1,6 +1,7 @@
  
 #pragma once
 
+#include <functional>
 #include <set>
 #include <unordered_set>
 
@@ -10,58 +11,83 @@
 #include <cppconn/resultset.h>
 #include <nlohmann/json.hpp>
 
+#include "gamesource.h"
 #include "logging.h"
 #include "options.h"
 #include "player.h"
 
-class DatabaseConnection
+/*!
+ * Games and users from the cncnet database. Ratings are written to table user_ratings.
+ */
+class DatabaseConnection : public GameSource
 {
 public:
-    //! Constructor. Establishes a connection. The ladder has to fixed and can't be changed later on.
+    //! Constructor. Establishes a connection for the ladder given by the options.
     DatabaseConnection(const Options &options);
 
+    //! Switch to another ladder. Users, aliases and duplicates loaded so far are kept and
+    //! won't be queried again.
+    void setLadder(const std::string &abbreviation) override;
+
     //! Check if the connection is established.
-    bool isEstablished() const;
+    bool isEstablished() const override;
 
     //! Check if the given ladder exists.
-    bool ladderExists(const std::string &abbreviation) const;
+    bool ladderExists(const std::string &abbreviation) const override;
 
     //! Get the ladder which is being worked on.
     const std::string& ladder() const;
 
-    //! Remove a duplicate.
-    void removeDuplicate(std::map<uint32_t, std::set<uint32_t> > &duplicates, uint32_t userId);
-
     //! This returns the exact duplicates as shown on the website.
     std::set<uint32_t> getWebLikeDuplicateAccounts(uint32_t userId);
 
+    //! Same as above for many users at once. Only needs a few queries instead of two per user.
+    std::map<uint32_t, std::set<uint32_t>> getWebLikeDuplicateAccounts(const std::set<uint32_t> &userIds) override;
+
     //! Load a player by its alias. Only used to process tournament games with players, who never
     //! played quick match.
-    uint32_t loadPlayerFromAlias(const std::string &alias, Players &players);
+    uint32_t loadPlayerFromAlias(const std::string &alias, Players &players) override;
 
     //! Load alias from database for the given user id.
     std::string loadAlias(uint32_t userId);
 
+    //! Load the aliases of all given users. Users without alias are not part of the result.
+    std::map<uint32_t, std::string> loadAliases(const std::set<uint32_t> &userIds) override;
+
     //! Load all the users with the given user ids and create players. Basically only load the
     //! alias for each player.
-    void loadUsers(const std::set<uint32_t> &userIds, Players &players);
+    void loadUsers(const std::set<uint32_t> &userIds, Players &players) override;
 
-    //! Add all recent games from the database. The player id won't be set for the games.
-    std::map<uint32_t, Game> fetchGames();
+    //! Add all games from the database, which have been added or modified after the given watermark.
+    //! All games are fetched if the watermark is empty. The watermark is set to the latest game
+    //! fetched. The player id won't be set for the games. All rules of the filter besides the
+    //! map rule are part of the query. The player count is only checked for too few players.
+    //! The ids of rejected games are fetched by a separate aggregate query.
+    std::map<uint32_t, Game> fetchGames(const GameFilter &filter, const GameWatermark &since, GameWatermark &watermark,
+                                        std::map<uint32_t, GameFilter::Rejection> &rejectedGames) override;
 
     //! Get a map to get the primary user id (value) for each user (key):
-    std::unordered_map<uint32_t, uint32_t> duplicateToPrimaryMapping(const std::map<uint32_t, uint32_t> userIds);
-
-    //! Return a map with the key being the duplicate account and the value being the primary account.
-    std::unordered_map<uint32_t, uint32_t> cncnetDuplicateMapping(const std::map<uint32_t, uint32_t> &userIds);
+    std::unordered_map<uint32_t, uint32_t> duplicateToPrimaryMapping(const std::map<uint32_t, uint32_t> userIds) override;
 
     //! Write data to table user_ratings;
-    void writePlayerRatings(gamemodes::GameMode gameMode, const Players &players, std::map<uint32_t, uint32_t> activeRanks, std::map<uint32_t, uint32_t> allTimeRanks);
-
-    //! Create the transitive closure for all duplicates.
-    void crunchDuplicates(std::map<uint32_t, std::set<uint32_t>> &duplicates);
+    void writePlayerRatings(gamemodes::GameMode gameMode, const Players &players, std::map<uint32_t, uint32_t> activeRanks, std::map<uint32_t, uint32_t> allTimeRanks) override;
 
 private:
+    //! Execute a query for chunks of ids. The query has to end with "IN (", the placeholders
+    //! for the ids are added. The handler is called for each row of the results.
+    void queryInChunks(const std::string &query, const std::set<uint32_t> &ids, const std::function<void(sql::ResultSet&)> &handler);
+
+    //! SQL expression, which evaluates to the reason a game is rejected by the rules about the
+    //! game itself (0 if the game is accepted). Refers to table game_reports.
+    static std::string rejectionExpression();
+
+    //! SQL condition, which is true if the participants of a game are accepted by the filter.
+    //! Refers to table games.
+    static std::string participantsCondition(const GameFilter &filter);
+
+    //! Make sure the aliases of the given users are cached.
+    void cacheAliases(const std::set<uint32_t> &userIds);
+
     //! Is the connection ready?
     bool _ready;
 
@@ -77,4 +103,10 @@ private:
     //! Adding tournament games preloads players with alias. Used to not warn if player names already
     //! exist.
     bool _tournamtGamesAdded;
+
+    //! Alias of each user loaded so far. Empty if the user has no alias.
+    std::map<uint32_t, std::string> _aliases;
+
+    //! Duplicates of each user found by recent ip so far.
+    std::map<uint32_t, std::set<uint32_t>> _webLikeDuplicates;
 };
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "decaytable.h"
+#include "rating.h"
+
+/*!
+ */
+DecayTable::DecayTable(double factor) :
+    _factor(factor)
+{
+    std::vector<double> deviations(trajectoryCount);
+    double nextDay = Rating::decayStep(minDeviation, factor);
+    for (size_t i = 0; i < trajectoryCount; i++)
+    {
+        deviations[i] = minDeviation + (nextDay - minDeviation) * i / trajectoryCount;
+    }
+
+    while (true)
+    {
+        _trajectories.insert(_trajectories.end(), deviations.begin(), deviations.end());
+        if (deviations.front() > glicko::initialDeviation)
+        {
+            break;
+        }
+
+        for (double &deviation : deviations)
+        {
+            deviation = Rating::decayStep(deviation, factor);
+        }
+    }
+}
+
+/*!
+ */
+const DecayTable& DecayTable::forGameMode(gamemodes::GameMode gameMode)
+{
+    // Ladders are processed in parallel.
+    static std::mutex mutex;
+    static std::map<double, std::unique_ptr<DecayTable>> tables;
+
+    // A sweep tries several factors for the same game mode.
+    double factor = gamemodes::decayFactor(gameMode);
+
+    // Needed for each player, so the last table of each thread is kept. Tables are never removed.
+    thread_local const DecayTable *lastTable = nullptr;
+    if (lastTable != nullptr && lastTable->_factor == factor)
+    {
+        return *lastTable;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::unique_ptr<DecayTable> &table = tables[factor];
+    if (table == nullptr)
+    {
+        table = std::make_unique<DecayTable>(factor);
+    }
+
+    lastTable = table.get();
+    return *table;
+}
+
+/*!
+ */
+double DecayTable::deviationAfter(double deviation, int days) const
+{
+    if (deviation < minDeviation)
+    {
+        // Left of the trajectory. Decay until it is reached.
+        for (; days > 0 && deviation < minDeviation; days--)
+        {
+            deviation = Rating::decayStep(deviation, _factor);
+        }
+    }
+
+    if (days <= 0)
+    {
+        return deviation;
+    }
+
+    // Position of the deviation between the trajectories.
+    size_t index = static_cast<size_t>(std::upper_bound(_trajectories.begin(), _trajectories.end(), deviation) - _trajectories.begin()) - 1;
+    size_t target = index + static_cast<size_t>(days) * trajectoryCount;
+    if (target + 1 >= _trajectories.size())
+    {
+        // Beyond the initial deviation, which is the highest possible maximum.
+        return std::max(deviation, _trajectories.back());
+    }
+
+    double fraction = (deviation - _trajectories[index]) / (_trajectories[index + 1] - _trajectories[index]);
+
+    return _trajectories[target] + fraction * (_trajectories[target + 1] - _trajectories[target]);
+}
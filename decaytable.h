@@ -0,0 +1,48 @@
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "gamemode.h"
+
+/*!
+ * Deviation of a rating, which is decayed for several days in a row. Decaying is a fixed
+ * function of the deviation, so the deviation follows the same trajectory for everyone. The
+ * trajectory is computed once per game mode and several days of decay are looked up instead
+ * of applying the decay day by day.
+ */
+class DecayTable
+{
+public:
+    //! Lowest deviation (elo) covered by the table. Lower deviations are decayed day by day.
+    static constexpr double minDeviation = 10.0;
+
+    //! Number of trajectories. They start evenly spaced between minDeviation and the deviation
+    //! a day later, which makes interpolating between them precise enough.
+    static constexpr size_t trajectoryCount = 32;
+
+    //! Constructor. Computes the trajectories from minDeviation up to the initial deviation.
+    explicit DecayTable(double factor);
+
+    //! The table of the decay factor in use for the given game mode. Computed on first use.
+    static const DecayTable& forGameMode(gamemodes::GameMode gameMode);
+
+    //! Largest difference (elo) of deviationAfter() from decaying day by day.
+    static constexpr double tolerance = 1e-5;
+
+    //! Deviation (elo) after decaying the given deviation for the given number of days. Not
+    //! clamped at the maximum deviation, which is left to the caller. Deviations between two
+    //! trajectories are interpolated linearly, which is off by less than the tolerance.
+    double deviationAfter(double deviation, int days) const;
+
+private:
+    //! Decay factor of the game mode.
+    double _factor;
+
+    //! Deviation of all trajectories after each day, day by day. Within a day, the trajectories
+    //! are ordered by their start value, so all values are in ascending order. The same trajectory
+    //! on the next day is trajectoryCount values later. Ends beyond the initial deviation.
+    std::vector<double> _trajectories;
+
+}; // class DecayTable
@@ -0,0 +1,110 @@
+#include <array>
+#include <sstream>
+
+#include "engineparameters.h"
+#include "rating.h"
+
+/*!
+ */
+EngineParameters EngineParameters::defaults(gamemodes::GameMode gameMode)
+{
+    EngineParameters parameters;
+
+    parameters.gameMode = gameMode;
+    parameters.tau = glicko::tau;
+    parameters.initialVolatility = glicko::initialVolatility;
+    parameters.exponentFactor2v2 = glicko::exponentFactor2v2;
+    parameters.decayFactor = (gameMode == gamemodes::YurisRevenge) ? 2.5 : 3.5;
+    parameters.maxDeviationAfterActive = (gameMode == gamemodes::YurisRevenge) ? 150.0 : 175.0;
+    parameters.activeThresholdBase = 65.0;
+    parameters.activeThresholdMax = 95.0;
+    parameters.inactiveThresholdOffset = 20.0;
+
+    return parameters;
+}
+
+/*!
+ */
+const EngineParameters& EngineParameters::current(gamemodes::GameMode gameMode)
+{
+    const std::optional<EngineParameters> &parameters = threadParameters();
+    if (parameters.has_value() && parameters->gameMode == gameMode)
+    {
+        return *parameters;
+    }
+
+    // Called for every player each day, so the defaults are only put together once.
+    static const std::array<EngineParameters, gamemodes::count()> defaultParameters = []() {
+        std::array<EngineParameters, gamemodes::count()> result;
+        for (gamemodes::GameMode mode : gamemodes::list())
+        {
+            result[mode] = defaults(mode);
+        }
+        return result;
+    }();
+    static const EngineParameters unknownParameters = defaults(gamemodes::Unknown);
+
+    return (gameMode >= 0 && gameMode < gamemodes::count()) ? defaultParameters[gameMode] : unknownParameters;
+}
+
+/*!
+ */
+const EngineParameters& EngineParameters::current()
+{
+    const std::optional<EngineParameters> &parameters = threadParameters();
+    return parameters.has_value() ? *parameters : current(gamemodes::Unknown);
+}
+
+/*!
+ */
+std::optional<EngineParameters>& EngineParameters::threadParameters()
+{
+    thread_local std::optional<EngineParameters> parameters;
+    return parameters;
+}
+
+/*!
+ */
+const std::vector<std::pair<std::string, double EngineParameters::*>>& EngineParameters::fields()
+{
+    static const std::vector<std::pair<std::string, double EngineParameters::*>> fields = {
+        { "tau", &EngineParameters::tau },
+        { "initialVolatility", &EngineParameters::initialVolatility },
+        { "exponentFactor2v2", &EngineParameters::exponentFactor2v2 },
+        { "decayFactor", &EngineParameters::decayFactor },
+        { "maxDeviationAfterActive", &EngineParameters::maxDeviationAfterActive },
+        { "activeThresholdBase", &EngineParameters::activeThresholdBase },
+        { "activeThresholdMax", &EngineParameters::activeThresholdMax },
+        { "inactiveThresholdOffset", &EngineParameters::inactiveThresholdOffset }
+    };
+
+    return fields;
+}
+
+/*!
+ */
+bool EngineParameters::set(const std::string &name, double value)
+{
+    for (const auto &[fieldName, field] : fields())
+    {
+        if (fieldName == name)
+        {
+            this->*field = value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*!
+ */
+std::string EngineParameters::toString() const
+{
+    std::ostringstream stream;
+    for (const auto &[name, field] : fields())
+    {
+        stream << (stream.tellp() > 0 ? ", " : "") << name << " " << this->*field;
+    }
+    return stream.str();
+}
@@ -0,0 +1,66 @@
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gamemode.h"
+
+/*!
+ * Tunable parameters of the rating engine. The defaults have been set by hand after evaluating
+ * thousands of games. Ratings are computed with the defaults of the game mode, unless other
+ * parameters have been set for the calling thread, which is how a sweep tries other values.
+ */
+struct EngineParameters
+{
+    //! Game mode the parameters are meant for.
+    gamemodes::GameMode gameMode = gamemodes::Unknown;
+
+    //! The system constant of Glicko-2.
+    double tau = 0.0;
+
+    //! Volatility of new ratings.
+    double initialVolatility = 0.0;
+
+    //! Exponent to determine a players share of a win/loss in a 2v2 game.
+    double exponentFactor2v2 = 0.0;
+
+    //! Speed of the decay. Lower values decay faster.
+    double decayFactor = 0.0;
+
+    //! Maximum deviation (elo) a player can get after having been active.
+    double maxDeviationAfterActive = 0.0;
+
+    //! Deviation threshold (elo) to become active is activeThresholdBase + sqrt(|1500 - elo|),
+    //! but at most activeThresholdMax.
+    double activeThresholdBase = 0.0;
+    double activeThresholdMax = 0.0;
+
+    //! Added to the threshold to become active to get the threshold to become inactive.
+    double inactiveThresholdOffset = 0.0;
+
+    //! The defaults of the given game mode.
+    static EngineParameters defaults(gamemodes::GameMode gameMode);
+
+    //! Parameters in use by the calling thread for the given game mode.
+    static const EngineParameters& current(gamemodes::GameMode gameMode);
+
+    //! Parameters in use by the calling thread, which don't depend on the game mode.
+    static const EngineParameters& current();
+
+    //! Parameters set for the calling thread. Not set by default, which means the defaults of
+    //! each game mode are used. Threads working for another thread need to take these over.
+    static std::optional<EngineParameters>& threadParameters();
+
+    //! Names of all tunable parameters along with the member.
+    static const std::vector<std::pair<std::string, double EngineParameters::*>>& fields();
+
+    //! Set a parameter by name. Returns false if there is no parameter with that name.
+    bool set(const std::string &name, double value);
+
+    //! Short description used for logging.
+    std::string toString() const;
+
+}; // struct EngineParameters
@@ -62,7 +62,7 @@ Faction fromName(const std::string &name)
  */
 SpecialFaction specialFactionFromName(const std::string &name)
 {
-    static std::map<std::string, SpecialFaction> factions = {
+    static const std::map<std::string, SpecialFaction> factions = {
         { "iraq", SpecialFaction::Iraq },
         { "britain", SpecialFaction::Britain },
         { "france", SpecialFaction::France },
@@ -83,7 +83,7 @@ SpecialFaction specialFactionFromName(const std::string &name)
     }
     else
     {
-        return factions[lowered];
+        return factions.at(lowered);
     }
 }
 
@@ -2,22 +2,24 @@
 #include <cmath>
 #include <set>
 
+#include "binarystream.h"
 #include "blitzmap.h"
 #include "cplusplus.h"
 #include "game.h"
 #include "logging.h"
+#include "stringpool.h"
 #include "stringtools.h"
 
 /*!
  */
 Game::Game(uint32_t id, const std::string &map, uint32_t timestamp, uint32_t fps, uint32_t duration) :
     _id(id),
-    _mapName(map),
+    _mapName(stringpool::intern(map)),
     _timestamp(timestamp),
     _fps(fps),
     _seconds(duration)
 {
-    // Nothing to do.
+    setTimestamp(timestamp);
 }
 
 /*!
@@ -31,7 +33,21 @@ uint32_t Game::id() const
  */
 uint32_t Game::playerCount() const
 {
-    return static_cast<uint32_t>(_participants.size());
+    return _playerCount;
+}
+
+/*!
+ */
+std::span<Game::Participant> Game::participants()
+{
+    return std::span<Participant>(_participants.data(), _playerCount);
+}
+
+/*!
+ */
+std::span<const Game::Participant> Game::participants() const
+{
+    return std::span<const Participant>(_participants.data(), _playerCount);
 }
 
 /*!
@@ -40,7 +56,7 @@ void Game::determineWinner()
 {
     int result = 0;
 
-    for (Participant &participant : _participants)
+    for (Participant &participant : participants())
     {
         result += participant.hasWon ? 1 : -1;
     }
@@ -54,7 +70,7 @@ void Game::determineWinner()
     result = 0;
 
     // Try again based on points.
-    for (Participant &participant : _participants)
+    for (Participant &participant : participants())
     {
         result += (participant.points > 0) ? 1 : -1;
         participant.hasWon = participant.points > 0;
@@ -69,15 +85,14 @@ void Game::determineWinner()
 bool Game::isBot() const
 {
     uint32_t bot = dts::to_underlying(KnownPlayers::BlitzBot);
-    return std::find_if(_participants.begin(), _participants.end(),
-                        [bot](const Participant& p) { return p.userId == bot; }) != _participants.end();
+    return anyParticipant([bot](const Participant& p) { return p.userId == bot; });
 }
 
 /*!
  */
 bool Game::isVs(uint32_t player1, uint32_t player2) const
 {
-    if (_participants.size() != 2)
+    if (_playerCount != 2)
     {
         Log::warning() << "Not a 1v1 game.";
         return false;
@@ -105,16 +120,23 @@ void Game::addPlayer(
     double elo,
     double deviation)
 {
-    _participants.emplace_back(Participant{index, playerName, faction, hasWon, points, elo, deviation});
+    if (_playerCount == maxPlayers)
+    {
+        Log::warning() << "Game " << _id << " has more than " << maxPlayers << " players. Dropping '" << playerName << "'.";
+        _hasDroppedPlayers = true;
+        return;
+    }
+
+    _participants[_playerCount++] = Participant{index, stringpool::intern(playerName), points, static_cast<uint8_t>(faction), hasWon, elo, deviation};
 }
 
 /*!
  */
 uint32_t Game::userId(uint32_t index) const
 {
-    if (index >= static_cast<uint32_t>(_participants.size()))
+    if (index >= static_cast<uint32_t>(_playerCount))
     {
-        Log::error() << "Asking for player " << index << ", but maximum index is " << (_participants.size() - 1) << ".";
+        Log::error() << "Asking for player " << index << ", but maximum index is " << (_playerCount - 1) << ".";
         return 0;
     }
 
@@ -136,15 +158,15 @@ bool Game::hasWon(uint32_t index) const
 
 /*!
  */
-std::string Game::playerName(uint32_t index) const
+const std::string& Game::playerName(uint32_t index) const
 {
-    if (index >= static_cast<uint32_t>(_participants.size()))
+    if (index >= _playerCount)
     {
         Log::error() << "Player index " << index << " out of range in game " << _id << " while asking for name.";
-        return "";
+        return stringpool::get(0);
     }
 
-    return _participants[index].playerName;
+    return stringpool::get(_participants[index].playerName);
 }
 
 /*!
@@ -152,6 +174,7 @@ std::string Game::playerName(uint32_t index) const
 void Game::setTimestamp(uint32_t timestamp)
 {
     _timestamp = timestamp;
+    _day = static_cast<int32_t>(std::chrono::floor<std::chrono::days>(std::chrono::sys_seconds{std::chrono::seconds{timestamp}}).time_since_epoch().count());
 }
 
 /*!
@@ -165,47 +188,72 @@ uint32_t Game::timestamp() const
  */
 void Game::setLadderAbbreviation(const std::string &ladderAbbreviation)
 {
-    _ladderAbbreviation = ladderAbbreviation;
+    _ladderAbbreviation = stringpool::intern(ladderAbbreviation);
 }
 
 /*!
  */
-std::string Game::ladderAbbreviation() const
+const std::string& Game::ladderAbbreviation() const
 {
-    return _ladderAbbreviation;
+    return stringpool::get(_ladderAbbreviation);
 }
 
 /*!
  */
 void Game::setPlayer(uint32_t index, uint32_t userId)
 {
-    if (index >= _participants.size())
+    if (index >= _playerCount)
     {
         Log::error() << "Cannot set player with index " << index << " in game " << _id
-                     << ", because the game has only " << (_participants.size() + 1) << " players.";
+                     << ", because the game has only " << (_playerCount + 1) << " players.";
         return;
     }
 
     _participants[index].userId = userId;
+    _participants[index].playerSlot = std::numeric_limits<uint32_t>::max();
+}
+
+/*!
+ */
+void Game::setPlayerSlot(uint32_t index, uint32_t slot)
+{
+    if (index >= _playerCount)
+    {
+        Log::error() << "Cannot set slot of player with index " << index << " in game " << _id
+                     << ", because the game has only " << static_cast<uint32_t>(_playerCount) << " players.";
+        return;
+    }
+
+    _participants[index].playerSlot = slot;
+}
+
+/*!
+ */
+uint32_t Game::playerSlot(uint32_t index) const
+{
+    return (index < _playerCount) ? _participants[index].playerSlot : std::numeric_limits<uint32_t>::max();
 }
 
 /*!
  */
 std::chrono::year_month_day Game::date() const
 {
-    std::chrono::sys_seconds tp_since_epoch{std::chrono::seconds{_timestamp}};
-    std::chrono::sys_days days = std::chrono::floor<std::chrono::days>(tp_since_epoch);
-    return std::chrono::year_month_day{days};
+    return std::chrono::year_month_day{sysDate()};
 }
 
 /*!
  */
 std::chrono::sys_days Game::sysDate() const
 {
-    using namespace std::chrono;
-    auto date = this->date();
+    return std::chrono::sys_days{std::chrono::days{_day}};
+}
 
-    return sys_days{ year{ date.year() } / month{ date.month() } / day{ date.day() } };
+/*!
+ */
+std::chrono::sys_days Game::ratingDate(int timeShiftInHours) const
+{
+    std::chrono::sys_seconds endOfGame{std::chrono::seconds{static_cast<int64_t>(_timestamp) + _seconds}};
+    return std::chrono::floor<std::chrono::days>(endOfGame + std::chrono::hours(timeShiftInHours));
 }
 
 /*!
@@ -257,13 +305,26 @@ uint32_t Game::fps() const
  */
 factions::Faction Game::faction(uint32_t index) const
 {
-    if (index >= static_cast<uint32_t>(_participants.size()))
+    if (index >= static_cast<uint32_t>(_playerCount))
     {
         Log::error() << "Faction index of " << index << " is out of game for game " << _id << ".";
         return factions::UnknownFaction;
     }
 
-    return _participants[index].faction;
+    return static_cast<factions::Faction>(_participants[index].faction);
+}
+
+/*!
+ */
+int Game::points(uint32_t index) const
+{
+    if (index >= static_cast<uint32_t>(_playerCount))
+    {
+        Log::error() << "Points index of " << index << " is out of game for game " << _id << ".";
+        return 0;
+    }
+
+    return _participants[index].points;
 }
 
 /*!
@@ -284,19 +345,19 @@ uint32_t Game::map() const
  */
 void Game::setGameType(gametypes::GameType gameType)
 {
-    _gameType = gameType;
+    _gameType = static_cast<uint8_t>(gameType);
 }
 
 /*!
  */
 gametypes::GameType Game::gameType() const
 {
-    return _gameType;
+    return static_cast<gametypes::GameType>(_gameType);
 }
 
 void Game::setMapName(const std::string &mapName)
 {
-    _mapName = mapName;
+    _mapName = stringpool::intern(mapName);
 
     // Need to set the map index as well.
     int mapIndex = blitzmap::toIndex(mapName);
@@ -314,21 +375,21 @@ void Game::setMapName(const std::string &mapName)
 
 /*!
  */
-std::string Game::mapName() const
+const std::string& Game::mapName() const
 {
-    return _mapName;
+    return stringpool::get(_mapName);
 }
 
 /*!
  */
 bool Game::isValid() const
 {
-    if (_participants.size() == 4)
+    if (_playerCount == 4)
     {
         std::set<uint32_t> userIds;
 
         int result = 0;
-        for (size_t i = 0; i < _participants.size(); i++)
+        for (size_t i = 0; i < _playerCount; i++)
         {
             if (_participants[i].userId == 0)
             {
@@ -355,7 +416,7 @@ bool Game::isValid() const
         }
         return _id != 0 && _timestamp != 0;
     }
-    else if (_participants.size() == 2)
+    else if (_playerCount == 2)
     {
         if (_participants[0].userId == _participants[1].userId)
         {
@@ -389,6 +450,13 @@ bool Game::wasDisconnected() const
     return _wasDisconnected;
 }
 
+/*!
+ */
+bool Game::hasDroppedPlayers() const
+{
+    return _hasDroppedPlayers;
+}
+
 /*!
  */
 double Game::differenceForGreatestDefeat() const
@@ -401,7 +469,7 @@ double Game::differenceForGreatestDefeat() const
     double winnerElo = 0.0;
     double loserElo = 0.0;
 
-    for (const Participant &participant : _participants)
+    for (const Participant &participant : participants())
     {
         if (participant.hasWon)
         {
@@ -420,7 +488,7 @@ double Game::differenceForGreatestDefeat() const
  */
 bool Game::isUnderdogWin() const
 {
-    if (_participants.size() != 2)
+    if (_playerCount != 2)
     {
         Log::error() << "Underdog win is only viable for a 1v1 game.";
         return 0.0;
@@ -449,7 +517,7 @@ bool Game::hasValidResult() const
 
     int result = 0;
 
-    for (size_t i = 0; i < _participants.size(); i++)
+    for (size_t i = 0; i < _playerCount; i++)
     {
         result += _participants[i].hasWon ? 1 : -1;
     }
@@ -463,14 +531,14 @@ bool Game::hasValidResult() const
  */
 std::string Game::factionResult(bool winnerFirst) const
 {
-    if (_participants.size() != 2)
+    if (_playerCount != 2)
     {
         Log::error() << "Faction result is only viable for a 1v1 game.";
         return "";
     }
 
-    std::string faction1 = factions::letter(_participants[0].faction);
-    std::string faction2 = factions::letter(_participants[1].faction);
+    std::string faction1 = factions::letter(faction(0));
+    std::string faction2 = factions::letter(faction(1));
 
     if (_participants[0].hasWon)
     {
@@ -515,9 +583,9 @@ void Game::setRatingAndDeviation(uint32_t playerIndex, double rating, double dev
  */
 double Game::rating(uint32_t index) const
 {
-    if (index >= static_cast<uint32_t>(_participants.size()))
+    if (index >= static_cast<uint32_t>(_playerCount))
     {
-        Log::error() << "Index " << index << " is not within [0, " << (_participants.size() - 1) << "] while getting the players rating of a game.";
+        Log::error() << "Index " << index << " is not within [0, " << (_playerCount - 1) << "] while getting the players rating of a game.";
     }
 
     return _participants[index].elo;
@@ -527,7 +595,7 @@ double Game::rating(uint32_t index) const
  */
 double Game::ratingDifference() const
 {
-    if (_participants.size() != 2)
+    if (_playerCount != 2)
     {
         Log::error() << "Rating difference is only viable for a 1v1 game.";
         return 0.0;
@@ -539,9 +607,9 @@ double Game::ratingDifference() const
  */
 double Game::deviation(uint32_t index) const
 {
-    if (index >= static_cast<uint32_t>(_participants.size()))
+    if (index >= static_cast<uint32_t>(_playerCount))
     {
-        Log::error() << "Index " << index << " is not within [0, " << (_participants.size() - 1) << "] while getting the players deviation of a game.";
+        Log::error() << "Index " << index << " is not within [0, " << (_playerCount - 1) << "] while getting the players deviation of a game.";
     }
 
     return _participants[index].deviation;
@@ -551,7 +619,7 @@ double Game::deviation(uint32_t index) const
  */
 int Game::winnerIndex() const
 {
-    if (_participants.size() != 2)
+    if (_playerCount != 2)
     {
         Log::error() << "Only 1v1 games have a winner index.";
         return -1;
@@ -579,7 +647,7 @@ int Game::winnerIndex() const
 
 int Game::playerIndex(uint32_t playerId) const
 {
-    for (size_t i = 0; i < _participants.size(); i++)
+    for (size_t i = 0; i < _playerCount; i++)
     {
         if (_participants[i].userId == playerId)
         {
@@ -608,26 +676,26 @@ void Game::setIsDraw(bool isDraw)
  */
 factions::Setup Game::setup() const
 {
-    if (_participants.size() != 2)
+    if (_playerCount != 2)
     {
         Log::error() << "Factions setup is only viable for a 1v1 game.";
         return factions::Setup::UnknownSetup;
     }
 
-    return factions::fromFactions(_participants[0].faction, _participants[1].faction);
+    return factions::fromFactions(faction(0), faction(1));
 }
 
 /*!
  */
 uint32_t Game::mateIndex(uint32_t index) const
 {
-    if (_participants.size() != 4)
+    if (_playerCount != 4)
     {
         Log::error() << "Only 2v2 game has a mate.";
         return index;
     }
 
-    for (size_t i = 0; i < _participants.size(); i++)
+    for (size_t i = 0; i < _playerCount; i++)
     {
         if (i != index && _participants[i].hasWon == _participants[index].hasWon)
         {
@@ -650,7 +718,7 @@ std::pair<uint32_t, uint32_t> Game::opponentsIndices(uint32_t index) const
     bool isFirst = true;
     std::pair<uint32_t, uint32_t> result;
 
-    for (size_t i = 0; i < _participants.size(); i++)
+    for (size_t i = 0; i < _playerCount; i++)
     {
         if (_participants[i].hasWon != _participants[index].hasWon)
         {
@@ -670,3 +738,73 @@ std::pair<uint32_t, uint32_t> Game::opponentsIndices(uint32_t index) const
     Log::error() << "Opponents not found in game " << _id << ". This does not seems to be a valid 2v2 game.";
     return {index, index};
 }
+
+/*!
+ */
+void Game::writeState(BinaryWriter &writer) const
+{
+    writer.write(gameType());
+    writer.write(_id);
+    writer.write(_map);
+    writer.write(mapName());
+    writer.write(ladderAbbreviation());
+    writer.write(_timestamp);
+    writer.write(_seconds);
+    writer.write(_fps);
+    writer.write(_wasDisconnected);
+    writer.write(_isDraw);
+
+    writer.write(static_cast<uint64_t>(_playerCount));
+    for (uint32_t i = 0; i < _playerCount; i++)
+    {
+        writer.write(_participants[i].userId);
+        writer.write(playerName(i));
+        writer.write(faction(i));
+        writer.write(_participants[i].hasWon);
+        writer.write(_participants[i].points);
+    }
+}
+
+/*!
+ */
+void Game::readState(BinaryReader &reader)
+{
+    gametypes::GameType gameType = gametypes::Unknown;
+    std::string mapName;
+    std::string ladderAbbreviation;
+
+    reader.read(gameType);
+    reader.read(_id);
+    reader.read(_map);
+    reader.read(mapName);
+    reader.read(ladderAbbreviation);
+    reader.read(_timestamp);
+    setTimestamp(_timestamp);
+    reader.read(_seconds);
+    reader.read(_fps);
+    reader.read(_wasDisconnected);
+    reader.read(_isDraw);
+
+    _gameType = static_cast<uint8_t>(gameType);
+    _mapName = stringpool::intern(mapName);
+    _ladderAbbreviation = stringpool::intern(ladderAbbreviation);
+
+    uint64_t count = 0;
+    reader.read(count);
+    _playerCount = 0;
+    _hasDroppedPlayers = false;
+    for (uint64_t i = 0; i < count && reader.ok(); i++)
+    {
+        uint32_t userId = 0;
+        std::string playerName;
+        factions::Faction faction = factions::UnknownFaction;
+        bool hasWon = false;
+        int points = 0;
+        reader.read(userId);
+        reader.read(playerName);
+        reader.read(faction);
+        reader.read(hasWon);
+        reader.read(points);
+        addPlayer(userId, playerName, faction, hasWon, points, 0.0, 0.0);
+    }
+}
@@ -1,30 +1,55 @@
  
 #pragma once
 
+#include <array>
 #include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <span>
 
 #include "faction.h"
 #include "gametype.h"
 #include "knownplayers.h"
 
+// Forward declarations:
+class BinaryReader;
+class BinaryWriter;
+
+//! High-water mark of games fetched from the database. The highest game id and the
+//! latest modification time (seconds since 1/1/1970) seen so far.
+struct GameWatermark
+{
+    uint32_t gameId = 0;
+    uint32_t updatedAt = 0;
+
+    //! Check if no game has been seen yet.
+    bool isEmpty() const { return gameId == 0 && updatedAt == 0; }
+};
+
 /*!
  * Simple representation of a game. Does require an id, a map and a timestamp.
  * Frames per second (fps) and duration (in seconds) are optional.
+ *
+ * A game has a fixed size. Participants are stored inline and strings are interned (see
+ * stringpool), so games can be kept in a plain array.
  */
 class Game
 {
 public:
+    //! Maximum number of participants.
+    static const uint32_t maxPlayers = 4;
+
     struct Participant
     {
-        uint32_t userId;
-        std::string playerName;
-        factions::Faction faction;
-        bool hasWon;
-        int points;
-        double elo;
-        double deviation;
+        uint32_t userId = 0;
+        uint32_t playerName = 0; // Interned.
+        int32_t points = 0;
+        uint8_t faction = factions::UnknownFaction;
+        bool hasWon = false;
+        double elo = 0.0;
+        double deviation = 0.0;
+        uint32_t playerSlot = std::numeric_limits<uint32_t>::max(); // See Players::slot().
     };
 
     //! Constructor for a game.
@@ -39,7 +64,7 @@ public:
     //! Determine the winners based on points if no one of the participants has won.
     void determineWinner();
 
-    //! Add a player to the game.
+    //! Add a player to the game. Players beyond maxPlayers are dropped.
     void addPlayer(uint32_t index, const std::string &playerName, factions::Faction faction, bool hasWon, int points, double elo, double deviation);
 
     //! Result of a specific player. Index has to be 1 or 2.
@@ -48,6 +73,13 @@ public:
     //! Set the player id of a specific player.
     void setPlayer(uint32_t index, uint32_t userId);
 
+    //! Set where Players keeps the player with the given index (see Players::slot()), so the
+    //! player can be accessed without looking up the user id.
+    void setPlayerSlot(uint32_t index, uint32_t slot);
+
+    //! Get the slot of the player with the given index. Players::noSlot if not set.
+    uint32_t playerSlot(uint32_t index) const;
+
     //! Set the players. No sanity check is done. Player ids must be valid.
     void setPlayers(uint32_t player1, uint32_t player2);
 
@@ -67,7 +99,7 @@ public:
     bool hasWon(uint32_t index) const;
 
     //! Get name of player 1 or player 2.
-    std::string playerName(uint32_t index) const;
+    const std::string& playerName(uint32_t index) const;
 
     //! Set the timestamp (seconds sind 1/1/1970).
     void setTimestamp(uint32_t timestamp);
@@ -91,11 +123,14 @@ public:
     //! Get a players faction. 0 is player 1, 1 is player 2.
     factions::Faction faction(uint32_t index) const;
 
+    //! Get the points reported for a player.
+    int points(uint32_t index) const;
+
     //! Set the ladder abbreviation for this game.
     void setLadderAbbreviation(const std::string &ladderAbbreviation);
 
     //! Get the ladder abbreviation for this game.
-    std::string ladderAbbreviation() const;
+    const std::string& ladderAbbreviation() const;
 
     //! Set the map for this game.
     void setMap(uint32_t mapIndex);
@@ -107,7 +142,7 @@ public:
     void setMapName(const std::string &mapName);
 
     //! Get the map of this game.
-    std::string mapName() const;
+    const std::string& mapName() const;
 
     //! Set the type of this game.
     void setGameType(gametypes::GameType gameType);
@@ -121,6 +156,9 @@ public:
     //! Check if the game ended in a disconnect.
     bool wasDisconnected() const;
 
+    //! Check if more than maxPlayers players have been added. Such a game can't be rated.
+    bool hasDroppedPlayers() const;
+
     //! Is this a game against a bot?
     bool isBot() const;
 
@@ -148,6 +186,10 @@ public:
     //! Get the system date from the game.
     std::chrono::sys_days sysDate() const;
 
+    //! Get the rating period this game belongs to. That's the day the game ended, after
+    //! applying the given time shift.
+    std::chrono::sys_days ratingDate(int timeShiftInHours) const;
+
     //! Get the exact timestamp of the game.
     //std::tuple<std::chrono::year_month_day, std::chrono::hh_mm_ss<std::chrono::seconds>> dateTime() const;
 
@@ -179,6 +221,13 @@ public:
     //! Check if number of winning and losing players are equal.
     bool hasValidResult() const;
 
+    //! Write the game as fetched from the database. Ratings and deviations of the
+    //! participants are not included.
+    void writeState(BinaryWriter &writer) const;
+
+    //! Read a game written by writeState().
+    void readState(BinaryReader &reader);
+
     //! Outputs the rating in Glicko-1 format.
     friend inline std::ostream& operator<<(std::ostream& os, const Game& game)
     {
@@ -208,14 +257,14 @@ public:
            << std::setw(2) << time.minutes().count() << '.'
            << std::setw(2) << time.seconds().count() << ' ';
 
-        if (game._participants.size() == 2)
+        if (game._playerCount == 2)
         {
             const Participant &p0 = game._participants[0];
             const Participant &p1 = game._participants[1];
             os << game.factionResult()
                << " "
-               << p0.playerName << " [" << p0.userId<< "] (" << p0.elo << "/" << p0.deviation << ") vs "
-               << p1.playerName << " [" << p1.userId << "] (" << p1.elo << "/" << p1.deviation << ") on "
+               << game.playerName(0) << " [" << p0.userId<< "] (" << p0.elo << "/" << p0.deviation << ") vs "
+               << game.playerName(1) << " [" << p1.userId << "] (" << p1.elo << "/" << p1.deviation << ") on "
                << game.mapName() << ": ";
             if (game.isDraw())
             {
@@ -226,31 +275,31 @@ public:
                 os << (game.hasWon(0) ? "1" : "0") << "-" << (game.hasWon(1) ? "1" : "0");
             }
         }
-        else if (game._participants.size() == 4)
+        else if (game._playerCount == 4)
         {
             const Participant &p0 = game._participants[0];
-            os << p0.playerName << " [" << p0.userId << "] (" << p0.elo << "/" << p0.deviation << ") + ";
+            os << game.playerName(0) << " [" << p0.userId << "] (" << p0.elo << "/" << p0.deviation << ") + ";
             uint32_t mateIndex = game.mateIndex(0);
             // TODO: Check if valid.
             const Participant &p_mate = game._participants[mateIndex];
-            os << p_mate.playerName << " [" << p_mate.userId << "] (" << p_mate.elo << "/" << p_mate.deviation << ") vs ";
+            os << game.playerName(mateIndex) << " [" << p_mate.userId << "] (" << p_mate.elo << "/" << p_mate.deviation << ") vs ";
             uint32_t firstOpponent;
-            for (size_t i = 1; i < game._participants.size(); i++)
+            for (uint32_t i = 1; i < game._playerCount; i++)
             {
                 if (i != mateIndex)
                 {
                     firstOpponent = i;
                     const Participant &o1 = game._participants[firstOpponent];
-                    os << o1.playerName << " [" << o1.userId << "] (" << o1.elo << "/" << o1.deviation << ") + ";
+                    os << game.playerName(i) << " [" << o1.userId << "] (" << o1.elo << "/" << o1.deviation << ") + ";
                     break;
                 }
             }
-            for (size_t i = 1; i < game._participants.size(); i++)
+            for (uint32_t i = 1; i < game._playerCount; i++)
             {
                 if (i != mateIndex && i != firstOpponent)
                 {
                     const Participant &o2 = game._participants[i];
-                    os << o2.playerName << " [" << o2.userId << "] (" << o2.elo << "/" << o2.deviation << ") on ";
+                    os << game.playerName(i) << " [" << o2.userId << "] (" << o2.elo << "/" << o2.deviation << ") on ";
                     break;
                 }
             }
@@ -264,14 +313,14 @@ public:
     template<typename Predicate>
     bool allParticipants(Predicate pred) const
     {
-        return std::all_of(_participants.begin(), _participants.end(), pred);
+        return std::all_of(_participants.begin(), _participants.begin() + _playerCount, pred);
     }
 
     //! Check if the given predicate matches at least one participant.
     template<typename Predicate>
     bool anyParticipant(Predicate pred) const
     {
-        return std::any_of(_participants.begin(), _participants.end(), pred);
+        return std::any_of(_participants.begin(), _participants.begin() + _playerCount, pred);
     }
 
     //! Collect data from participants.
@@ -279,7 +328,7 @@ public:
     std::vector<T> collectFromParticipants(Func func) const
     {
         std::vector<T> result;
-        for (const auto& p : _participants)
+        for (const Participant &p : participants())
         {
             auto [value, include] = func(p);
             if (include)
@@ -291,24 +340,25 @@ public:
     }
 
 private:
-    //! Game type.
-    gametypes::GameType _gameType = gametypes::Unknown;
+    //! Participants, which have been added.
+    std::span<Participant> participants();
+    std::span<const Participant> participants() const;
 
     //! The game id. Uses the cncnet game id. Manually added tournament games start at 100.000.
     //! A game id of 0 indicates an invalid game.
     uint32_t _id = 0;
 
     //! The map this game was played on.
-    uint32_t _map;
+    uint32_t _map = 0;
 
-    //! Map name.
-    std::string _mapName;
+    //! Map name (interned).
+    uint32_t _mapName = 0;
 
-    //! The ladder abbreviation. This is usually the ladder we are processing, but it might
-    //! differ. Some games on the yr-ladder are actual ra2 games. On top of that, ra2-new-maps
+    //! The ladder abbreviation (interned). This is usually the ladder we are processing, but it
+    //! might differ. Some games on the yr-ladder are actual ra2 games. On top of that, ra2-new-maps
     //! are integrated into ra2 and we need to know which ladder to ask if the player name
     //! has to be resolved.
-    std::string _ladderAbbreviation;
+    uint32_t _ladderAbbreviation = 0;
 
     //! Number of seconds since 1/1/1970 UTC. Might deviate by a couple of hours for
     //! tournament games, but won't affect rating, because games are submitted in
@@ -316,12 +366,24 @@ private:
     //! properly
     uint32_t _timestamp = 0;
 
+    //! Day the game has been started (days since 1/1/1970). Derived from the timestamp.
+    int32_t _day = 0;
+
     //! Duration of the game in seconds. 0 if unknown.
     uint32_t _seconds = 0;
 
     //! The average fps count. 0 if unknown.
     uint32_t _fps = 0;
 
+    //! Game type.
+    uint8_t _gameType = gametypes::Unknown;
+
+    //! Number of participants.
+    uint8_t _playerCount = 0;
+
+    //! Set if participants have been dropped, because there were too many.
+    bool _hasDroppedPlayers = false;
+
     //! Did this game end in a disconnect?
     bool _wasDisconnected = false;
 
@@ -329,7 +391,7 @@ private:
     bool _isDraw = false;
 
     //! List of participants in this game.
-    std::vector<Participant> _participants;
+    std::array<Participant, maxPlayers> _participants;
 
 }; // class game
 
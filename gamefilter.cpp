@@ -0,0 +1,74 @@
+#include "blitzmap.h"
+#include "gamefilter.h"
+
+/*!
+ */
+GameFilter::GameFilter(gamemodes::GameMode gameMode) :
+    _gameMode(gameMode)
+{
+}
+
+/*!
+ */
+GameFilter::Rejection GameFilter::check(const Game &game) const
+{
+    if (game.playerCount() != playerCount() || game.hasDroppedPlayers())
+    {
+        return PlayerCount;
+    }
+
+    if (game.gameType() == gametypes::Quickmatch)
+    {
+        uint32_t duration = correctedDuration(game.duration(), game.fps());
+        if (duration != 0 && duration < minDuration)
+        {
+            return Duration;
+        }
+
+        if (game.fps() > 1 && game.fps() < minFps)
+        {
+            return LowFps;
+        }
+    }
+
+    if (!acceptsBots() && game.isBot())
+    {
+        return Bot;
+    }
+
+    if (onlyBlitzMaps() && blitzmap::toIndex(game.mapName()) == -1)
+    {
+        return Map;
+    }
+
+    return Accepted;
+}
+
+/*!
+ */
+uint32_t GameFilter::playerCount() const
+{
+    return gamemodes::playerCount(_gameMode);
+}
+
+/*!
+ */
+bool GameFilter::acceptsBots() const
+{
+    return _gameMode == gamemodes::Blitz;
+}
+
+/*!
+ */
+bool GameFilter::onlyBlitzMaps() const
+{
+    return _gameMode == gamemodes::Blitz;
+}
+
+/*!
+ */
+uint32_t GameFilter::correctedDuration(uint32_t duration, uint32_t fps)
+{
+    // Integer arithmetic, so the database computes exactly the same.
+    return (fps > 0) ? static_cast<uint32_t>(static_cast<uint64_t>(duration) * fps / 60) : duration;
+}
@@ -0,0 +1,56 @@
+
+#pragma once
+
+#include <cstdint>
+
+#include "game.h"
+#include "gamemode.h"
+
+/*!
+ * The rules, which games are rated at all. Every game is checked before computing ratings.
+ * Game sources apply the same rules while fetching, so most rejected games are never
+ * transferred or allocated. Sources may leave rules out, but must not reject more games.
+ */
+class GameFilter
+{
+public:
+    //! Why a game has been rejected. Ordered like the checks.
+    enum Rejection : uint8_t
+    {
+        Accepted = 0,
+        PlayerCount = 1,
+        Duration = 2,
+        LowFps = 3,
+        Bot = 4,
+        Map = 5
+    };
+
+    //! Quick match games shorter than this (seconds at 60 fps) are rejected. 0 means unknown.
+    static const uint32_t minDuration = 35;
+
+    //! Quick match games with less fps are rejected. Values of 0 and 1 mean unknown.
+    static const uint32_t minFps = 40;
+
+    //! Constructor. Rules for the given game mode.
+    GameFilter(gamemodes::GameMode gameMode);
+
+    //! Check a game. Returns the first rule the game violates.
+    Rejection check(const Game &game) const;
+
+    //! Number of players each game needs.
+    uint32_t playerCount() const;
+
+    //! Check if games with the blitz bot are accepted.
+    bool acceptsBots() const;
+
+    //! Check if only maps known by blitzmap are accepted.
+    bool onlyBlitzMaps() const;
+
+    //! Duration of a game in seconds at 60 fps.
+    static uint32_t correctedDuration(uint32_t duration, uint32_t fps);
+
+private:
+    //! The game mode.
+    gamemodes::GameMode _gameMode;
+
+}; // class GameFilter
@@ -1,5 +1,5 @@
 
-#include "cplusplus.h"
+#include "engineparameters.h"
 #include "gamemode.h"
 #include "rating.h"
 
@@ -97,43 +97,29 @@ uint32_t playerCount(GameMode gameMode)
  */
 double decayFactor(GameMode gameMode)
 {
-    if (gameMode == GameMode::YurisRevenge)
-    {
-        return 2.5;
-    }
-    else
-    {
-        return 3.5;
-    }
+    return EngineParameters::current(gameMode).decayFactor;
 }
 
 /*!
  */
 double maxDeviationAfterActive(GameMode gameMode)
 {
-    if (gameMode == GameMode::YurisRevenge)
-    {
-        return 150.0;
-    }
-    else
-    {
-        return 175.0;
-    }
+    return EngineParameters::current(gameMode).maxDeviationAfterActive;
 }
 
 /*!
  */
 double deviationThresholdActive(GameMode gameMode, double currentElo)
 {
-    dts::unused(gameMode);
-    return std::min(95.0, 65.0 + sqrt(abs(glicko::initialRating - currentElo)));
+    const EngineParameters &parameters = EngineParameters::current(gameMode);
+    return std::min(parameters.activeThresholdMax, parameters.activeThresholdBase + sqrt(abs(glicko::initialRating - currentElo)));
 }
 
 /*!
  */
 double deviationThresholdInactive(GameMode gameMode, double currentElo)
 {
-    return deviationThresholdActive(gameMode, currentElo) + 20.0;
+    return deviationThresholdActive(gameMode, currentElo) + EngineParameters::current(gameMode).inactiveThresholdOffset;
 }
 
 /*!
@@ -46,7 +46,8 @@ inline constexpr GameMode toGameMode(int i)
 //! Get the game type from a string.
 GameMode toGameMode(const std::string &name);
 
-//! Specific decay factor for each game mode.
+//! Specific decay factor for each game mode. This and the thresholds below are taken from the
+//! engine parameters in use, see EngineParameters.
 double decayFactor(GameMode gameMode);
 
 //! Deviation threshold to become active.
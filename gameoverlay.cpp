@@ -13,16 +13,16 @@
 /*!
  */
 void GameOverlay::loadTournamentGames(
-    DatabaseConnection &connection,
+    GameSource *source,
     const std::filesystem::path &file,
     Players &players,
     gamemodes::GameMode gameMode,
     const std::string &ladderAbbreviation,
-    std::map<uint32_t, Game> &games
+    GameStore &games
     )
 {
     static int tournamentGameNumber = 100000000;
-    static int currentFakeUserId    = 100000000;
+    static int currentFakeUserId    = firstFakeUserId;
 
     std::ifstream f(file);
     using json = nlohmann::json;
@@ -91,35 +91,37 @@ void GameOverlay::loadTournamentGames(
             factions::Faction faction2 = (jsonGame["f2"].get<std::string>() == std::string("a")) ? factions::Allied : factions::Soviet;
 
             uint32_t userId1 = players.userIdFromAlias(playerAlias1);
+            if (userId1 == 0 && source != nullptr)
+            {
+                userId1 = source->loadPlayerFromAlias(playerAlias1, players);
+            }
+
             if (userId1 == 0)
             {
-                userId1 = connection.loadPlayerFromAlias(playerAlias1, players);
-                if (userId1 == 0)
-                {
-                    // Need to create a player with a fake id.
-                    userId1 = currentFakeUserId++;
-                    Player player(userId1, 0, "?", gameMode);
-                    Log::info() << "Manually created player " << userId1 << " with alias " << playerAlias1 << ".";
-                    player.setAlias(playerAlias1);
-                    players.add(player, ladderAbbreviation);
-                }
+                // Need to create a player with a fake id.
+                userId1 = currentFakeUserId++;
+                Player player(userId1, 0, "?", gameMode);
+                Log::info() << "Manually created player " << userId1 << " with alias " << playerAlias1 << ".";
+                player.setAlias(playerAlias1);
+                players.add(player, ladderAbbreviation);
             }
 
             const Player &player1 = players[userId1];
 
             uint32_t userId2 = players.userIdFromAlias(playerAlias2);
+            if (userId2 == 0 && source != nullptr)
+            {
+                userId2 = source->loadPlayerFromAlias(playerAlias2, players);
+            }
+
             if (userId2 == 0)
             {
-                userId2 = connection.loadPlayerFromAlias(playerAlias2, players);
-                if (userId2 == 0)
-                {
-                    // Need to create a player with a fake id.
-                    userId2 = currentFakeUserId++;
-                    Player player(userId2, 0, "?", gameMode);
-                    player.setAlias(playerAlias2);
-                    Log::info() << "Manually created player " << userId2 << " with alias " << playerAlias2 << ".";
-                    players.add(player, ladderAbbreviation);
-                }
+                // Need to create a player with a fake id.
+                userId2 = currentFakeUserId++;
+                Player player(userId2, 0, "?", gameMode);
+                player.setAlias(playerAlias2);
+                Log::info() << "Manually created player " << userId2 << " with alias " << playerAlias2 << ".";
+                players.add(player, ladderAbbreviation);
             }
 
             const Player &player2 = players[userId2];
@@ -133,19 +135,22 @@ void GameOverlay::loadTournamentGames(
                 continue;
             }
 
-            std::pair<std::map<uint32_t, Game>::iterator, bool> finalGame =
-                games.emplace(tournamentGameNumber++, Game(tournamentGameNumber++, blitzmap::__shortNames[mapIndex], timestamp, 0, 0));
+            // Game ids have always been taken in steps of two. Kept, so ids don't change.
+            Game finalGame(tournamentGameNumber, blitzmap::__shortNames[mapIndex], timestamp, 0, 0);
+            tournamentGameNumber += 2;
 
-            finalGame.first->second.setGameType(gametypes::WorldSeries);
-            finalGame.first->second.setLadderAbbreviation(ladderAbbreviation);
-            finalGame.first->second.addPlayer(player1.userId(), playerAlias1, faction1, result == 1, 0, 0.0, 0.0);
-            finalGame.first->second.addPlayer(player2.userId(), playerAlias2, faction2, result == 2, 0, 0.0, 0.0);
+            finalGame.setGameType(gametypes::WorldSeries);
+            finalGame.setLadderAbbreviation(ladderAbbreviation);
+            finalGame.addPlayer(player1.userId(), playerAlias1, faction1, result == 1, 0, 0.0, 0.0);
+            finalGame.addPlayer(player2.userId(), playerAlias2, faction2, result == 2, 0, 0.0, 0.0);
             if (result == 0)
             {
-                finalGame.first->second.setIsDraw(true);
+                finalGame.setIsDraw(true);
             }
 
-            Log::info() << "Added tournament game: " << finalGame.first->second;
+            games.add(finalGame);
+
+            Log::info() << "Added tournament game: " << finalGame;
 
         } // for (auto& game : games)
 
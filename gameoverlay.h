@@ -3,7 +3,8 @@
 
 #include <filesystem>
 
-#include "databaseconnection.h"
+#include "gamesource.h"
+#include "gamestore.h"
 #include "players.h"
 
 /*!
@@ -14,8 +15,12 @@ class GameOverlay
 {
 
 public:
-    //! Load additional tournament games.
-    void loadTournamentGames(DatabaseConnection &connection, const std::filesystem::path &file, Players &players, gamemodes::GameMode gameMode, const std::string &ladderAbbreviation, std::map<uint32_t, Game> &games);
+    //! Players created for tournament games without an account get user ids starting here.
+    static const uint32_t firstFakeUserId = 100000000;
+
+    //! Load additional tournament games. Players, which are not known yet, are looked up in the
+    //! game source if one is given.
+    void loadTournamentGames(GameSource *source, const std::filesystem::path &file, Players &players, gamemodes::GameMode gameMode, const std::string &ladderAbbreviation, GameStore &games);
 
 
 }; // class GameOverlay
@@ -0,0 +1,527 @@
+#include <algorithm>
+
+#include "binarystream.h"
+#include "gameoverlay.h"
+#include "gamescache.h"
+#include "logging.h"
+#include "mappedfile.h"
+#include "players.h"
+
+namespace
+{
+
+//! Identifies games cache files.
+const char magic[8] = { 'E', 'L', 'O', 'G', 'A', 'M', 'E', 'S' };
+
+//! Bits of the game flags column.
+const uint8_t disconnectedFlag = 0x01;
+const uint8_t drawFlag = 0x02;
+
+//! Assigns an id to each distinct string.
+class StringTable
+{
+public:
+    //! Get the id of the given string. Adds the string if needed.
+    uint32_t id(const std::string &value)
+    {
+        auto [it, added] = _ids.try_emplace(value, static_cast<uint32_t>(_ids.size()));
+        if (added)
+        {
+            _characters.insert(_characters.end(), value.begin(), value.end());
+            _offsets.push_back(static_cast<uint32_t>(_characters.size()));
+        }
+        return it->second;
+    }
+
+    //! Write offsets (one more than strings) and characters.
+    void write(BinaryWriter &writer) const
+    {
+        writer.writeArray(_offsets);
+        writer.writeArray(_characters);
+    }
+
+private:
+    std::unordered_map<std::string, uint32_t> _ids;
+    std::vector<uint32_t> _offsets = { 0 };
+    std::vector<char> _characters;
+};
+
+//! Check if the given values can be used as offsets into an array of the given size.
+bool validOffsets(std::span<const uint32_t> offsets, size_t count, size_t size)
+{
+    return offsets.size() == count + 1 && offsets.front() == 0 && offsets.back() == size
+           && std::is_sorted(offsets.begin(), offsets.end());
+}
+
+}
+
+/*!
+ */
+void GamesCache::User::writeState(BinaryWriter &writer) const
+{
+    writer.write(userId);
+    writer.write(primaryUserId);
+    writer.write(account);
+    writer.write(alias);
+    writer.write(names);
+}
+
+/*!
+ */
+void GamesCache::User::readState(BinaryReader &reader)
+{
+    reader.read(userId);
+    reader.read(primaryUserId);
+    reader.read(account);
+    reader.read(alias);
+    reader.read(names);
+}
+
+/*!
+ */
+GamesCache::GamesCache(const std::string &ladderAbbreviation) :
+    _ladderAbbreviation(ladderAbbreviation)
+{
+}
+
+/*!
+ */
+bool GamesCache::load(const std::filesystem::path &file)
+{
+    if (!std::filesystem::exists(file))
+    {
+        return false;
+    }
+
+    MappedFile mappedFile;
+    if (!mappedFile.open(file) || !BinaryReader::checkHeader(mappedFile.data(), mappedFile.size(), file, magic, formatVersion))
+    {
+        return false;
+    }
+
+    BinaryReader reader(mappedFile.data() + BinaryReader::headerSize, mappedFile.size() - BinaryReader::headerSize);
+
+    std::string cachedLadder;
+    reader.read(cachedLadder);
+    if (cachedLadder != _ladderAbbreviation)
+    {
+        Log::warning() << "Games cache '" << file.string() << "' has been written for ladder '" << cachedLadder << "'.";
+        return false;
+    }
+
+    GameWatermark watermark;
+    reader.read(watermark.gameId);
+    reader.read(watermark.updatedAt);
+
+    std::map<uint32_t, Game> games;
+    bool gamesDecoded = decodeGames(reader, games);
+
+    std::span<const uint32_t> rejectedIds = reader.readArray<uint32_t>();
+    std::span<const uint8_t> rejections = reader.readArray<uint8_t>();
+
+    std::optional<std::pair<bool, bool>> duplicateMode;
+    reader.read(duplicateMode);
+    std::span<const uint32_t> duplicates = reader.readArray<uint32_t>();
+    std::span<const uint32_t> primaries = reader.readArray<uint32_t>();
+
+    std::vector<User> users;
+    reader.read(users);
+
+    if (!gamesDecoded || !reader.ok() || !reader.atEnd() || rejectedIds.size() != rejections.size() || duplicates.size() != primaries.size())
+    {
+        Log::warning() << "Games cache '" << file.string() << "' is incomplete.";
+        return false;
+    }
+
+    _watermark = watermark;
+    _games = std::move(games);
+    _encodedGames.reset();
+    _rejectedGames.clear();
+    for (size_t i = 0; i < rejectedIds.size(); i++)
+    {
+        _rejectedGames[rejectedIds[i]] = static_cast<GameFilter::Rejection>(rejections[i]);
+    }
+    _duplicateMode = duplicateMode;
+    _duplicateToPrimary.clear();
+    for (size_t i = 0; i < duplicates.size(); i++)
+    {
+        _duplicateToPrimary[duplicates[i]] = primaries[i];
+    }
+    _users = std::move(users);
+
+    Log::info() << "Loaded " << _games.size() << " games and " << _users.size() << " users from cache '" << file.string() << "'.";
+
+    return true;
+}
+
+/*!
+ */
+bool GamesCache::save(const std::filesystem::path &file) const
+{
+    BinaryWriter writer;
+    writer.write(_ladderAbbreviation);
+    writer.write(_watermark.gameId);
+    writer.write(_watermark.updatedAt);
+
+    writer.align(BinaryWriter::alignment);
+    if (_encodedGames.has_value())
+    {
+        writer.writeRaw(_encodedGames->data(), _encodedGames->size());
+    }
+    else
+    {
+        std::vector<char> encodedGames = encodeGames(_games);
+        writer.writeRaw(encodedGames.data(), encodedGames.size());
+    }
+
+    std::vector<uint32_t> rejectedIds;
+    std::vector<uint8_t> rejections;
+    rejectedIds.reserve(_rejectedGames.size());
+    rejections.reserve(_rejectedGames.size());
+    for (const auto &[gameId, rejection] : _rejectedGames)
+    {
+        rejectedIds.push_back(gameId);
+        rejections.push_back(rejection);
+    }
+
+    writer.writeArray(rejectedIds);
+    writer.writeArray(rejections);
+
+    // Sorted, so the same mapping always results in the same file.
+    std::vector<std::pair<uint32_t, uint32_t>> mapping(_duplicateToPrimary.begin(), _duplicateToPrimary.end());
+    std::sort(mapping.begin(), mapping.end());
+
+    std::vector<uint32_t> duplicates;
+    std::vector<uint32_t> primaries;
+    duplicates.reserve(mapping.size());
+    primaries.reserve(mapping.size());
+    for (const auto &[duplicate, primary] : mapping)
+    {
+        duplicates.push_back(duplicate);
+        primaries.push_back(primary);
+    }
+
+    writer.write(_duplicateMode);
+    writer.writeArray(duplicates);
+    writer.writeArray(primaries);
+    writer.write(_users);
+
+    if (!writer.saveToFile(file, magic, formatVersion))
+    {
+        return false;
+    }
+
+    Log::info() << "Saved " << count() << " games and " << _users.size() << " users to cache '" << file.string() << "'.";
+
+    return true;
+}
+
+/*!
+ */
+const GameWatermark& GamesCache::watermark() const
+{
+    return _watermark;
+}
+
+/*!
+ */
+size_t GamesCache::count() const
+{
+    return _encodedGames.has_value() ? _takenGames : _games.size();
+}
+
+/*!
+ */
+std::vector<uint32_t> GamesCache::update(std::map<uint32_t, Game> &&games, const std::map<uint32_t, GameFilter::Rejection> &rejectedGames,
+                                         const GameWatermark &watermark)
+{
+    std::vector<uint32_t> modifiedGames;
+
+    for (const auto &[gameId, rejection] : rejectedGames)
+    {
+        if (_games.erase(gameId) > 0)
+        {
+            Log::info() << "Game " << gameId << " has been modified after it had been fetched and is rejected now.";
+            modifiedGames.push_back(gameId);
+        }
+        _rejectedGames[gameId] = rejection;
+    }
+
+    for (auto &[gameId, game] : games)
+    {
+        _rejectedGames.erase(gameId);
+
+        std::map<uint32_t, Game>::iterator it = _games.find(gameId);
+        if (it == _games.end())
+        {
+            _games.emplace(gameId, std::move(game));
+            continue;
+        }
+
+        // Games modified within the same second as the watermark are fetched again. Only
+        // report actual changes.
+        BinaryWriter cached;
+        cached.write(it->second);
+        BinaryWriter fetched;
+        fetched.write(game);
+
+        if (cached.buffer() != fetched.buffer())
+        {
+            Log::info() << "Game " << gameId << " has been modified after it had been fetched.";
+            modifiedGames.push_back(gameId);
+            it->second = std::move(game);
+        }
+    }
+
+    _watermark = watermark;
+
+    // New games might involve new users and duplicates.
+    _duplicateMode.reset();
+    _duplicateToPrimary.clear();
+    _users.clear();
+
+    return modifiedGames;
+}
+
+/*!
+ */
+const std::map<uint32_t, GameFilter::Rejection>& GamesCache::rejectedGames() const
+{
+    return _rejectedGames;
+}
+
+/*!
+ */
+std::map<uint32_t, Game> GamesCache::takeGames()
+{
+    _encodedGames = encodeGames(_games);
+    _takenGames = _games.size();
+
+    std::map<uint32_t, Game> games;
+    games.swap(_games);
+    return games;
+}
+
+/*!
+ */
+bool GamesCache::isComplete() const
+{
+    return _duplicateMode.has_value() && !_users.empty();
+}
+
+/*!
+ */
+bool GamesCache::hasDuplicateMapping(bool cncnetDuplicates, bool noDuplicates) const
+{
+    return _duplicateMode == std::make_pair(cncnetDuplicates, noDuplicates);
+}
+
+/*!
+ */
+const std::unordered_map<uint32_t, uint32_t>& GamesCache::duplicateMapping() const
+{
+    return _duplicateToPrimary;
+}
+
+/*!
+ */
+void GamesCache::setDuplicateMapping(const std::unordered_map<uint32_t, uint32_t> &mapping, bool cncnetDuplicates, bool noDuplicates)
+{
+    _duplicateMode = std::make_pair(cncnetDuplicates, noDuplicates);
+    _duplicateToPrimary = mapping;
+}
+
+/*!
+ */
+void GamesCache::setPlayers(const Players &players)
+{
+    _users.clear();
+
+    for (uint32_t userId : players.userIds())
+    {
+        if (userId >= GameOverlay::firstFakeUserId)
+        {
+            continue;
+        }
+
+        const Player &player = players[userId];
+
+        User user;
+        user.userId = userId;
+        user.primaryUserId = player.primaryUserId();
+        user.account = player.account();
+        if (player.hasAlias())
+        {
+            user.alias = player.alias();
+        }
+        user.names = player.names();
+        _users.push_back(std::move(user));
+    }
+}
+
+/*!
+ */
+void GamesCache::restorePlayers(Players &players, gamemodes::GameMode gameMode) const
+{
+    for (const User &user : _users)
+    {
+        Player player(user.userId, user.primaryUserId, user.account, gameMode);
+        if (user.alias.has_value())
+        {
+            player.setAlias(*user.alias);
+        }
+
+        for (const auto &[ladder, names] : user.names)
+        {
+            for (const std::string &name : names)
+            {
+                player.addName(name, ladder);
+            }
+        }
+
+        players.add(player, _ladderAbbreviation);
+    }
+}
+
+/*!
+ */
+std::vector<char> GamesCache::encodeGames(const std::map<uint32_t, Game> &games)
+{
+    StringTable strings;
+
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> timestamps;
+    std::vector<uint32_t> durations;
+    std::vector<uint32_t> fps;
+    std::vector<uint32_t> maps;
+    std::vector<uint32_t> mapNames;
+    std::vector<uint32_t> ladders;
+    std::vector<uint8_t> gameTypes;
+    std::vector<uint8_t> flags;
+    std::vector<uint32_t> firstParticipants = { 0 };
+
+    std::vector<uint32_t> userIds;
+    std::vector<uint32_t> playerNames;
+    std::vector<uint8_t> factions;
+    std::vector<uint8_t> hasWon;
+    std::vector<int32_t> points;
+
+    for (const auto &[gameId, game] : games)
+    {
+        ids.push_back(game.id());
+        timestamps.push_back(game.timestamp());
+        durations.push_back(game.duration());
+        fps.push_back(game.fps());
+        maps.push_back(game.map());
+        mapNames.push_back(strings.id(game.mapName()));
+        ladders.push_back(strings.id(game.ladderAbbreviation()));
+        gameTypes.push_back(static_cast<uint8_t>(game.gameType()));
+        flags.push_back(static_cast<uint8_t>((game.wasDisconnected() ? disconnectedFlag : 0) | (game.isDraw() ? drawFlag : 0)));
+
+        for (uint32_t i = 0; i < game.playerCount(); i++)
+        {
+            userIds.push_back(game.userId(i));
+            playerNames.push_back(strings.id(game.playerName(i)));
+            factions.push_back(static_cast<uint8_t>(game.faction(i)));
+            hasWon.push_back(game.hasWon(i) ? 1 : 0);
+            points.push_back(game.points(i));
+        }
+
+        firstParticipants.push_back(static_cast<uint32_t>(userIds.size()));
+    }
+
+    BinaryWriter writer;
+    strings.write(writer);
+    writer.writeArray(ids);
+    writer.writeArray(timestamps);
+    writer.writeArray(durations);
+    writer.writeArray(fps);
+    writer.writeArray(maps);
+    writer.writeArray(mapNames);
+    writer.writeArray(ladders);
+    writer.writeArray(gameTypes);
+    writer.writeArray(flags);
+    writer.writeArray(firstParticipants);
+    writer.writeArray(userIds);
+    writer.writeArray(playerNames);
+    writer.writeArray(factions);
+    writer.writeArray(hasWon);
+    writer.writeArray(points);
+    writer.align(BinaryWriter::alignment);
+
+    return writer.buffer();
+}
+
+/*!
+ */
+bool GamesCache::decodeGames(BinaryReader &reader, std::map<uint32_t, Game> &games)
+{
+    reader.align(BinaryWriter::alignment);
+
+    std::span<const uint32_t> stringOffsets = reader.readArray<uint32_t>();
+    std::span<const char> characters = reader.readArray<char>();
+    std::span<const uint32_t> ids = reader.readArray<uint32_t>();
+    std::span<const uint32_t> timestamps = reader.readArray<uint32_t>();
+    std::span<const uint32_t> durations = reader.readArray<uint32_t>();
+    std::span<const uint32_t> fps = reader.readArray<uint32_t>();
+    std::span<const uint32_t> maps = reader.readArray<uint32_t>();
+    std::span<const uint32_t> mapNames = reader.readArray<uint32_t>();
+    std::span<const uint32_t> ladders = reader.readArray<uint32_t>();
+    std::span<const uint8_t> gameTypes = reader.readArray<uint8_t>();
+    std::span<const uint8_t> flags = reader.readArray<uint8_t>();
+    std::span<const uint32_t> firstParticipants = reader.readArray<uint32_t>();
+    std::span<const uint32_t> userIds = reader.readArray<uint32_t>();
+    std::span<const uint32_t> playerNames = reader.readArray<uint32_t>();
+    std::span<const uint8_t> factions = reader.readArray<uint8_t>();
+    std::span<const uint8_t> hasWon = reader.readArray<uint8_t>();
+    std::span<const int32_t> points = reader.readArray<int32_t>();
+    reader.align(BinaryWriter::alignment);
+
+    size_t gameCount = ids.size();
+    size_t participantCount = userIds.size();
+
+    if (!reader.ok()
+        || stringOffsets.empty() || !validOffsets(stringOffsets, stringOffsets.size() - 1, characters.size())
+        || timestamps.size() != gameCount || durations.size() != gameCount || fps.size() != gameCount
+        || maps.size() != gameCount || mapNames.size() != gameCount || ladders.size() != gameCount
+        || gameTypes.size() != gameCount || flags.size() != gameCount
+        || !validOffsets(firstParticipants, gameCount, participantCount)
+        || playerNames.size() != participantCount || factions.size() != participantCount
+        || hasWon.size() != participantCount || points.size() != participantCount)
+    {
+        return false;
+    }
+
+    std::vector<std::string> strings;
+    strings.reserve(stringOffsets.size() - 1);
+    for (size_t i = 0; i + 1 < stringOffsets.size(); i++)
+    {
+        strings.emplace_back(characters.data() + stringOffsets[i], stringOffsets[i + 1] - stringOffsets[i]);
+    }
+
+    auto isString = [&strings](uint32_t id) { return id < strings.size(); };
+    if (!std::all_of(mapNames.begin(), mapNames.end(), isString) || !std::all_of(ladders.begin(), ladders.end(), isString)
+        || !std::all_of(playerNames.begin(), playerNames.end(), isString))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < gameCount; i++)
+    {
+        Game game(ids[i], strings[mapNames[i]], timestamps[i], fps[i], durations[i]);
+        game.setMap(maps[i]);
+        game.setLadderAbbreviation(strings[ladders[i]]);
+        game.setGameType(static_cast<gametypes::GameType>(gameTypes[i]));
+        game.setWasDisconnected((flags[i] & disconnectedFlag) != 0);
+        game.setIsDraw((flags[i] & drawFlag) != 0);
+
+        for (uint32_t j = firstParticipants[i]; j < firstParticipants[i + 1]; j++)
+        {
+            game.addPlayer(userIds[j], strings[playerNames[j]], static_cast<factions::Faction>(factions[j]), hasWon[j] != 0, points[j], 0.0, 0.0);
+        }
+
+        games.emplace_hint(games.end(), ids[i], std::move(game));
+    }
+
+    return true;
+}
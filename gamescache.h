@@ -0,0 +1,133 @@
+
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "game.h"
+#include "gamefilter.h"
+#include "gamemode.h"
+
+// Forward declarations:
+class BinaryReader;
+class BinaryWriter;
+class Players;
+
+/*!
+ * Local copy of all games fetched from the database for one ladder, along with the
+ * duplicate mapping and the users involved. The watermark of the last fetch allows to
+ * only fetch games, which have been added or modified since. A complete cache allows to
+ * run without any database access at all.
+ *
+ * Games are stored column by column with interned strings, so the file is compact and
+ * can be decoded in a single pass. The file is memory mapped only to read it without
+ * copying. All games are decoded when loading, nothing is read lazily from the mapping.
+ */
+class GamesCache
+{
+public:
+    //! Bump this whenever the layout of the file changes.
+    static const uint32_t formatVersion = 3;
+
+    //! Constructor. Creates an empty cache for the given ladder.
+    GamesCache(const std::string &ladderAbbreviation);
+
+    //! Load the cache from the given file. Fails if the file does not exist or has been written
+    //! for another ladder.
+    bool load(const std::filesystem::path &file);
+
+    //! Save the cache to the given file.
+    bool save(const std::filesystem::path &file) const;
+
+    //! Watermark of the last fetch. Empty if nothing has been fetched yet.
+    const GameWatermark& watermark() const;
+
+    //! Number of cached games.
+    size_t count() const;
+
+    //! Merge fetched games into the cache and set the new watermark. Cached games, which have been
+    //! rejected by the filter now, are removed. Returns the ids of games, which had been cached
+    //! before and have been modified since. Drops the cached duplicate mapping and users, they
+    //! have to be set again.
+    std::vector<uint32_t> update(std::map<uint32_t, Game> &&games, const std::map<uint32_t, GameFilter::Rejection> &rejectedGames,
+                                 const GameWatermark &watermark);
+
+    //! Ids of all games rejected by the filter while fetching and the reasons.
+    const std::map<uint32_t, GameFilter::Rejection>& rejectedGames() const;
+
+    //! Move all games out of the cache. The games are still written by save().
+    std::map<uint32_t, Game> takeGames();
+
+    //! Check if the cache holds a duplicate mapping and users, i.e. if it can be used
+    //! without database access.
+    bool isComplete() const;
+
+    //! Check if the duplicate mapping has been created with the given options.
+    bool hasDuplicateMapping(bool cncnetDuplicates, bool noDuplicates) const;
+
+    //! Mapping of each user id to its primary user id.
+    const std::unordered_map<uint32_t, uint32_t>& duplicateMapping() const;
+
+    //! Set the mapping of each user id to its primary user id and the options used to create it.
+    void setDuplicateMapping(const std::unordered_map<uint32_t, uint32_t> &mapping, bool cncnetDuplicates, bool noDuplicates);
+
+    //! Remember all players loaded from the database. Players created for tournament games
+    //! without an account are skipped.
+    void setPlayers(const Players &players);
+
+    //! Create all cached players as if they had been loaded from the database.
+    void restorePlayers(Players &players, gamemodes::GameMode gameMode) const;
+
+private:
+    //! A user as loaded from the database.
+    struct User
+    {
+        uint32_t userId = 0;
+        uint32_t primaryUserId = 0;
+        std::string account;
+        std::optional<std::string> alias;
+        std::map<std::string, std::set<std::string>> names;
+
+        void writeState(BinaryWriter &writer) const;
+        void readState(BinaryReader &reader);
+    };
+
+    //! Encode all games column by column.
+    static std::vector<char> encodeGames(const std::map<uint32_t, Game> &games);
+
+    //! Decode games written by encodeGames(). Returns false if the data is incomplete.
+    static bool decodeGames(BinaryReader &reader, std::map<uint32_t, Game> &games);
+
+    //! The ladder the games belong to.
+    std::string _ladderAbbreviation;
+
+    //! Watermark of the last fetch.
+    GameWatermark _watermark;
+
+    //! All games fetched so far.
+    std::map<uint32_t, Game> _games;
+
+    //! Games rejected while fetching.
+    std::map<uint32_t, GameFilter::Rejection> _rejectedGames;
+
+    //! Encoded games once they have been taken.
+    std::optional<std::vector<char>> _encodedGames;
+
+    //! Number of games taken.
+    size_t _takenGames = 0;
+
+    //! Options the duplicate mapping has been created with. Not set if there is no mapping.
+    std::optional<std::pair<bool, bool>> _duplicateMode;
+
+    //! Duplicate user id to primary user id.
+    std::unordered_map<uint32_t, uint32_t> _duplicateToPrimary;
+
+    //! Users loaded from the database.
+    std::vector<User> _users;
+
+}; // class GamesCache
@@ -0,0 +1,253 @@
+#include <cmath>
+
+#include "databaseconnection.h"
+#include "gamesource.h"
+#include "jsonlgamesource.h"
+#include "logging.h"
+#include "players.h"
+
+/*!
+ */
+std::unique_ptr<GameSource> GameSource::create(const Options &options)
+{
+    if (!options.jsonlSource.empty())
+    {
+        return std::make_unique<JsonlGameSource>(options);
+    }
+
+    return std::make_unique<DatabaseConnection>(options);
+}
+
+/*!
+ */
+void GameSource::removeDuplicate(std::map<uint32_t, std::set<uint32_t>> &duplicates, uint32_t userId)
+{
+    duplicates[userId].clear();
+
+    Log::info() << "Removing duplicates for " << userId << ".";
+
+    for (auto it = duplicates.begin(); it != duplicates.end(); ++it)
+    {
+        std::set<uint32_t> &set = it->second;
+        if (set.contains(userId))
+        {
+            Log::info() << userId << " is not a duplicate of " << it->first << ".";
+            set.erase(userId);
+        }
+    }
+}
+
+/*!
+ */
+std::unordered_map<uint32_t, uint32_t> GameSource::cncnetDuplicateMapping(const std::map<uint32_t, uint32_t> &userIds)
+{
+    std::unordered_map<uint32_t, uint32_t> result;
+    std::map<uint32_t, std::set<uint32_t>> temporaryDuplicates;
+
+    std::set<uint32_t> allUserIds;
+    for (const auto& [userId, gameCount] : userIds)
+    {
+        allUserIds.insert(userId);
+    }
+
+    std::map<uint32_t, std::set<uint32_t>> webLikeDuplicates = getWebLikeDuplicateAccounts(allUserIds);
+
+    // First, use recent-IP algorithm to determine duplicates.
+    for (const auto& [userId, gameCount] : userIds)
+    {
+        Log::verbose() << "User " << userId << " has played " << gameCount << " games.";
+        temporaryDuplicates[userId] = std::set<uint32_t>();
+        const std::set<uint32_t> &duplicates = webLikeDuplicates[userId];
+        for (uint32_t duplicate : duplicates)
+        {
+            Log::verbose() << "User #" << duplicate << " is a duplicate of #" << userId << ".";
+            temporaryDuplicates[userId].insert(duplicate);
+            temporaryDuplicates[duplicate].insert(userId);
+
+            for (uint32_t x : duplicates)
+            {
+                if (x != duplicate)
+                {
+                    temporaryDuplicates[duplicate].insert(x);
+                }
+            }
+        }
+    }
+
+    // Next, add some well known duplicates, which are not detected by recent IP.
+    temporaryDuplicates[  152].insert({ 37747, 79486 });
+    temporaryDuplicates[  268].insert({    69 });
+    temporaryDuplicates[ 3968].insert({ 18319, 66877 });
+    temporaryDuplicates[17651].insert({ 40343, 43364, 44568 }); // This is actually wrong.
+    temporaryDuplicates[19083].insert({ 10459 });
+    temporaryDuplicates[33933].insert({ 300, 5878 });
+    temporaryDuplicates[40500].insert({    24,  1029, 68169 });
+    temporaryDuplicates[44616].insert({ 67416 });
+    temporaryDuplicates[37077].insert({ 58873, 59236, 59916, 68898, 68942, 71304 });
+    temporaryDuplicates[19548].insert({ 68698 });
+    temporaryDuplicates[69904].insert({ 73057, 75285, 78280});
+    temporaryDuplicates[47880].insert({ 71623 });
+    temporaryDuplicates[53313].insert({ 59298, 76620 });
+    temporaryDuplicates[54423].insert({ 20498 });
+    temporaryDuplicates[55626].insert({ 73649 });
+    temporaryDuplicates[58766].insert({ 58764, 66502 });
+    temporaryDuplicates[59413].insert({   554, 61680 });
+    temporaryDuplicates[60300].insert({ 61757, 65104, 65875 });
+    temporaryDuplicates[62077].insert({ 56736 });
+    temporaryDuplicates[63398].insert({ 63331 });
+    temporaryDuplicates[67132].insert({ 1179 });
+    temporaryDuplicates[67596].insert({ 36814 });
+    temporaryDuplicates[60828].insert({ 77657, 74819});
+    temporaryDuplicates[65311].insert({ 81488 });
+    removeDuplicate(temporaryDuplicates, 56589);
+    removeDuplicate(temporaryDuplicates, 6026);
+    removeDuplicate(temporaryDuplicates, 58860);
+
+    crunchDuplicates(temporaryDuplicates);
+
+    // Ouput all duplicates.
+    for (auto& [primaryUserId, duplicates] : temporaryDuplicates)
+    {
+        std::stringstream ss;
+        for (uint32_t id : duplicates)
+        {
+            ss << " " << id;
+        }
+        Log::verbose() << "Duplicates of #" << primaryUserId << ":" << ss.str();
+    }
+
+    // Load all aliases at once. An account with alias is preferred as primary account.
+    std::set<uint32_t> accounts;
+    for (const auto& [currentPrimary, duplicates] : temporaryDuplicates)
+    {
+        accounts.insert(currentPrimary);
+        accounts.insert(duplicates.begin(), duplicates.end());
+    }
+
+    std::map<uint32_t, std::string> aliases = loadAliases(accounts);
+
+    // Next, find the best primary account for each player.
+    for (auto& [currentPrimary, duplicates] : temporaryDuplicates)
+    {
+        uint32_t currentBestPrimary = 0;
+        uint32_t mostGames = 0;
+        duplicates.insert(currentPrimary);
+
+        for (uint32_t duplicate : duplicates)
+        {
+            if (aliases.contains(duplicate))
+            {
+                currentBestPrimary = duplicate;
+                break;
+            }
+
+            auto it = userIds.find(duplicate);
+            uint32_t gamesPlayed = (it == userIds.end()) ? 0 : it->second;
+
+            if (gamesPlayed > mostGames)
+            {
+                mostGames = it->second;
+                currentBestPrimary = duplicate;
+            }
+        }
+
+        if (currentBestPrimary == 0)
+        {
+            Log::critical() << "No best primary account found.";
+        }
+
+        for (uint32_t duplicate : duplicates)
+        {
+            result[duplicate] = currentBestPrimary;
+        }
+    }
+
+    return result;
+}
+
+/*!
+ */
+void GameSource::crunchDuplicates(std::map<uint32_t, std::set<uint32_t>> &duplicates)
+{
+    // Unbalanced graph.
+    std::map<uint32_t, std::set<uint32_t>> adj;
+    for (const auto &kv : duplicates)
+    {
+        uint32_t k = kv.first;
+        adj[k];
+        for (uint32_t v : kv.second)
+        {
+            adj[k].insert(v);
+            adj[v].insert(k);
+        }
+    }
+
+    std::set<uint32_t> visited;
+    std::map<uint32_t, std::set<uint32_t>> result;
+
+    for (const auto &node : adj)
+    {
+        uint32_t start = node.first;
+        if (visited.count(start)) continue;
+
+        std::vector<uint32_t> stack = { start };
+        std::set<uint32_t> component;
+
+        while (!stack.empty())
+        {
+            uint32_t u = stack.back();
+            stack.pop_back();
+            if (visited.insert(u).second)
+            {
+                component.insert(u);
+                for (uint32_t w : adj[u])
+                {
+                    if (!visited.count(w)) stack.push_back(w);
+                }
+            }
+        }
+
+        if (!component.empty())
+        {
+            uint32_t rep = *component.begin();
+            std::set<uint32_t> others = component;
+            others.erase(rep);
+            result[rep] = std::move(others);
+        }
+    }
+
+    duplicates = result;
+}
+
+/*!
+ */
+std::map<uint32_t, UserRating> GameSource::userRatings(
+    gamemodes::GameMode gameMode,
+    const Players &players,
+    const std::map<uint32_t, uint32_t> &activeRanks,
+    const std::map<uint32_t, uint32_t> &allTimeRanks)
+{
+    std::map<uint32_t, UserRating> ratings;
+
+    for (uint32_t userId : players.userIds())
+    {
+        const Player &player = players[userId];
+        factions::Faction faction = player.getBestFaction(false);
+
+        if (!player.isActive(faction) || gameMode == gamemodes::Blitz2v2)
+        {
+            // Try to get any rating.
+            faction = factions::Combined;
+        }
+
+        UserRating &rating = ratings[userId];
+        rating.rating = static_cast<int>(std::round(player.elo(faction)));
+        rating.deviation = static_cast<int>(std::round(player.deviation(faction)));
+        rating.eloRank = activeRanks.contains(userId) ? activeRanks.at(userId) : 0;
+        rating.allTimeRank = allTimeRanks.contains(userId) ? allTimeRanks.at(userId) : 0;
+        rating.ratedGames = player.gameCount();
+        rating.active = player.isActive();
+    }
+
+    return ratings;
+}
@@ -0,0 +1,95 @@
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include "game.h"
+#include "gamefilter.h"
+#include "gamemode.h"
+#include "options.h"
+
+// Forward declarations:
+class Players;
+
+//! A row of table user_ratings.
+struct UserRating
+{
+    int rating = 0;
+    int deviation = 0;
+    uint32_t eloRank = 0;
+    uint32_t allTimeRank = 0;
+    uint32_t ratedGames = 0;
+    bool active = false;
+
+    bool operator==(const UserRating &other) const = default;
+};
+
+/*!
+ * Where games and users come from and where the ratings go to. The MySQL database of
+ * cncnet is the real thing, JSONL files allow to run without a database at all.
+ */
+class GameSource
+{
+public:
+    //! Create the source selected by the options. Works on the ladder given by the options.
+    static std::unique_ptr<GameSource> create(const Options &options);
+
+    //! Destructor.
+    virtual ~GameSource() = default;
+
+    //! Check if the source can be used.
+    virtual bool isEstablished() const = 0;
+
+    //! Check if the given ladder exists.
+    virtual bool ladderExists(const std::string &abbreviation) const = 0;
+
+    //! Switch to another ladder.
+    virtual void setLadder(const std::string &abbreviation) = 0;
+
+    //! Get all games of the current ladder, which have been added or modified after the given
+    //! watermark. All games are fetched if the watermark is empty. The watermark is set to the
+    //! latest game fetched. The player id won't be set for the games. Games rejected by the
+    //! filter are only returned as id and reason. The returned games still have to be checked,
+    //! a source might not apply all rules.
+    virtual std::map<uint32_t, Game> fetchGames(const GameFilter &filter, const GameWatermark &since, GameWatermark &watermark,
+                                                std::map<uint32_t, GameFilter::Rejection> &rejectedGames) = 0;
+
+    //! Get a map to get the primary user id (value) for each user (key):
+    virtual std::unordered_map<uint32_t, uint32_t> duplicateToPrimaryMapping(const std::map<uint32_t, uint32_t> userIds) = 0;
+
+    //! Accounts, which share the last ip address of each user.
+    virtual std::map<uint32_t, std::set<uint32_t>> getWebLikeDuplicateAccounts(const std::set<uint32_t> &userIds) = 0;
+
+    //! Load the aliases of all given users. Users without alias are not part of the result.
+    virtual std::map<uint32_t, std::string> loadAliases(const std::set<uint32_t> &userIds) = 0;
+
+    //! Load all the users with the given user ids and create players. Basically only load the
+    //! alias for each player.
+    virtual void loadUsers(const std::set<uint32_t> &userIds, Players &players) = 0;
+
+    //! Load a player by its alias. Only used to process tournament games with players, who never
+    //! played quick match. Returns 0 if there is no such player.
+    virtual uint32_t loadPlayerFromAlias(const std::string &alias, Players &players) = 0;
+
+    //! Write the ratings of all players of the current ladder.
+    virtual void writePlayerRatings(gamemodes::GameMode gameMode, const Players &players, std::map<uint32_t, uint32_t> activeRanks, std::map<uint32_t, uint32_t> allTimeRanks) = 0;
+
+    //! Return a map with the key being the duplicate account and the value being the primary account.
+    //! Uses the same duplicate detection as cncnet.
+    std::unordered_map<uint32_t, uint32_t> cncnetDuplicateMapping(const std::map<uint32_t, uint32_t> &userIds);
+
+    //! Remove a duplicate.
+    static void removeDuplicate(std::map<uint32_t, std::set<uint32_t> > &duplicates, uint32_t userId);
+
+    //! Create the transitive closure for all duplicates.
+    static void crunchDuplicates(std::map<uint32_t, std::set<uint32_t>> &duplicates);
+
+protected:
+    //! The rows of table user_ratings for all players.
+    static std::map<uint32_t, UserRating> userRatings(gamemodes::GameMode gameMode, const Players &players, const std::map<uint32_t, uint32_t> &activeRanks, const std::map<uint32_t, uint32_t> &allTimeRanks);
+
+}; // class GameSource
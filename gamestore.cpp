@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "gamestore.h"
+
+/*!
+ */
+GameStore::GameStore(std::map<uint32_t, Game> &&games)
+{
+    _games.reserve(games.size());
+    _indices.reserve(games.size());
+
+    for (auto it = games.begin(); it != games.end(); it = games.erase(it))
+    {
+        _indices.emplace(it->first, static_cast<uint32_t>(_games.size()));
+        _games.push_back(it->second);
+    }
+}
+
+/*!
+ */
+Game* GameStore::add(const Game &game)
+{
+    if (_indices.contains(game.id()))
+    {
+        return nullptr;
+    }
+
+    // Usually games are added in order.
+    if (_games.empty() || _games.back().id() < game.id())
+    {
+        _indices.emplace(game.id(), static_cast<uint32_t>(_games.size()));
+        _games.push_back(game);
+        return &_games.back();
+    }
+
+    auto it = std::lower_bound(_games.begin(), _games.end(), game.id(), [](const Game &a, uint32_t id) { return a.id() < id; });
+    it = _games.insert(it, game);
+
+    for (auto moved = it; moved != _games.end(); ++moved)
+    {
+        _indices[moved->id()] = static_cast<uint32_t>(moved - _games.begin());
+    }
+
+    return &*it;
+}
+
+/*!
+ */
+bool GameStore::contains(uint32_t gameId) const
+{
+    return _indices.contains(gameId);
+}
+
+/*!
+ */
+Game* GameStore::find(uint32_t gameId)
+{
+    auto it = _indices.find(gameId);
+    return (it != _indices.end()) ? &_games[it->second] : nullptr;
+}
+
+/*!
+ */
+const Game* GameStore::find(uint32_t gameId) const
+{
+    auto it = _indices.find(gameId);
+    return (it != _indices.end()) ? &_games[it->second] : nullptr;
+}
+
+/*!
+ */
+const Game& GameStore::at(uint32_t gameId) const
+{
+    return _games[_indices.at(gameId)];
+}
+
+/*!
+ */
+size_t GameStore::size() const
+{
+    return _games.size();
+}
+
+/*!
+ */
+bool GameStore::empty() const
+{
+    return _games.empty();
+}
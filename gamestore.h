@@ -0,0 +1,56 @@
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "game.h"
+
+/*!
+ * All games of a ladder in a single contiguous array, ordered by game id. Games have a fixed
+ * size and refer to interned strings, so iterating them does not chase any pointers.
+ */
+class GameStore
+{
+public:
+    //! Constructor. Creates an empty store.
+    GameStore() = default;
+
+    //! Constructor. Takes the given games.
+    GameStore(std::map<uint32_t, Game> &&games);
+
+    //! Add a game. Games are kept ordered by id. Returns nullptr if a game with the same id
+    //! exists already. Pointers to games are invalidated.
+    Game* add(const Game &game);
+
+    //! Check if there is a game with the given id.
+    bool contains(uint32_t gameId) const;
+
+    //! Get the game with the given id. Returns nullptr if there is no such game.
+    Game* find(uint32_t gameId);
+    const Game* find(uint32_t gameId) const;
+
+    //! Get the game with the given id. Throws std::out_of_range if there is no such game.
+    const Game& at(uint32_t gameId) const;
+
+    //! Number of games.
+    size_t size() const;
+
+    //! Check if there are no games.
+    bool empty() const;
+
+    std::vector<Game>::iterator begin() { return _games.begin(); }
+    std::vector<Game>::iterator end() { return _games.end(); }
+    std::vector<Game>::const_iterator begin() const { return _games.begin(); }
+    std::vector<Game>::const_iterator end() const { return _games.end(); }
+
+private:
+    //! All games ordered by id.
+    std::vector<Game> _games;
+
+    //! Index into _games for each game id.
+    std::unordered_map<uint32_t, uint32_t> _indices;
+
+}; // class GameStore
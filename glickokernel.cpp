@@ -0,0 +1,135 @@
+#include <cmath>
+#include <numbers>
+
+#if defined(ELO_ENABLE_AVX2) && defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define ELO_USE_AVX2
+#endif
+
+#include "glickokernel.h"
+
+namespace
+{
+
+#ifdef ELO_USE_AVX2
+
+//! exp() for four values at once. Range reduction to |r| <= ln(2)/2 followed by a Taylor
+//! polynomial of degree 11, which is accurate to a few ulp. The input is clamped, which is
+//! far outside of anything a rating difference can produce.
+__m256d exp4(__m256d x)
+{
+    const __m256d log2e = _mm256_set1_pd(std::numbers::log2e);
+    const __m256d ln2High = _mm256_set1_pd(6.93145751953125E-1);
+    const __m256d ln2Low = _mm256_set1_pd(1.42860682030941723212E-6);
+    const __m256d shifter = _mm256_set1_pd(6755399441055744.0); // 1.5 * 2^52
+
+    x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(-700.0)), _mm256_set1_pd(700.0));
+
+    // x = n * ln(2) + r.
+    __m256d n = _mm256_round_pd(_mm256_mul_pd(x, log2e), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(n, ln2High, x);
+    r = _mm256_fnmadd_pd(n, ln2Low, r);
+
+    // e^r.
+    __m256d p = _mm256_set1_pd(1.0 / 39916800.0);
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 3628800.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 362880.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 40320.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 5040.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 720.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 120.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 24.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 6.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(0.5));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+
+    // 2^n, built directly in the exponent bits.
+    __m256i exponent = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(n, shifter)), _mm256_castpd_si256(shifter));
+    exponent = _mm256_slli_epi64(_mm256_add_epi64(exponent, _mm256_set1_epi64x(1023)), 52);
+
+    return _mm256_mul_pd(p, _mm256_castsi256_pd(exponent));
+}
+
+//! Sum of the four lanes.
+double sum4(__m256d values)
+{
+    __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(values), _mm256_extractf128_pd(values, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+
+#endif
+
+}
+
+/*!
+ */
+void glicko::OpponentBuffer::assign(std::span<const std::array<double, 3>> opponents, std::span<const double> results)
+{
+    ratings.resize(opponents.size());
+    deviations.resize(opponents.size());
+    this->results.assign(results.begin(), results.end());
+
+    for (size_t i = 0; i < opponents.size(); i++)
+    {
+        ratings[i] = opponents[i][0];
+        deviations[i] = opponents[i][1];
+    }
+}
+
+/*!
+ */
+glicko::PeriodSums glicko::accumulateScalar(double rating, std::span<const double> ratings, std::span<const double> deviations,
+                                            std::span<const double> results)
+{
+    PeriodSums sums;
+
+    // Same order of operations as Rating::g() and Rating::e().
+    for (size_t i = 0; i < ratings.size(); i++)
+    {
+        double scale = deviations[i] / std::numbers::pi;
+        double g = 1.0 / std::sqrt(1.0 + 3.0 * scale * scale);
+        double e = 1.0 / (1.0 + std::exp(-1.0 * g * (rating - ratings[i])));
+
+        sums.variance += g * g * e * (1.0 - e);
+        sums.improvement += g * (results[i] - e);
+    }
+
+    return sums;
+}
+
+/*!
+ */
+glicko::PeriodSums glicko::accumulate(double rating, std::span<const double> ratings, std::span<const double> deviations,
+                                      std::span<const double> results)
+{
+#ifdef ELO_USE_AVX2
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d three = _mm256_set1_pd(3.0);
+    const __m256d inversePi = _mm256_set1_pd(std::numbers::inv_pi);
+    const __m256d ownRating = _mm256_set1_pd(rating);
+
+    __m256d variance = _mm256_setzero_pd();
+    __m256d improvement = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + 4 <= ratings.size(); i += 4)
+    {
+        __m256d scale = _mm256_mul_pd(_mm256_loadu_pd(deviations.data() + i), inversePi);
+        __m256d g = _mm256_div_pd(one, _mm256_sqrt_pd(_mm256_fmadd_pd(_mm256_mul_pd(three, scale), scale, one)));
+        __m256d difference = _mm256_sub_pd(ownRating, _mm256_loadu_pd(ratings.data() + i));
+        __m256d e = _mm256_div_pd(one, _mm256_add_pd(one, exp4(_mm256_mul_pd(_mm256_sub_pd(_mm256_setzero_pd(), g), difference))));
+
+        variance = _mm256_fmadd_pd(_mm256_mul_pd(_mm256_mul_pd(g, g), e), _mm256_sub_pd(one, e), variance);
+        improvement = _mm256_fmadd_pd(g, _mm256_sub_pd(_mm256_loadu_pd(results.data() + i), e), improvement);
+    }
+
+    PeriodSums sums = accumulateScalar(rating, ratings.subspan(i), deviations.subspan(i), results.subspan(i));
+    sums.variance += sum4(variance);
+    sums.improvement += sum4(improvement);
+
+    return sums;
+#else
+    return accumulateScalar(rating, ratings, deviations, results);
+#endif
+}
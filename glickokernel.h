@@ -0,0 +1,53 @@
+
+#pragma once
+
+#include <array>
+#include <span>
+#include <vector>
+
+namespace glicko
+{
+
+//! Sums over all games of a rating period, which are needed for step 3 and 4 of Glicko-2.
+struct PeriodSums
+{
+    //! Sum of g(phi_j)^2 * E * (1 - E). The estimated variance v is the reciprocal.
+    double variance = 0.0;
+
+    //! Sum of g(phi_j) * (s_j - E). The estimated improvement delta is this sum times v.
+    double improvement = 0.0;
+};
+
+/*!
+ * Opponents and results of a rating period as structure of arrays. Meant to be reused, so
+ * filling it does not allocate once it is large enough.
+ */
+struct OpponentBuffer
+{
+    //! Rating of each opponent (Glicko-2 scale).
+    std::vector<double> ratings;
+
+    //! Deviation of each opponent (Glicko-2 scale).
+    std::vector<double> deviations;
+
+    //! Result of each game (1 win, 0 loss).
+    std::vector<double> results;
+
+    //! Copy the opponents and results given as array of structures.
+    void assign(std::span<const std::array<double, 3>> opponents, std::span<const double> results);
+
+}; // struct OpponentBuffer
+
+//! Compute g, E and both sums for all opponents in a single pass. The scalar version gives
+//! exactly the same results as computing variance and delta separately. If the build enables
+//! ELO_ENABLE_AVX2, four opponents are processed at once with a polynomial approximation of
+//! exp(). Both sums then differ by less than 1e-13 per opponent from the scalar version.
+extern PeriodSums accumulate(double rating, std::span<const double> ratings, std::span<const double> deviations,
+                             std::span<const double> results);
+
+//! Scalar version of accumulate(). Always available, used for the remaining opponents of the
+//! vectorized version.
+extern PeriodSums accumulateScalar(double rating, std::span<const double> ratings, std::span<const double> deviations,
+                                   std::span<const double> results);
+
+}
@@ -0,0 +1,163 @@
+#include <algorithm>
+
+#include "binarystream.h"
+#include "game.h"
+#include "headtohead.h"
+#include "rating.h"
+
+/*!
+ */
+void HeadToHead::addGame(const Game &game)
+{
+    // Merged duplicates might end up playing against themselves.
+    if (game.isDraw() || game.playerCount() != 2 || game.userId(0) == game.userId(1))
+    {
+        return;
+    }
+
+    uint32_t lowIndex = game.userId(0) < game.userId(1) ? 0 : 1;
+    uint32_t highIndex = lowIndex ^ 1;
+
+    uint32_t pairingIndex = 0;
+    std::unordered_map<uint64_t, uint32_t>::const_iterator it = _pairingIndices.find(key(game.userId(0), game.userId(1)));
+    if (it != _pairingIndices.end())
+    {
+        pairingIndex = it->second;
+    }
+    else
+    {
+        Pairing pairing;
+        pairing.lowUserId = game.userId(lowIndex);
+        pairing.highUserId = game.userId(highIndex);
+        pairingIndex = static_cast<uint32_t>(_pairings.size());
+        _pairings.push_back(pairing);
+        index(pairingIndex);
+    }
+
+    Rating lowRating(game.rating(lowIndex), game.deviation(lowIndex), glicko::initialVolatility);
+    Rating highRating(game.rating(highIndex), game.deviation(highIndex), glicko::initialVolatility);
+
+    Pairing &pairing = _pairings[pairingIndex];
+    pairing.games++;
+    pairing.lowWins += game.winnerIndex() == static_cast<int>(lowIndex) ? 1 : 0;
+    pairing.lowExpected += lowRating.e_star(highRating.toArray(), 0.0);
+    pairing.highExpected += highRating.e_star(lowRating.toArray(), 0.0);
+}
+
+/*!
+ */
+size_t HeadToHead::count() const
+{
+    return _pairings.size();
+}
+
+/*!
+ */
+Probabilities HeadToHead::against(uint32_t userId, uint32_t opponentId) const
+{
+    std::unordered_map<uint64_t, uint32_t>::const_iterator it = _pairingIndices.find(key(userId, opponentId));
+    if (it == _pairingIndices.end())
+    {
+        return Probabilities::fromTotals(0, 0, 0.0);
+    }
+
+    return view(_pairings[it->second], userId);
+}
+
+/*!
+ */
+std::vector<std::pair<uint32_t, Probabilities>> HeadToHead::opponents(uint32_t userId) const
+{
+    std::vector<std::pair<uint32_t, Probabilities>> result;
+
+    std::unordered_map<uint32_t, std::vector<uint32_t>>::const_iterator it = _pairingsByPlayer.find(userId);
+    if (it == _pairingsByPlayer.end())
+    {
+        return result;
+    }
+
+    result.reserve(it->second.size());
+    for (uint32_t pairingIndex : it->second)
+    {
+        const Pairing &pairing = _pairings[pairingIndex];
+        result.emplace_back(pairing.lowUserId == userId ? pairing.highUserId : pairing.lowUserId, view(pairing, userId));
+    }
+
+    return result;
+}
+
+/*!
+ */
+Probabilities HeadToHead::view(const Pairing &pairing, uint32_t userId)
+{
+    if (userId == pairing.lowUserId)
+    {
+        return Probabilities::fromTotals(pairing.games, pairing.lowWins, pairing.lowExpected);
+    }
+    else
+    {
+        return Probabilities::fromTotals(pairing.games, pairing.games - pairing.lowWins, pairing.highExpected);
+    }
+}
+
+/*!
+ */
+uint64_t HeadToHead::key(uint32_t userId, uint32_t opponentId)
+{
+    return (static_cast<uint64_t>(std::min(userId, opponentId)) << 32) | std::max(userId, opponentId);
+}
+
+/*!
+ */
+void HeadToHead::index(uint32_t pairingIndex)
+{
+    const Pairing &pairing = _pairings[pairingIndex];
+    _pairingIndices[key(pairing.lowUserId, pairing.highUserId)] = pairingIndex;
+    _pairingsByPlayer[pairing.lowUserId].push_back(pairingIndex);
+    _pairingsByPlayer[pairing.highUserId].push_back(pairingIndex);
+}
+
+/*!
+ */
+void HeadToHead::writeState(BinaryWriter &writer) const
+{
+    writer.write(_pairings);
+}
+
+/*!
+ */
+void HeadToHead::readState(BinaryReader &reader)
+{
+    reader.read(_pairings);
+
+    _pairingIndices.clear();
+    _pairingsByPlayer.clear();
+    for (uint32_t i = 0; i < _pairings.size(); i++)
+    {
+        index(i);
+    }
+}
+
+/*!
+ */
+void HeadToHead::Pairing::writeState(BinaryWriter &writer) const
+{
+    writer.write(lowUserId);
+    writer.write(highUserId);
+    writer.write(games);
+    writer.write(lowWins);
+    writer.write(lowExpected);
+    writer.write(highExpected);
+}
+
+/*!
+ */
+void HeadToHead::Pairing::readState(BinaryReader &reader)
+{
+    reader.read(lowUserId);
+    reader.read(highUserId);
+    reader.read(games);
+    reader.read(lowWins);
+    reader.read(lowExpected);
+    reader.read(highExpected);
+}
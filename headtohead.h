@@ -0,0 +1,79 @@
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "probabilities.h"
+
+// Forward declarations:
+class BinaryReader;
+class BinaryWriter;
+class Game;
+
+/*!
+ * Results of all 1v1 pairings of a ladder. Each pairing is stored once, with the expected results
+ * of both players, and can be seen from either side.
+ */
+class HeadToHead
+{
+public:
+    //! Add a 1v1 game. Draws and games with more players are ignored. Ratings must have been
+    //! set to the game.
+    void addGame(const Game &game);
+
+    //! Number of pairings.
+    size_t count() const;
+
+    //! Finalized results of the player against the given opponent. Empty if they never met.
+    Probabilities against(uint32_t userId, uint32_t opponentId) const;
+
+    //! Finalized results of the player against each opponent, in the order they first met.
+    std::vector<std::pair<uint32_t, Probabilities>> opponents(uint32_t userId) const;
+
+    //! Write all pairings to a checkpoint.
+    void writeState(BinaryWriter &writer) const;
+
+    //! Read the pairings from a checkpoint.
+    void readState(BinaryReader &reader);
+
+private:
+    //! Games between two players. The player with the lower user id comes first.
+    struct Pairing
+    {
+        uint32_t lowUserId = 0;
+        uint32_t highUserId = 0;
+        uint32_t games = 0;
+
+        //! Wins of the first player. The others are wins of the second.
+        uint32_t lowWins = 0;
+
+        //! Sum of the winning probabilities of each player.
+        double lowExpected = 0.0;
+        double highExpected = 0.0;
+
+        void writeState(BinaryWriter &writer) const;
+        void readState(BinaryReader &reader);
+    };
+
+    //! Results of the pairing seen from the given player.
+    static Probabilities view(const Pairing &pairing, uint32_t userId);
+
+    //! Key of the pairing of both players.
+    static uint64_t key(uint32_t userId, uint32_t opponentId);
+
+    //! Add a pairing to the indices.
+    void index(uint32_t pairingIndex);
+
+    //! All pairings in the order of their first game.
+    std::vector<Pairing> _pairings;
+
+    //! Index of each pairing by key.
+    std::unordered_map<uint64_t, uint32_t> _pairingIndices;
+
+    //! Indices of the pairings of each player.
+    std::unordered_map<uint32_t, std::vector<uint32_t>> _pairingsByPlayer;
+
+}; // class HeadToHead
@@ -0,0 +1,357 @@
+#include <fstream>
+
+#include <nlohmann/json.hpp>
+
+#include "faction.h"
+#include "jsonlgamesource.h"
+#include "logging.h"
+#include "players.h"
+
+using json = nlohmann::json;
+
+namespace
+{
+
+//! Call the handler for each non-empty line of a JSONL file. Lines, which can't be parsed,
+//! are logged and skipped. Returns false if the file can't be opened.
+template<typename Handler>
+bool forEachLine(const std::filesystem::path &file, Handler handler)
+{
+    std::ifstream stream(file);
+    if (!stream)
+    {
+        return false;
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(stream, line))
+    {
+        lineNumber++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+
+        try
+        {
+            handler(json::parse(line));
+        }
+        catch (const json::exception &e)
+        {
+            Log::error() << "Skipping line " << lineNumber << " of '" << file.string() << "': " << e.what();
+        }
+    }
+
+    return true;
+}
+
+}
+
+/*!
+ */
+JsonlGameSource::JsonlGameSource(const Options &options) :
+    _directory(options.jsonlSource),
+    _ladder(options.ladderAbbreviation),
+    _gameMode(gamemodes::toGameMode(options.ladderAbbreviation))
+{
+    _ready = loadUsersFile();
+}
+
+/*!
+ */
+bool JsonlGameSource::loadUsersFile()
+{
+    std::filesystem::path file = _directory / "users.jsonl";
+
+    bool opened = forEachLine(file, [this](const json &object) {
+        User user;
+        user.userId = object.at("id").get<uint32_t>();
+        user.primaryUserId = object.value("primaryUserId", 0u);
+        user.account = object.value("name", std::string());
+        user.alias = object.value("alias", std::string());
+        user.ipAddressId = object.value("ipAddressId", 0u);
+        user.ipAddressHistory = object.value("ipAddressHistory", std::set<uint32_t>());
+        user.playerNames = object.value("playerNames", std::map<std::string, std::set<std::string>>());
+
+        for (uint32_t ipAddressId : user.ipAddressHistory)
+        {
+            _usersByIpAddress[ipAddressId].insert(user.userId);
+        }
+
+        _users[user.userId] = std::move(user);
+    });
+
+    if (!opened)
+    {
+        Log::fatal() << "Unable to open '" << file.string() << "'.";
+        return false;
+    }
+
+    Log::info() << "Loaded " << _users.size() << " users from '" << file.string() << "'.";
+
+    return true;
+}
+
+/*!
+ */
+std::filesystem::path JsonlGameSource::ladderDirectory(const std::string &abbreviation) const
+{
+    return _directory / abbreviation;
+}
+
+/*!
+ */
+bool JsonlGameSource::isEstablished() const
+{
+    return _ready;
+}
+
+/*!
+ */
+bool JsonlGameSource::ladderExists(const std::string &abbreviation) const
+{
+    return std::filesystem::exists(ladderDirectory(abbreviation) / "games.jsonl");
+}
+
+/*!
+ */
+void JsonlGameSource::setLadder(const std::string &abbreviation)
+{
+    _ladder = abbreviation;
+    _gameMode = gamemodes::toGameMode(abbreviation);
+}
+
+/*!
+ */
+std::map<uint32_t, Game> JsonlGameSource::fetchGames(const GameFilter &filter, const GameWatermark &since, GameWatermark &watermark,
+                                                     std::map<uint32_t, GameFilter::Rejection> &rejectedGames)
+{
+    std::map<uint32_t, Game> games;
+    std::filesystem::path file = ladderDirectory(_ladder) / "games.jsonl";
+
+    watermark = since;
+
+    bool opened = forEachLine(file, [&](const json &object) {
+        uint32_t gameId = object.at("id").get<uint32_t>();
+        uint32_t timestamp = object.at("timestamp").get<uint32_t>();
+        uint32_t updatedAt = object.value("updatedAt", timestamp);
+
+        // Same condition as used for the database.
+        if (!since.isEmpty() && gameId <= since.gameId && updatedAt < since.updatedAt)
+        {
+            return;
+        }
+
+        watermark.gameId = std::max(watermark.gameId, gameId);
+        watermark.updatedAt = std::max(watermark.updatedAt, updatedAt);
+
+        if (games.contains(gameId) || rejectedGames.contains(gameId))
+        {
+            Log::warning() << "Game " << gameId << " is listed more than once in '" << file.string() << "'.";
+            return;
+        }
+
+        Game game(gameId, object.value("map", std::string()), timestamp, object.value("fps", 0u), object.value("duration", 0u));
+        game.setGameType(gametypes::Quickmatch);
+        game.setLadderAbbreviation(object.value("ladder", _ladder));
+
+        for (const json &participant : object.value("players", json::array()))
+        {
+            std::string side = participant.value("side", std::string());
+            factions::Faction faction = factions::fromName(side);
+            if (faction == factions::UnknownFaction)
+            {
+                Log::warning() << "Cannot determine faction from '" << side << "'. Game " << gameId << " will probably be invalid.";
+                continue;
+            }
+
+            game.addPlayer(participant.at("userId").get<uint32_t>(), participant.value("name", std::string()), faction,
+                           participant.value("won", false), participant.value("points", 0), 0.0, 0.0);
+        }
+
+        // The files are local, so all rules are applied right away.
+        GameFilter::Rejection rejection = filter.check(game);
+        if (rejection != GameFilter::Accepted)
+        {
+            rejectedGames[gameId] = rejection;
+            return;
+        }
+
+        games.emplace(gameId, std::move(game));
+    });
+
+    if (!opened)
+    {
+        Log::error() << "Unable to open '" << file.string() << "'.";
+    }
+
+    return games;
+}
+
+/*!
+ */
+std::unordered_map<uint32_t, uint32_t> JsonlGameSource::duplicateToPrimaryMapping(const std::map<uint32_t, uint32_t> userIds)
+{
+    std::unordered_map<uint32_t, uint32_t> result;
+
+    for (const auto &[userId, gameCount] : userIds)
+    {
+        auto it = _users.find(userId);
+        if (it == _users.end())
+        {
+            continue;
+        }
+
+        uint32_t primaryId = it->second.primaryUserId;
+        result[userId] = (primaryId != 0 && primaryId != userId) ? primaryId : userId;
+    }
+
+    return result;
+}
+
+/*!
+ */
+std::map<uint32_t, std::set<uint32_t>> JsonlGameSource::getWebLikeDuplicateAccounts(const std::set<uint32_t> &userIds)
+{
+    std::map<uint32_t, std::set<uint32_t>> duplicates;
+
+    for (uint32_t userId : userIds)
+    {
+        std::set<uint32_t> &userDuplicates = duplicates[userId];
+
+        auto it = _users.find(userId);
+        if (it != _users.end() && it->second.ipAddressId > 0)
+        {
+            userDuplicates = _usersByIpAddress[it->second.ipAddressId];
+            userDuplicates.erase(userId);
+        }
+    }
+
+    return duplicates;
+}
+
+/*!
+ */
+std::map<uint32_t, std::string> JsonlGameSource::loadAliases(const std::set<uint32_t> &userIds)
+{
+    std::map<uint32_t, std::string> aliases;
+
+    for (uint32_t userId : userIds)
+    {
+        auto it = _users.find(userId);
+        if (it != _users.end() && !it->second.alias.empty())
+        {
+            aliases[userId] = it->second.alias;
+        }
+    }
+
+    return aliases;
+}
+
+/*!
+ */
+void JsonlGameSource::loadUsers(const std::set<uint32_t> &userIds, Players &players)
+{
+    if (userIds.empty())
+    {
+        Log::warning() << "No user ids provided.";
+        return;
+    }
+
+    for (uint32_t userId : userIds)
+    {
+        auto it = _users.find(userId);
+        if (it == _users.end())
+        {
+            continue;
+        }
+
+        Player player(userId, userId, "", _gameMode);
+        if (!it->second.alias.empty())
+        {
+            player.setAlias(it->second.alias);
+        }
+        players.add(player, _ladder);
+    }
+}
+
+/*!
+ */
+uint32_t JsonlGameSource::loadPlayerFromAlias(const std::string &alias, Players &players)
+{
+    auto it = std::find_if(_users.begin(), _users.end(), [&alias](const auto &entry) { return entry.second.alias == alias; });
+    if (alias.empty() || it == _users.end())
+    {
+        return 0;
+    }
+
+    const User &user = it->second;
+    Player player(user.userId, user.primaryUserId, user.account, _gameMode);
+    player.setAlias(alias);
+
+    for (const auto &[ladder, names] : user.playerNames)
+    {
+        for (const std::string &name : names)
+        {
+            player.addName(name, ladder);
+            Log::info() << "User " << user.userId << " (" << user.account << ") has player name '" << name << "'.";
+        }
+    }
+
+    players.add(player, _ladder);
+
+    return user.userId;
+}
+
+/*!
+ */
+void JsonlGameSource::writePlayerRatings(
+    gamemodes::GameMode gameMode,
+    const Players &players,
+    std::map<uint32_t, uint32_t> activeRanks,
+    std::map<uint32_t, uint32_t> allTimeRanks)
+{
+    std::filesystem::path file = ladderDirectory(_ladder) / "user_ratings.jsonl";
+    std::filesystem::path temporaryFile = file;
+    temporaryFile += ".tmp";
+
+    {
+        std::ofstream stream(temporaryFile, std::ios::trunc);
+        if (!stream)
+        {
+            Log::error() << "Unable to open '" << temporaryFile.string() << "' for writing.";
+            return;
+        }
+
+        for (const auto &[userId, rating] : userRatings(gameMode, players, activeRanks, allTimeRanks))
+        {
+            json object = {
+                { "userId", userId },
+                { "rating", rating.rating },
+                { "deviation", rating.deviation },
+                { "eloRank", rating.eloRank },
+                { "allTimeRank", rating.allTimeRank },
+                { "ratedGames", rating.ratedGames },
+                { "active", rating.active }
+            };
+            stream << object.dump() << '\n';
+        }
+
+        if (!stream)
+        {
+            Log::error() << "Unable to write '" << temporaryFile.string() << "'.";
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryFile, file, error);
+    if (error)
+    {
+        Log::error() << "Unable to rename '" << temporaryFile.string() << "' to '" << file.string() << "': " << error.message();
+        return;
+    }
+
+    Log::info() << "Player ratings written to '" << file.string() << "'.";
+}
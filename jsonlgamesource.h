@@ -0,0 +1,81 @@
+
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+
+#include "gamesource.h"
+
+/*!
+ * Games and users from JSONL files (one JSON object per line). Allows to run the whole
+ * rating pipeline on a machine without any database. The directory is laid out as follows:
+ *
+ *  users.jsonl                 {"id": 1, "primaryUserId": 1, "name": "account", "alias": "alias",
+ *                               "ipAddressId": 5, "ipAddressHistory": [5, 7],
+ *                               "playerNames": {"blitz": ["nick"]}}
+ *  <ladder>/games.jsonl        {"id": 1, "ladder": "blitz", "map": "map", "timestamp": 1700000000,
+ *                               "updatedAt": 1700000000, "duration": 600, "fps": 60,
+ *                               "players": [{"userId": 1, "name": "nick", "side": "Russia", "won": true, "points": 10}]}
+ *  <ladder>/user_ratings.jsonl Written by writePlayerRatings().
+ *
+ * The games of a ladder are the ones the database queries would return for that ladder,
+ * i.e. the ra2 ladder includes ra2-new-maps games.
+ */
+class JsonlGameSource : public GameSource
+{
+public:
+    //! Constructor. Loads all users from the directory given by the options.
+    JsonlGameSource(const Options &options);
+
+    bool isEstablished() const override;
+    bool ladderExists(const std::string &abbreviation) const override;
+    void setLadder(const std::string &abbreviation) override;
+    std::map<uint32_t, Game> fetchGames(const GameFilter &filter, const GameWatermark &since, GameWatermark &watermark,
+                                        std::map<uint32_t, GameFilter::Rejection> &rejectedGames) override;
+    std::unordered_map<uint32_t, uint32_t> duplicateToPrimaryMapping(const std::map<uint32_t, uint32_t> userIds) override;
+    std::map<uint32_t, std::set<uint32_t>> getWebLikeDuplicateAccounts(const std::set<uint32_t> &userIds) override;
+    std::map<uint32_t, std::string> loadAliases(const std::set<uint32_t> &userIds) override;
+    void loadUsers(const std::set<uint32_t> &userIds, Players &players) override;
+    uint32_t loadPlayerFromAlias(const std::string &alias, Players &players) override;
+    void writePlayerRatings(gamemodes::GameMode gameMode, const Players &players, std::map<uint32_t, uint32_t> activeRanks, std::map<uint32_t, uint32_t> allTimeRanks) override;
+
+private:
+    //! A user as stored in users.jsonl.
+    struct User
+    {
+        uint32_t userId = 0;
+        uint32_t primaryUserId = 0;
+        std::string account;
+        std::string alias;
+        uint32_t ipAddressId = 0;
+        std::set<uint32_t> ipAddressHistory;
+        std::map<std::string, std::set<std::string>> playerNames;
+    };
+
+    //! Load users.jsonl.
+    bool loadUsersFile();
+
+    //! Directory with the files of the given ladder.
+    std::filesystem::path ladderDirectory(const std::string &abbreviation) const;
+
+    //! Base directory.
+    std::filesystem::path _directory;
+
+    //! Current ladder.
+    std::string _ladder;
+
+    //! Game mode of the current ladder.
+    gamemodes::GameMode _gameMode;
+
+    //! Set if the users have been loaded.
+    bool _ready = false;
+
+    //! All users by user id.
+    std::map<uint32_t, User> _users;
+
+    //! User ids for each ip address, which has ever been used.
+    std::map<uint32_t, std::set<uint32_t>> _usersByIpAddress;
+
+}; // class JsonlGameSource
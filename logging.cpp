@@ -3,6 +3,7 @@
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <mutex>
 
 #include "logging.h"
 
@@ -10,6 +11,9 @@
 Log::Level Log::_globalLogLevel = Log::Level::Info;
 bool Log::_showTimestampAndLogLevel = false;
 bool Log::_enabled = true;
+thread_local std::string Log::_context;
+thread_local bool Log::_muted = false;
+thread_local std::optional<Log::Messages> Log::_captured;
 
 /*!
  */
@@ -22,7 +26,7 @@ Log::Log(Level level) :
  */
 Log::~Log()
 {
-    static std::map<Level, std::string> map{
+    static const std::map<Level, std::string> map{
         { Debug, "DEBUG"},
         { Verbose, "VERBOSE" },
         { Info, "INFO" },
@@ -32,8 +36,17 @@ Log::~Log()
         { Fatal, "FATAL" }
     };
 
-    if (this->_level != Log::NoLog && _globalLogLevel <= this->_level && Log::_enabled)
+    // Several threads might log at once.
+    static std::mutex mutex;
+
+    if (isActive() && _captured.has_value())
+    {
+        _captured->emplace_back(_level, _os.str());
+    }
+    else if (isActive())
     {
+        std::lock_guard<std::mutex> lock(mutex);
+
         if (this->_showTimestampAndLogLevel)
         {
             auto now = std::chrono::system_clock::now();
@@ -43,9 +56,40 @@ Log::~Log()
 
             std::cout << std::put_time(tm_utc, "%Y-%m-%d@%H.%M.%S")
                       << '.' << std::setfill('0') << std::setw(3) << now_ms.count()
-                      << " [" << map[this->_level] << "] ";
+                      << " [" << map.at(this->_level) << "] ";
+        }
+
+        if (!_context.empty())
+        {
+            std::cout << "[" << _context << "] ";
         }
 
         std::cout << _os.str() << std::endl;
     }
 }
+
+/*!
+ */
+void Log::startCapture()
+{
+    _captured.emplace();
+}
+
+/*!
+ */
+Log::Messages Log::stopCapture()
+{
+    Messages messages = std::move(_captured.value_or(Messages{}));
+    _captured.reset();
+    return messages;
+}
+
+/*!
+ */
+void Log::write(const Messages &messages)
+{
+    for (const auto &[level, message] : messages)
+    {
+        Log(level) << message;
+    }
+}
@@ -3,6 +3,7 @@
 
 #include <chrono>
 #include <iostream>
+#include <optional>
 #include <set>
 #include <sstream>
 #include <string>
@@ -31,7 +32,7 @@ public:
     inline Log(Log&& other) :
         _level(other._level)
     {
-        if (Log::_enabled)
+        if (isActive())
         {
             _os << other._os.str();
         }
@@ -124,7 +125,7 @@ public:
     template <typename T>
     Log& operator<<(const T& t)
     {
-        if (Log::_enabled)
+        if (isActive())
         {
             _os << t;
         }
@@ -134,6 +135,11 @@ public:
     template <typename T>
     Log& operator<<(const std::set<T> &values)
     {
+        if (!isActive())
+        {
+            return *this;
+        }
+
         bool isFirst = true;
         _os << "[";
 
@@ -158,7 +164,7 @@ public:
     //! Output formatted date.
     Log& operator<<(const std::chrono::year_month_day &date)
     {
-        if (Log::_enabled)
+        if (isActive())
         {
             _os << int(date.year()) << '-';
 
@@ -178,7 +184,7 @@ public:
     //! Output formatted date.
     Log& operator<<(const std::chrono::time_point<std::chrono::system_clock, std::chrono::days> &tp)
     {
-        if (Log::_enabled)
+        if (isActive())
         {
             std::chrono::sys_days sd = tp;
             std::chrono::year_month_day ymd{sd};
@@ -227,13 +233,54 @@ public:
         Log::_showTimestampAndLogLevel = enabled;
     }
 
+    //! Set a context, which is added to each log line of the current thread. Used to tell
+    //! ladders apart when processing several ladders at once.
+    static void setContext(const std::string &context)
+    {
+        Log::_context = context;
+    }
+
+    //! Messages collected by a capture.
+    using Messages = std::vector<std::pair<Level, std::string>>;
+
+    //! Collect the messages of the current thread instead of writing them. Used by tasks running
+    //! in parallel, whose messages are written in a fixed order afterwards.
+    static void startCapture();
+
+    //! Stop collecting messages and get the messages collected so far.
+    static Messages stopCapture();
+
+    //! Write captured messages on the current thread (and with its context).
+    static void write(const Messages &messages);
+
+    //! Drop all messages of the current thread. Used while replaying the games many times.
+    static void setMuted(bool muted)
+    {
+        Log::_muted = muted;
+    }
+
 private:
+    //! Check if the message is going to be written. Messages, which are not, are not even formatted.
+    bool isActive() const
+    {
+        return _level != NoLog && _globalLogLevel <= _level && _enabled && !_muted;
+    }
+
     //! The log level.
     Level _level;
 
     //! Do we want timestamps and log levels?
     static bool _showTimestampAndLogLevel;
 
+    //! Context of the current thread.
+    static thread_local std::string _context;
+
+    //! Are messages of the current thread dropped?
+    static thread_local bool _muted;
+
+    //! Captured messages of the current thread. Only set while capturing.
+    static thread_local std::optional<Messages> _captured;
+
     //! The output string stream.
     std::ostringstream _os;
 
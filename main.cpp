@@ -2,37 +2,82 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <optional>
+#include <span>
+#include <thread>
+#include <vector>
 
-#include <mysql_driver.h>
-#include <mysql_connection.h>
-#include <cppconn/prepared_statement.h>
-#include <cppconn/resultset.h>
 #include <nlohmann/json.hpp>
 
+#include "checkpoint.h"
 #include "cplusplus.h"
-#include "databaseconnection.h"
+#include "engineparameters.h"
 #include "game.h"
+#include "gamefilter.h"
 #include "gameoverlay.h"
+#include "gamescache.h"
+#include "gamesource.h"
+#include "gamestore.h"
 #include "logging.h"
 #include "mapstats.h"
 #include "options.h"
 #include "players.h"
+#include "predictionreport.h"
+#include "ratingperiods.h"
 #include "stringtools.h"
+#include "sweep.h"
+#include "threadpool.h"
 
-int main(int argc, char* argv[])
+namespace
 {
-    Options options(argc, argv);
-    if (options.quit())
-        return options.returnValue();
 
-    DatabaseConnection connection(options);
-    if (options.gameMode == gamemodes::Unknown)
+//! Everything needed to process a single ladder.
+struct Ladder
+{
+    Ladder(const Options &ladderOptions) :
+        options(ladderOptions),
+        cache(ladderOptions.ladderAbbreviation)
+    {
+        players.setLazyCatchUp(ladderOptions.lazyCatchUp);
+    }
+
+    //! Options for this ladder.
+    Options options;
+
+    //! All players of this ladder.
+    Players players;
+
+    //! All games of this ladder.
+    GameStore games;
+
+    //! Games rejected by the game filter while fetching.
+    std::map<uint32_t, GameFilter::Rejection> rejectedGames;
+
+    //! Local copy of games, duplicates and users.
+    GamesCache cache;
+
+    //! Ranks of active players and of all time. Only set if the ratings are meant to be written.
+    std::optional<std::pair<std::map<uint32_t, uint32_t>, std::map<uint32_t, uint32_t>>> ranks;
+};
+
+/*!
+ * Load games and users of a ladder. This is the only part, which needs the game source.
+ * There is no source when running offline.
+ */
+bool loadLadder(Ladder &ladder, GameSource *source)
+{
+    const Options &options = ladder.options;
+    Players &players = ladder.players;
+    GameStore &games = ladder.games;
+    GamesCache &cache = ladder.cache;
+
+    if (source != nullptr && options.gameMode == gamemodes::Unknown)
     {
-        if (!connection.ladderExists(options.ladderAbbreviation))
+        if (!source->ladderExists(options.ladderAbbreviation))
         {
             std::cerr << "Game mode '" << options.ladderAbbreviation << "' is no known abbreviation for a ladder." << std::endl;
-            return 1;
+            return false;
         }
         else
         {
@@ -41,32 +86,63 @@ int main(int argc, char* argv[])
         }
     }
 
-    if (!connection.isEstablished())
+    if (options.offline)
+    {
+        if (!cache.load(options.gamesCache) || !cache.isComplete())
+        {
+            Log::error() << "Games cache '" << options.gamesCache.string() << "' can't be used offline.";
+            return false;
+        }
+
+        // Users are only cached for primary accounts, which depend on the duplicate detection.
+        if (!cache.hasDuplicateMapping(options.cncnetDuplicates, options.noDuplicates))
+        {
+            Log::error() << "Games cache '" << options.gamesCache.string() << "' has been written with another duplicate detection.";
+            return false;
+        }
+
+        ladder.rejectedGames = cache.rejectedGames();
+        games = GameStore(cache.takeGames());
+    }
+    else if (options.gamesCache.empty())
     {
-        return 1;
+        GameWatermark watermark;
+        games = GameStore(source->fetchGames(GameFilter(options.gameMode), {}, watermark, ladder.rejectedGames));
     }
+    else
+    {
+        // Only fetch games, which are new or have been modified since the last run.
+        if (!cache.load(options.gamesCache))
+        {
+            Log::info() << "No usable games cache found. Fetching all games.";
+        }
 
-    Log::info();
-    Log::addTimestampAndLogLevel(true);
-    Log::info() << "Running elogen V" << PROJECT_VERSION << ".";
-    Log::info() << "End date is " << options.endDate << ".";
-    Log::info() << "Starting ELO computation.";
+        GameWatermark watermark;
+        std::map<uint32_t, GameFilter::Rejection> rejectedGames;
+        std::map<uint32_t, Game> fetchedGames = source->fetchGames(GameFilter(options.gameMode), cache.watermark(), watermark, rejectedGames);
+        Log::info() << "Fetched " << fetchedGames.size() << " new or modified games.";
 
-    Players players;
-    std::map<uint32_t, Game> games = connection.fetchGames();
+        // Ratings depending on modified games will be recomputed. A checkpoint which includes
+        // these games won't match anymore.
+        std::vector<uint32_t> modifiedGames = cache.update(std::move(fetchedGames), rejectedGames, watermark);
+        Log::info(!modifiedGames.empty()) << modifiedGames.size() << " games have been modified since the last fetch.";
+
+        ladder.rejectedGames = cache.rejectedGames();
+        games = GameStore(cache.takeGames());
+    }
 
     // Collect all user ids involved in games.
     std::map<uint32_t, uint32_t> temporaryUserIds;
     std::set<uint32_t> finalUserIds;
 
-    for (auto it = games.begin(); it != games.end(); ++it)
+    for (const Game &game : games)
     {
-        for (uint32_t i = 0; i < it->second.playerCount(); i++)
+        for (uint32_t i = 0; i < game.playerCount(); i++)
         {
-            temporaryUserIds[it->second.userId(i)]++;
-            if (it->second.userId(i) == 0)
+            temporaryUserIds[game.userId(i)]++;
+            if (game.userId(i) == 0)
             {
-                Log::error() << "Invalid user id in game " << it->second.id() << ".";
+                Log::error() << "Invalid user id in game " << game.id() << ".";
             }
         }
     }
@@ -74,13 +150,9 @@ int main(int argc, char* argv[])
     // Now create the mapping for each user id to its primary account.
     std::unordered_map<uint32_t, uint32_t> duplicateToPrimary;
 
-    if (options.cncnetDuplicates)
+    if (options.offline)
     {
-        duplicateToPrimary = connection.cncnetDuplicateMapping(temporaryUserIds);
-        for (const auto &[duplicate, primary] : duplicateToPrimary)
-        {
-            Log::verbose() << "#" << duplicate << " has primary #" << primary << ".";
-        }
+        duplicateToPrimary = cache.duplicateMapping();
     }
     else if (options.noDuplicates)
     {
@@ -90,38 +162,74 @@ int main(int argc, char* argv[])
             duplicateToPrimary[userId] = userId;
         }
     }
+    else if (options.cncnetDuplicates)
+    {
+        duplicateToPrimary = source->cncnetDuplicateMapping(temporaryUserIds);
+        for (const auto &[duplicate, primary] : duplicateToPrimary)
+        {
+            Log::verbose() << "#" << duplicate << " has primary #" << primary << ".";
+        }
+    }
     else
     {
-        duplicateToPrimary = connection.duplicateToPrimaryMapping(temporaryUserIds);
+        duplicateToPrimary = source->duplicateToPrimaryMapping(temporaryUserIds);
     }
 
     // Not reset all user ids in the games to primary accounts.
-    for (auto it = games.begin(); it != games.end(); ++it)
+    for (Game &game : games)
     {
-        for (uint32_t i = 0; i < it->second.playerCount(); i++)
+        for (uint32_t i = 0; i < game.playerCount(); i++)
         {
-            if (!duplicateToPrimary.contains(it->second.userId(i)))
+            if (!duplicateToPrimary.contains(game.userId(i)))
             {
-                Log::error() << "Missing user id " << it->second.userId(i) << ".";
+                Log::error() << "Missing user id " << game.userId(i) << ".";
             }
-            uint32_t primary = duplicateToPrimary[it->second.userId(i)];
+            uint32_t primary = duplicateToPrimary[game.userId(i)];
             finalUserIds.insert(primary);
-            it->second.setPlayer(i, primary);
+            game.setPlayer(i, primary);
         }
     }
 
     // Finally, load all users.
-    connection.loadUsers(finalUserIds, players);
+    if (options.offline)
+    {
+        cache.restorePlayers(players, options.gameMode);
+    }
+    else
+    {
+        source->loadUsers(finalUserIds, players);
+    }
 
     // Adding tournament games is a hack. Can't add new players afterwards and game ids are fixed.
     if (!options.tournamentFile.empty())
     {
         Log::info() << "Loading tournament games from '" << options.tournamentFile << "'.";
         GameOverlay overlay;
-        overlay.loadTournamentGames(connection, options.tournamentFile, players, options.gameMode, options.ladderAbbreviation, games);
+        overlay.loadTournamentGames(source, options.tournamentFile, players, options.gameMode, options.ladderAbbreviation, games);
         Log::info() << "Tournament games added.";
     }
 
+    // The games cache allows to run offline next time.
+    if (!options.offline && !options.gamesCache.empty())
+    {
+        cache.setDuplicateMapping(duplicateToPrimary, options.cncnetDuplicates, options.noDuplicates);
+        cache.setPlayers(players);
+        cache.save(options.gamesCache);
+    }
+
+    return true;
+}
+
+/*!
+ * Compute ratings and statistics of a ladder and export them. Does not access the database,
+ * so several ladders can be processed in parallel.
+ */
+void processLadder(Ladder &ladder)
+{
+    const Options &options = ladder.options;
+    Players &players = ladder.players;
+    GameStore &games = ladder.games;
+
     // Run 2: Sort out certain games and create a vector of valid games for further processing.
 
     std::vector<Game*> validGames; // Keep a list of valid games.
@@ -129,56 +237,48 @@ int main(int argc, char* argv[])
     std::map<std::string, int> unknownPlayers;
     uint32_t skippedByDuration = 0;
     uint32_t skippedByFPS = 0;
+    uint32_t skippedByMap = 0;
     uint32_t skippedInvalid = 0;
     uint32_t skippedTestGames = 0;
 
-    for (auto it = games.begin(); it != games.end(); ++it)
+    // Most games have been rejected while fetching already. Count them, too.
+    auto countRejection = [&](GameFilter::Rejection rejection) {
+        skippedByDuration += (rejection == GameFilter::Duration) ? 1 : 0;
+        skippedByFPS += (rejection == GameFilter::LowFps) ? 1 : 0;
+        skippedByMap += (rejection == GameFilter::Map) ? 1 : 0;
+    };
+
+    for (const auto &[gameId, rejection] : ladder.rejectedGames)
+    {
+        countRejection(rejection);
+    }
+
+    // Tournament games and games from sources, which don't apply all rules, are checked here.
+    GameFilter filter(options.gameMode);
+
+    for (Game &game : games)
     {
-        Game &game = it->second;
         game.determineWinner();
 
         Log::debug() << "Processing game " << game << " (Run 2).";
 
-        uint32_t duration = game.duration();
-        gametypes::GameType type = game.gameType();
-        uint32_t fps = game.fps();
-        std::string mapName = game.mapName();
+        GameFilter::Rejection rejection = filter.check(game);
+        countRejection(rejection);
 
-        if (game.playerCount() != gamemodes::playerCount(options.gameMode))
+        if (rejection == GameFilter::PlayerCount)
         {
             Log::verbose() << "Skipping game " << game.id() << " due to player count mismatch.";
             continue;
         }
-
-        // Fix high fps values.
-        if (type == gametypes::Quickmatch && duration > 0 && fps > 0)
-        {
-            double factor = static_cast<double>(fps) / 60.0;
-            duration = static_cast<double>(duration) * factor;
-        }
-
-        // Ignore games with less than 35 seconds.
-        if (type == gametypes::Quickmatch && duration != 0 && duration < 35)
+        else if (rejection == GameFilter::LowFps)
         {
-            skippedByDuration++;
+            Log::verbose() << "Skipping game " << game.id() << " due to " << game.fps() << " fps.";
             continue;
         }
-
-        // Ignore games with less than 40 fps.
-        if (type == gametypes::Quickmatch && fps > 1 && fps < 40)
-        {
-            Log::verbose() << "Skipping game " << game.id() << " due to " << fps << " fps.";
-            skippedByFPS++;
-            continue;
-        }
-
-        // Do not consider bot for other game modes than Blitz.
-        if (game.isBot() && options.gameMode != gamemodes::Blitz)
-            continue;
-
-        // Ignore games on non-ELO maps in blitz.
-        if (options.gameMode == gamemodes::Blitz && blitzmap::toIndex(mapName) == -1)
+        else if (rejection == GameFilter::Map)
         {
+            // Ignore games on non-ELO maps in blitz.
+            const std::string &mapName = game.mapName();
             if (!ignoredMaps.contains(mapName))
             {
                 Log::info() << "Ignoring blitz games on map " << mapName << ".";
@@ -187,6 +287,10 @@ int main(int argc, char* argv[])
             ignoredMaps[mapName]++;
             continue;
         }
+        else if (rejection != GameFilter::Accepted)
+        {
+            continue;
+        }
 
         // Ignore games with unknown errors.
         if (!game.isValid())
@@ -206,6 +310,9 @@ int main(int argc, char* argv[])
                 continue;
             }
 
+            // Run 3 accesses players by slot instead of user id.
+            game.setPlayerSlot(j, players.slot(game.userId(j)));
+
             if (players.isTestAccount(game.userId(j)))
             {
                 Log::info() << "Player '" << game.playerName(j) << "' is a test player. "
@@ -223,6 +330,7 @@ int main(int argc, char* argv[])
     // Some information about skipped games.
     Log::info() << "Skipped " << skippedByFPS << " games due to low fps.";
     Log::info() << "Skipped " << skippedByDuration << " games due to duration.";
+    Log::info(options.gameMode == gamemodes::Blitz) << "Skipped " << skippedByMap << " games on maps without elo.";
     Log::info() << "Skipped " << skippedInvalid << " games due to unknown errors.";
     Log::info() << "Skipped " << skippedTestGames << " games from test players.";
 
@@ -231,75 +339,199 @@ int main(int argc, char* argv[])
         return (a->timestamp() + a->duration()) < (b->timestamp() + b->duration());
     });
 
+    // Try other engine parameters instead of computing the ratings.
+    if (!options.sweepGrid.empty())
+    {
+        std::vector<EngineParameters> grid = Sweep::loadGrid(options.sweepGrid, options.gameMode);
+        Log::info() << "Replaying " << validGames.size() << " games for " << grid.size() << " parameter sets.";
+
+        Sweep sweep(players, validGames, options.timeShiftInHours, options.endDate, options.gameMode);
+        std::vector<Sweep::Result> results = sweep.run(grid, options.threads);
+        for (const Sweep::Result &result : results)
+        {
+            Log::info() << "Log-loss " << result.score.meanLogLoss() << ", Brier score " << result.score.meanBrier()
+                        << " for " << result.parameters.toString() << ".";
+        }
+
+        Sweep::exportResults(options.outputDirectory, results);
+        return;
+    }
+
     // Run 3 (compule elo):
 
     MapStats stats(options.gameMode);
+    glicko::solverStatistics() = {};
     std::chrono::time_point<std::chrono::system_clock, std::chrono::days> previousGameDate{};
     std::chrono::time_point<std::chrono::system_clock, std::chrono::days> uninitializedDate{};
     Game *lastProcessedGame = nullptr;
 
-    for (Game *game : validGames)
+    // Only covers the games processed in this run, so none of a checkpoint.
+    std::optional<PredictionReport> predictionReport;
+    if (options.predictionReport)
     {
-        Log::debug() << "UNIX timestamp of game " << game->id() << " is " << game->timestamp() << ".";
+        predictionReport.emplace();
+    }
 
-        std::chrono::milliseconds timestamp = std::chrono::milliseconds(static_cast<uint64_t>(game->timestamp() + game->duration()) * 1000);
-        std::chrono::system_clock::time_point currentTimePoint = std::chrono::system_clock::time_point(timestamp);
-        std::chrono::system_clock::time_point shiftedTime = currentTimePoint + std::chrono::hours(options.timeShiftInHours);
-        std::chrono::time_point<std::chrono::system_clock, std::chrono::days> gameDate = floor<std::chrono::days>(shiftedTime);
+    // Fingerprint of all processed games. Stored in checkpoints.
+    CheckpointParameters checkpointParameters = CheckpointParameters::fromOptions(options);
+    GameDigest digest;
 
-        Log::debug() << "Shifted time of game " << game->id() << " from "
-                       << stringtools::fromDateTime(currentTimePoint) << " to " << stringtools::fromDateTime(shiftedTime) << ".";
+    // The rating day of each game is only computed once.
+    RatingPeriods periods(validGames, options.timeShiftInHours);
 
-        if (gameDate >= options.endDate)
+    // Rating periods skipped because they are covered by a checkpoint.
+    size_t skippedByCheckpoint = 0;
+
+    // Set if the rating period of previousGameDate has been applied already.
+    bool previousDayApplied = false;
+
+    if (!options.resumeFrom.empty())
+    {
+        Checkpoint checkpoint;
+        if (!checkpoint.load(options.resumeFrom, checkpointParameters))
         {
-            break;
+            Log::warning() << "Unable to resume from checkpoint. Processing all games.";
         }
-
-        for (uint32_t j = 0; j < game->playerCount(); j++)
+        else if (checkpoint.lastRatingDay() >= options.endDate)
         {
-            uint32_t id = game->userId(j);
-            factions::Faction faction = game->faction(j);
-            game->setRatingAndDeviation(j, players[id].elo(faction), players[id].deviation(faction));
+            Log::warning() << "Checkpoint is not before the end date. Processing all games.";
         }
-
-        Log::verbose() << "Processing game " << *game << " (Run 3).";
-
-        // Date switch. Update players ELO values. If there are no valid games, no update is made and deviation won't
-        // increase. It is more likely that technical reason prevented playing rather than no player showed up for
-        // an entire day.
-        if (previousGameDate != uninitializedDate && gameDate != previousGameDate)
+        else
         {
-            Log::info() << "Apply update for " << stringtools::fromDate(previousGameDate);
-            players.update();
-
-            // In contrast to the local ELO list, the result are for the current day, which means that
-            // your peak rating is set to the day where you achieved it and not they day after, when it's visible
-            // for the first time.
-            players.apply(previousGameDate, true, options.gameMode);
-
-            // Apply a decay if the number of days without a game is greater than 3.
-            // This is probably not a technical issue anymore, but players losing interest.
-            int64_t dayDifference = (gameDate - previousGameDate).count();
-            if (dayDifference > 3)
+            // All games up to the last rating period of the checkpoint must be exactly the same.
+            size_t periodCount = periods.firstAfter(checkpoint.lastRatingDay());
+            size_t gameCount = periods.gamesBefore(periodCount);
+            GameDigest checkpointDigest;
+            for (size_t i = 0; i < gameCount; i++)
             {
-                Log::info() << (dayDifference - 3) << " days since last game. Applying decay for " << (dayDifference - 3) << " days.";
-                players.decay(dayDifference - 3, options.gameMode);
+                checkpointDigest.add(*validGames[i]);
             }
 
-            previousGameDate = gameDate;
+            if (checkpointDigest != checkpoint.digest())
+            {
+                Log::warning() << "Games up to " << stringtools::fromDate(checkpoint.lastRatingDay()) << " have changed since "
+                               << "the checkpoint has been written. Processing all games.";
+            }
+            else if (!checkpoint.restore(players, stats, options.gameMode))
+            {
+                Log::warning() << "Unable to restore checkpoint. Processing all games.";
+            }
+            else
+            {
+                // Quick match names are not part of the checkpoint, because they are loaded again anyway.
+                // Only the number of times they have been used needs to be restored.
+                for (size_t i = 0; i < gameCount; i++)
+                {
+                    if (validGames[i]->gameType() == gametypes::Quickmatch)
+                    {
+                        for (uint32_t j = 0; j < validGames[i]->playerCount(); j++)
+                        {
+                            players[validGames[i]->userId(j)].increasePlayerNameUsage(validGames[i]->playerName(j));
+                        }
+                    }
+                }
+
+                digest = checkpointDigest;
+                skippedByCheckpoint = periodCount;
+                previousGameDate = checkpoint.lastRatingDay();
+                previousDayApplied = true;
+                Log::info() << "Resuming after " << gameCount << " games from checkpoint.";
+            }
         }
+    }
+
+    for (size_t periodIndex = skippedByCheckpoint; periodIndex < periods.size(); periodIndex++)
+    {
+        const RatingDay &period = periods[periodIndex];
+        std::chrono::sys_days gameDate = period.day;
 
-        for (uint32_t j = 0; j < game->playerCount(); j++)
+        if (gameDate >= options.endDate)
         {
-            players[game->userId(j)].processGame(*game, j, false, players);
+            break;
         }
 
-        // Update map stats.
-        stats.processGame(*game, players);
-        lastProcessedGame = game;
+        Log::debug() << "Processing " << period.games.size() << " games of " << stringtools::fromDate(gameDate) << ".";
+
+        for (Game *game : period.games)
+        {
+            for (uint32_t j = 0; j < game->playerCount(); j++)
+            {
+                const Player &player = players.participant(*game, j);
+                factions::Faction faction = game->faction(j);
+
+                // The first game of a day is processed before the previous day is applied. After resuming, the previous
+                // day has been applied already, so take the ratings from before.
+                if (previousDayApplied)
+                {
+                    game->setRatingAndDeviation(j, player.yesterdaysElo(faction), player.yesterdaysDeviation(faction));
+                }
+                else
+                {
+                    game->setRatingAndDeviation(j, player.elo(faction), player.deviation(faction));
+                }
+            }
+
+            Log::verbose() << "Processing game " << *game << " (Run 3).";
+
+            // Date switch. Update players ELO values. If there are no valid games, no update is made and deviation won't
+            // increase. It is more likely that technical reason prevented playing rather than no player showed up for
+            // an entire day.
+            if (previousGameDate != uninitializedDate && gameDate != previousGameDate)
+            {
+                // Already applied if the day was restored from a checkpoint.
+                if (!previousDayApplied)
+                {
+                    Log::info() << "Apply update for " << stringtools::fromDate(previousGameDate);
+                    players.update();
+
+                    // In contrast to the local ELO list, the result are for the current day, which means that
+                    // your peak rating is set to the day where you achieved it and not they day after, when it's visible
+                    // for the first time.
+                    players.apply(previousGameDate, true, options.gameMode);
+                }
+                previousDayApplied = false;
+
+                // Apply a decay if the number of days without a game is greater than 3.
+                // This is probably not a technical issue anymore, but players losing interest.
+                int64_t dayDifference = (gameDate - previousGameDate).count();
+                if (dayDifference > 3)
+                {
+                    Log::info() << (dayDifference - 3) << " days since last game. Applying decay for " << (dayDifference - 3) << " days.";
+                    players.decay(dayDifference - 3, options.gameMode);
+                }
+
+                previousGameDate = gameDate;
+            }
+
+            // Scored with the ratings at the start of the day for all games of the day. The ratings set to the first
+            // game of a day above don't include the previous day yet.
+            if (predictionReport.has_value())
+            {
+                Game scoredGame = *game;
+                for (uint32_t j = 0; j < scoredGame.playerCount(); j++)
+                {
+                    const Player &player = players.participant(scoredGame, j);
+                    scoredGame.setRatingAndDeviation(j, player.elo(scoredGame.faction(j)), player.deviation(scoredGame.faction(j)));
+                }
+                predictionReport->add(scoredGame, gameDate);
+            }
+
+            for (uint32_t j = 0; j < game->playerCount(); j++)
+            {
+                players.participant(*game, j).processGame(*game, j, false, players);
+            }
+            players.headToHead().addGame(*game);
+
+            // Update map stats.
+            stats.processGame(*game, players);
+            digest.add(*game);
+            lastProcessedGame = game;
+
+        } // for (Game *game : period.games)
+
         previousGameDate = gameDate;
 
-    } // for (Game *game : validGames)
+    } // for (periodIndex)
 
     // Process the last day.
     if (players.hasPendingGames())
@@ -309,12 +541,54 @@ int main(int argc, char* argv[])
         players.apply(previousGameDate, true, options.gameMode);
     }
 
+    players.catchUp();
+
+    if (predictionReport.has_value())
+    {
+        Log::info() << "Predicted results of " << predictionReport->overall().games << " games: log-loss "
+                    << predictionReport->overall().meanLogLoss() << ", Brier score " << predictionReport->overall().meanBrier() << ".";
+    }
+
+    // Save the state before finalizing, which is not meant to be continued.
+    if (!options.saveCheckpoint.empty())
+    {
+        if (previousGameDate == uninitializedDate)
+        {
+            Log::warning() << "No games processed. Checkpoint not saved.";
+        }
+        else
+        {
+            Checkpoint::save(options.saveCheckpoint, checkpointParameters, previousGameDate, digest, players, stats);
+        }
+    }
+
+    // Make slow convergence of the volatility visible.
+    const glicko::SolverStatistics &solverStatistics = glicko::solverStatistics();
+    Log::info() << "Volatility solver: " << solverStatistics.calls << " calls, " << solverStatistics.iterations << " iterations, "
+                << "at most " << solverStatistics.maxIterations << " per call, " << solverStatistics.relaxations << " relaxations, "
+                << solverStatistics.unconverged << " times without convergence.";
+    for (const auto &[userId, iterations] : solverStatistics.worstPlayers)
+    {
+        Log::info() << "Volatility solver needed " << iterations << " iterations for a single update of player "
+                    << players[userId].alias() << " (" << userId << ").";
+    }
+    if (solverStatistics.initialRatingSearches > 0)
+    {
+        Log::info() << "Initial rating search: " << solverStatistics.initialRatingSearches << " players, "
+                    << solverStatistics.initialRatingTrials << " trials, "
+                    << std::chrono::duration<double, std::milli>(solverStatistics.initialRatingTime).count() / solverStatistics.initialRatingSearches
+                    << " ms per player.";
+    }
+
     players.finalize();
 
-    Log::info(lastProcessedGame != nullptr) << "Last game processed: " << *lastProcessedGame;
+    if (lastProcessedGame != nullptr)
+    {
+        Log::info() << "Last game processed: " << *lastProcessedGame;
+    }
 
     if (options.dryRun)
-        return 0;
+        return;
 
     std::map<uint32_t, uint32_t> activeRanks = players.exportActivePlayers(options.outputDirectory, options.gameMode);
     std::map<uint32_t, uint32_t> allTimeRanks = players.exportBestOfAllTime(options.outputDirectory, options.gameMode);
@@ -339,8 +613,8 @@ int main(int argc, char* argv[])
     Log::info() << "Processed " << validGames.size() << " games. About to finalize stats.";
 
     stats.finalize(options.outputDirectory, players, floor<std::chrono::days>(std::chrono::system_clock::now()) - std::chrono::days{1});
-    stats.exportUpsets(options.outputDirectory, players);
-    stats.exportLongestGames(options.outputDirectory, players);
+    stats.exportUpsets(options.outputDirectory, players, games);
+    stats.exportLongestGames(options.outputDirectory, players, games);
     stats.exportBestTeams(options.outputDirectory, players);
 
     // Map stats and player details not suitable for 2v2 games.
@@ -351,10 +625,114 @@ int main(int argc, char* argv[])
     }
     Log::info() << "Exported map stats.";
 
+    if (predictionReport.has_value())
+    {
+        predictionReport->exportReport(options.outputDirectory, options.gameMode);
+    }
+
+    ladder.ranks = std::make_pair(std::move(activeRanks), std::move(allTimeRanks));
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    Options options(argc, argv);
+    if (options.quit())
+        return options.returnValue();
+
+    glicko::setVolatilitySolver(options.volatilitySolver);
+    glicko::setInitialRatingSearch(options.initialRatingSearch);
+
+    // Running offline takes everything from the games cache.
+    std::unique_ptr<GameSource> source;
+    if (!options.offline)
+    {
+        source = GameSource::create(options);
+        if (!source->isEstablished())
+        {
+            return 1;
+        }
+    }
+
+    Log::info();
+    Log::addTimestampAndLogLevel(true);
+    Log::info() << "Running elogen V" << PROJECT_VERSION << ".";
+    Log::info() << "End date is " << options.endDate << ".";
+    Log::info() << "Starting ELO computation.";
+
+    // Loading uses a single source and is done one ladder after another. Users and
+    // duplicates shared by several ladders are only loaded once.
+    std::vector<std::unique_ptr<Ladder>> ladders;
+    for (const std::string &abbreviation : options.ladderAbbreviations)
+    {
+        ladders.push_back(std::make_unique<Ladder>(options.forLadder(abbreviation)));
+
+        if (source != nullptr)
+        {
+            source->setLadder(abbreviation);
+        }
+
+        Log::setContext(options.ladderAbbreviations.size() > 1 ? abbreviation : "");
+        if (!loadLadder(*ladders.back(), source.get()))
+        {
+            return 1;
+        }
+    }
+
+    Log::setContext("");
+
+    // Players of all ladders share the threads for the end of the day.
+    std::unique_ptr<ThreadPool> threadPool;
+    if (options.threads > 1)
+    {
+        threadPool = std::make_unique<ThreadPool>(options.threads);
+        for (std::unique_ptr<Ladder> &ladder : ladders)
+        {
+            ladder->players.setThreadPool(threadPool.get());
+        }
+    }
+
+    if (ladders.size() == 1)
+    {
+        processLadder(*ladders.front());
+    }
+    else
+    {
+        Log::info() << "Processing " << ladders.size() << " ladders in parallel.";
+
+        std::vector<std::jthread> threads;
+        for (std::unique_ptr<Ladder> &ladder : ladders)
+        {
+            threads.emplace_back([&ladder]() {
+                Log::setContext(ladder->options.ladderAbbreviation);
+                processLadder(*ladder);
+            });
+        }
+    }
+
     // Player ratings.
-    Log::info() << "Updating table `user_ratings`.";
-    connection.writePlayerRatings(options.gameMode, players, activeRanks, allTimeRanks);
+    for (const std::unique_ptr<Ladder> &ladder : ladders)
+    {
+        Log::setContext(ladders.size() > 1 ? ladder->options.ladderAbbreviation : "");
+
+        if (!ladder->ranks.has_value())
+        {
+            continue;
+        }
+        else if (options.offline)
+        {
+            Log::warning() << "Running offline. Table `user_ratings` is not updated.";
+        }
+        else
+        {
+            Log::info() << "Writing player ratings.";
+            source->setLadder(ladder->options.ladderAbbreviation);
+            source->writePlayerRatings(ladder->options.gameMode, ladder->players, ladder->ranks->first, ladder->ranks->second);
+        }
+    }
 
+    Log::setContext("");
     Log::info() << "All done.";
     return 0;
 }
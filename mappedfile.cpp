@@ -0,0 +1,89 @@
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logging.h"
+#include "mappedfile.h"
+
+/*!
+ */
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+/*!
+ */
+bool MappedFile::open(const std::filesystem::path &file)
+{
+    close();
+
+    int descriptor = ::open(file.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        Log::warning() << "Unable to open '" << file.string() << "': " << std::strerror(errno);
+        return false;
+    }
+
+    struct stat status;
+    if (::fstat(descriptor, &status) != 0 || status.st_size <= 0)
+    {
+        Log::warning() << "Unable to map '" << file.string() << "', because it is empty or can't be accessed.";
+        ::close(descriptor);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(status.st_size);
+    void *data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+    // The mapping stays valid after closing the file descriptor.
+    ::close(descriptor);
+
+    if (data == MAP_FAILED)
+    {
+        Log::warning() << "Unable to map '" << file.string() << "': " << std::strerror(errno);
+        return false;
+    }
+
+    _data = data;
+    _size = size;
+
+    return true;
+}
+
+/*!
+ */
+void MappedFile::close()
+{
+    if (_data != nullptr)
+    {
+        ::munmap(_data, _size);
+        _data = nullptr;
+        _size = 0;
+    }
+}
+
+/*!
+ */
+bool MappedFile::isOpen() const
+{
+    return _data != nullptr;
+}
+
+/*!
+ */
+const char* MappedFile::data() const
+{
+    return static_cast<const char*>(_data);
+}
+
+/*!
+ */
+size_t MappedFile::size() const
+{
+    return _size;
+}
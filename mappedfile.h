@@ -0,0 +1,46 @@
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+/*!
+ * Read-only memory mapping of a whole file. The operating system only loads the pages,
+ * which are actually accessed, and shares them between processes.
+ */
+class MappedFile
+{
+public:
+    //! Constructor. Nothing is mapped yet.
+    MappedFile() = default;
+
+    //! Destructor. Unmaps the file.
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //! Map the given file. A previously mapped file is unmapped. Logs a warning and
+    //! returns false on failure.
+    bool open(const std::filesystem::path &file);
+
+    //! Unmap the file.
+    void close();
+
+    //! Check if a file is mapped.
+    bool isOpen() const;
+
+    //! Start of the mapped file. Page aligned.
+    const char* data() const;
+
+    //! Size of the mapped file.
+    size_t size() const;
+
+private:
+    //! Start of the mapping.
+    void *_data = nullptr;
+
+    //! Size of the mapping.
+    size_t _size = 0;
+
+}; // class MappedFile
@@ -3,8 +3,10 @@
 #include <fstream>
 #include <regex>
 
+#include "binarystream.h"
 #include "blitzmap.h"
 #include "cplusplus.h"
+#include "gamestore.h"
 #include "knownplayers.h"
 #include "players.h"
 #include "logging.h"
@@ -14,11 +16,82 @@
 // TODO:
 // - Most games a day/month/year
 
+namespace
+{
+
+/*!
+ * Upset or long game with the ratings of the winners and losers.
+ */
+Upset makeUpset(const Game &game, double eloDifference)
+{
+    Upset upset;
+    upset.gameId = game.id();
+    upset.date = game.date();
+    upset.eloDifference = eloDifference;
+
+    size_t winners = 0;
+    size_t losers = 0;
+    for (uint32_t i = 0; i < game.playerCount(); i++)
+    {
+        std::array<int, 2> &elo = game.hasWon(i) ? upset.winnerElo : upset.loserElo;
+        size_t &count = game.hasWon(i) ? winners : losers;
+        if (count < elo.size())
+        {
+            elo[count++] = static_cast<int>(game.rating(i));
+        }
+    }
+
+    return upset;
+}
+
+/*!
+ * Faction of a team. Combined, if the players have different factions.
+ */
+factions::Faction teamFaction(const std::vector<factions::Faction> &factions)
+{
+    if (std::all_of(factions.begin(), factions.end(),
+        [&](factions::Faction faction){ return faction == factions::Soviet; }))
+    {
+        return factions::Soviet;
+    }
+    else if (std::all_of(factions.begin(), factions.end(),
+        [&](factions::Faction faction){ return faction == factions::Allied; }))
+    {
+        return factions::Allied;
+    }
+    else if (std::all_of(factions.begin(), factions.end(),
+        [&](factions::Faction faction){ return faction == factions::Yuri; }))
+    {
+        return factions::Yuri;
+    }
+
+    return factions::Combined;
+}
+
+/*!
+ * User ids and factions of the winners or losers of a game.
+ */
+std::pair<std::vector<uint32_t>, std::vector<factions::Faction>> team(const Game &game, bool winners)
+{
+    std::pair<std::vector<uint32_t>, std::vector<factions::Faction>> result;
+    for (uint32_t i = 0; i < game.playerCount(); i++)
+    {
+        if (game.hasWon(i) == winners)
+        {
+            result.first.push_back(game.userId(i));
+            result.second.push_back(game.faction(i));
+        }
+    }
+
+    return result;
+}
+
+}
+
 /*!
  */
 MapStats::MapStats(gamemodes::GameMode gameMode) :
-    _gameMode(gameMode),
-    _longestGames([](const Upset &a, const Upset &b) { return a.duration > b.duration; })
+    _gameMode(gameMode)
 {
 }
 
@@ -28,44 +101,20 @@ void MapStats::processGame(const Game &game, const Players &players)
 {
     dts::unused(players);
 
-    static std::set<std::string> ignoredMaps;
-
     int mapIndex = blitzmap::toIndex(game.mapName());
 
     if (_gameMode == gamemodes::Blitz && mapIndex < 0)
     {
         // Not interested in some maps.
-        if (ignoredMaps.find(game.mapName()) == ignoredMaps.end())
+        if (_ignoredMaps.find(game.mapName()) == _ignoredMaps.end())
         {
             Log::info() << "Ignoring map '" << game.mapName() << "' while making map stats.";
-            ignoredMaps.insert(game.mapName());
+            _ignoredMaps.insert(game.mapName());
         }
         return;
     }
 
-    std::string mapName = (_gameMode == gamemodes::Blitz) ? blitzmap::__names[mapIndex] : game.mapName();
-
-    // Normalize map name for RA2.
-    if (_gameMode == gamemodes::RedAlert2 && mapName.size() > 2)
-    {
-        if (mapName[0] >= '0' && mapName[0] <= '9')
-        {
-            mapName.erase(mapName.begin());
-        }
-        while (mapName[0] == ' ')
-        {
-            mapName.erase(mapName.begin());
-        }
-        std::regex reParenthesis("\\(.*?\\)");
-        mapName = std::regex_replace(mapName, reParenthesis, "");
-        std::regex reDoubleSpace("\\s{2,}");
-        mapName = std::regex_replace(mapName, reDoubleSpace, " ");
-
-        while (mapName[mapName.size() - 1] == ' ')
-        {
-            mapName.erase(std::prev(mapName.end()));
-        }
-    }
+    std::string mapName = this->mapName(game);
 
     std::chrono::year_month_day keyDate{game.date().year(), game.date().month(), std::chrono::day{1}};
     std::chrono::sys_days gameDate = game.sysDate();
@@ -87,36 +136,6 @@ void MapStats::processGame(const Game &game, const Players &players)
         return;
     }
 
-    auto losers = [&](const Game& g) -> std::vector<uint32_t> {
-        return g.collectFromParticipants<uint32_t>([](const Game::Participant& p) {
-                return std::pair<uint32_t, bool>{p.userId, !p.hasWon};
-            });};
-
-    auto winners = [&](const Game& g) -> std::vector<uint32_t> {
-        return g.collectFromParticipants<uint32_t>([](const Game::Participant& p) {
-            return std::pair<uint32_t, bool>{p.userId, p.hasWon};
-        });};
-
-    auto winnersFactions =  [&](const Game& g) -> std::vector<factions::Faction> {
-        return g.collectFromParticipants<factions::Faction>([](const Game::Participant& p) {
-            return std::pair<factions::Faction, bool>{p.faction, p.hasWon};
-        });};
-
-    auto losersFactions =  [&](const Game& g) -> std::vector<factions::Faction> {
-        return g.collectFromParticipants<factions::Faction>([](const Game::Participant& p) {
-            return std::pair<factions::Faction, bool>{p.faction, !p.hasWon};
-        });};
-
-    auto winnersELOs = [&](const Game& g) -> std::vector<int> {
-        return g.collectFromParticipants<int>([](const Game::Participant& p) {
-            return std::pair<int, bool>{p.elo, p.hasWon};
-        });};
-
-    auto losersELOs = [&](const Game& g) -> std::vector<int> {
-        return g.collectFromParticipants<int>([](const Game::Participant& p) {
-            return std::pair<int, bool>{p.elo, !p.hasWon};
-        });};
-
     // Process potential upset.
     double diff = game.differenceForGreatestDefeat();
     if (diff > 300.0)
@@ -126,19 +145,8 @@ void MapStats::processGame(const Game &game, const Players &players)
             game.allParticipants([&](const Game::Participant& p) {
                 return p.hasWon || (!p.hasWon && (p.deviation < 120.0 || players[p.userId].wasActive())); }))
         {
-            std::vector<uint32_t> winnerIds = winners(game);
-            std::vector<uint32_t> loserIds = losers(game);
-            std::vector<factions::Faction> winnerFactions = winnersFactions(game);
-            std::vector<factions::Faction> loserFactions = losersFactions(game);
-            std::vector<int> winnerELOs = winnersELOs(game);
-            std::vector<int> loserELOs = losersELOs(game);
-
-            Upset upset{ game.date(), winnerIds, loserIds, mapName, winnerFactions, loserFactions, winnerELOs, loserELOs, diff };
-            _upsetsMonthly[keyDate].insert(upset);
-            if (_upsetsMonthly[keyDate].size() > 20)
-            {
-                _upsetsMonthly[keyDate].erase(std::prev(_upsetsMonthly[keyDate].end()));
-            }
+            Upset upset = makeUpset(game, diff);
+            _upsetsMonthly[keyDate].add(upset);
 
             std::chrono::time_point<std::chrono::system_clock, std::chrono::days> today
                 = std::chrono::floor<std::chrono::days>(std::chrono::system_clock::now());
@@ -148,11 +156,7 @@ void MapStats::processGame(const Game &game, const Players &players)
 
             if (gameDate >= yearBoundary)
             {
-                _upsetsLast12Month.insert(upset);
-            }
-            if (_upsetsLast12Month.size() > 50)
-            {
-                _upsetsLast12Month.erase(std::prev(_upsetsLast12Month.end()));
+                _upsetsLast12Month.add(upset);
             }
 
             std::chrono::time_point<std::chrono::system_clock, std::chrono::days> monthBoundary
@@ -161,18 +165,10 @@ void MapStats::processGame(const Game &game, const Players &players)
 
             if (gameDate >= monthBoundary)
             {
-                _upsetsLast30Days.insert(upset);
-            }
-            if (_upsetsLast30Days.size() > 50)
-            {
-                _upsetsLast30Days.erase(std::prev(_upsetsLast30Days.end()));
+                _upsetsLast30Days.add(upset);
             }
 
-            _upsetsAllTime.insert(upset);
-            if (_upsetsAllTime.size() > 100)
-            {
-                _upsetsAllTime.erase(std::prev(_upsetsAllTime.end()));
-            }
+            _upsetsAllTime.add(upset);
         }
     }
 
@@ -198,8 +194,8 @@ void MapStats::processGame(const Game &game, const Players &players)
         uint64_t winnerTeamId = ((*winnerIds.begin()) << 32) | *winnerIds.rbegin();
         uint64_t loserTeamId = ((*loserIds.begin()) << 32) | *loserIds.rbegin();
 
-        Probabilities &probsWinners = _teamStats[winnerTeamId];
-        Probabilities &probsLosers = _teamStats[loserTeamId];
+        Probabilities &probsWinners = _teamStats.try_emplace(winnerTeamId, true).first->second;
+        Probabilities &probsLosers = _teamStats.try_emplace(loserTeamId, true).first->second;
 
         double winnerFirstElo = (winners[0].userId < winners[1].userId) ? winners[1].elo : winners[0].elo;
         double winnerSecondElo = (winners[1].userId > winners[0].userId) ? winners[0].elo : winners[1].elo;
@@ -223,12 +219,9 @@ void MapStats::processGame(const Game &game, const Players &players)
     {
         // First, we normalize the duration.
         uint32_t duration = game.duration() * game.fps() / 59;
-        Upset upset{ game.date(), winners(game), losers(game), mapName, winnersFactions(game), losersFactions(game), winnersELOs(game), losersELOs(game), diff, duration };
-        _longestGames.insert(upset);
-        if (_longestGames.size() > 25)
-        {
-            _longestGames.erase(std::prev(_longestGames.end()));
-        }
+        Upset upset = makeUpset(game, diff);
+        upset.duration = duration;
+        _longestGames.add(upset);
     }
 
     // Now do the real map stats. Only interested in different faction games.
@@ -326,6 +319,38 @@ void MapStats::processGame(const Game &game, const Players &players)
 
 } // void MapStats::processGame(const Game &game, const Players &players)
 
+/*!
+ */
+std::string MapStats::mapName(const Game &game) const
+{
+    int mapIndex = blitzmap::toIndex(game.mapName());
+    std::string mapName = (_gameMode == gamemodes::Blitz && mapIndex >= 0) ? blitzmap::__names[mapIndex] : game.mapName();
+
+    // Normalize map name for RA2.
+    if (_gameMode == gamemodes::RedAlert2 && mapName.size() > 2)
+    {
+        if (mapName[0] >= '0' && mapName[0] <= '9')
+        {
+            mapName.erase(mapName.begin());
+        }
+        while (mapName[0] == ' ')
+        {
+            mapName.erase(mapName.begin());
+        }
+        std::regex reParenthesis("\\(.*?\\)");
+        mapName = std::regex_replace(mapName, reParenthesis, "");
+        std::regex reDoubleSpace("\\s{2,}");
+        mapName = std::regex_replace(mapName, reDoubleSpace, " ");
+
+        while (mapName[mapName.size() - 1] == ' ')
+        {
+            mapName.erase(std::prev(mapName.end()));
+        }
+    }
+
+    return mapName;
+}
+
 /*!
  */
 void MapStats::finalize(const std::filesystem::path &directory, const Players &players, std::chrono::sys_days date)
@@ -671,7 +696,7 @@ void MapStats::exportMapsPlayed(const std::filesystem::path &directory)
 
 /*!
  */
-void MapStats::exportLongestGames(const std::filesystem::path &directory, const Players &players)
+void MapStats::exportLongestGames(const std::filesystem::path &directory, const Players &players, const GameStore &games)
 {
     using json = nlohmann::json;
 
@@ -681,7 +706,11 @@ void MapStats::exportLongestGames(const std::filesystem::path &directory, const
 
     for (auto it = _longestGames.begin(); it != _longestGames.end(); ++it)
     {
-        if (it->winners.empty() || it->losers.empty())
+        const Game &game = games.at(it->gameId);
+        auto [winners, winnerFactions] = team(game, true);
+        auto [losers, loserFactions] = team(game, false);
+
+        if (winners.empty() || losers.empty())
         {
             Log::error() << "No winners or losers while exporting longest game.";
             continue;
@@ -690,14 +719,14 @@ void MapStats::exportLongestGames(const std::filesystem::path &directory, const
         json jLongestGame = json::object();
         jLongestGame["rank"] = rank++;
         jLongestGame["date"] = stringtools::fromDate(it->date);
-        jLongestGame["winner"] = players[it->winners.front()].alias() +
-                                 ((it->winners.size() > 1) ? "/" + players[it->winners[1]].alias() : "");
-        jLongestGame["loser"] = players[it->losers.front()].alias() +
-                                ((it->losers.size() > 1) ? "/" + players[it->losers[1]].alias() : "");
-
-        jLongestGame["winner_faction"] = factions::shortName(it->winnerFaction());
-        jLongestGame["loser_faction"] = factions::shortName(it->loserFaction());
-        jLongestGame["map"] = it->map;
+        jLongestGame["winner"] = players[winners.front()].alias() +
+                                 ((winners.size() > 1) ? "/" + players[winners[1]].alias() : "");
+        jLongestGame["loser"] = players[losers.front()].alias() +
+                                ((losers.size() > 1) ? "/" + players[losers[1]].alias() : "");
+
+        jLongestGame["winner_faction"] = factions::shortName(teamFaction(winnerFactions));
+        jLongestGame["loser_faction"] = factions::shortName(teamFaction(loserFactions));
+        jLongestGame["map"] = mapName(game);
         jLongestGame["duration_seconds"] = it->duration;
         jLongestGames.push_back(jLongestGame);
     }
@@ -795,7 +824,7 @@ void MapStats::exportBestTeams(const std::filesystem::path &directory, const Pla
 
 /*!
  */
-void MapStats::exportUpsets(const std::filesystem::path &directory, const Players &players)
+void MapStats::exportUpsets(const std::filesystem::path &directory, const Players &players, const GameStore &games)
 {
     // Now process upsets.
     for (auto it = _upsetsMonthly.begin(); it != _upsetsMonthly.end(); ++it)
@@ -806,16 +835,19 @@ void MapStats::exportUpsets(const std::filesystem::path &directory, const Player
         std::stringstream ss;
         ss << gamemodes::shortName(_gameMode) << "_upsets_" << year << "-" << (month < 10 ? "0" : "") << month << ".json";
 
-        exportUpsets(directory, it->second, ss.str(), "", players);
+        exportUpsets(directory, { it->second.begin(), it->second.end() }, ss.str(), "", players, games);
     }
 
-    exportUpsets(directory, _upsetsLast12Month, gamemodes::shortName(_gameMode) + "_upsets_last12month.json", "Upsets within the last 12 month", players);
+    exportUpsets(directory, { _upsetsLast12Month.begin(), _upsetsLast12Month.end() }, gamemodes::shortName(_gameMode) + "_upsets_last12month.json",
+                 "Upsets within the last 12 month", players, games);
     Log::verbose() << "Exported biggest upsets of the last 12 month.";
 
-    exportUpsets(directory, _upsetsLast30Days, gamemodes::shortName(_gameMode) + "_upsets_last30days.json", "Upsets within the last 30 days", players);
+    exportUpsets(directory, { _upsetsLast30Days.begin(), _upsetsLast30Days.end() }, gamemodes::shortName(_gameMode) + "_upsets_last30days.json",
+                 "Upsets within the last 30 days", players, games);
     Log::verbose() << "Exported biggest upsets of the last 30 days.";
 
-    exportUpsets(directory, _upsetsAllTime, gamemodes::shortName(_gameMode) + "_upsets_alltime.json", "Biggest upsets of all time", players);
+    exportUpsets(directory, { _upsetsAllTime.begin(), _upsetsAllTime.end() }, gamemodes::shortName(_gameMode) + "_upsets_alltime.json",
+                 "Biggest upsets of all time", players, games);
     Log::verbose() << "Exported biggest upsets of all time..";
 }
 
@@ -823,10 +855,11 @@ void MapStats::exportUpsets(const std::filesystem::path &directory, const Player
  */
 void MapStats::exportUpsets(
     const std::filesystem::path &directory,
-    const std::multiset<Upset> &upsets,
+    std::span<const Upset> upsets,
     const std::string &filename,
     const std::string &description,
-    const Players &players) const
+    const Players &players,
+    const GameStore &games) const
 {
     using json = nlohmann::json;
 
@@ -852,19 +885,24 @@ void MapStats::exportUpsets(
         json jUpset = json::object();
         jUpset["rank"] = rank++;
         jUpset["date"] = stringtools::fromDate(it->date);
+
+        const Game &game = games.at(it->gameId);
+        auto [winners, winnerFactions] = team(game, true);
+        auto [losers, loserFactions] = team(game, false);
+
         jUpset["winner"] =
-            players[it->winners[0]].alias() + ((it->winners.size() == 1) ? "" :
+            players[winners[0]].alias() + ((winners.size() == 1) ? "" :
             " (" + std::to_string(it->winnerElo[0]) + ") / "
-            + players[it->winners[1]].alias() + " (" + std::to_string(it->winnerElo[1]) + ")");
+            + players[winners[1]].alias() + " (" + std::to_string(it->winnerElo[1]) + ")");
 
         jUpset["loser"] =
-            players[it->losers[0]].alias() + ((it->losers.size() == 1) ? "" :
+            players[losers[0]].alias() + ((losers.size() == 1) ? "" :
             " (" + std::to_string(it->loserElo[0]) + ") / "
-            + players[it->losers[1]].alias() + " (" + std::to_string(it->loserElo[1]) + ")");
+            + players[losers[1]].alias() + " (" + std::to_string(it->loserElo[1]) + ")");
 
-        jUpset["faction_winner"] = factions::shortName(it->winnerFaction());
-        jUpset["faction_loser"] = factions::shortName(it->loserFaction());
-        jUpset["map"] = it->map;
+        jUpset["faction_winner"] = factions::shortName(teamFaction(winnerFactions));
+        jUpset["faction_loser"] = factions::shortName(teamFaction(loserFactions));
+        jUpset["map"] = mapName(game);
         jUpset["rating_difference"] = "\u2265 " + std::to_string(static_cast<int>(it->eloDifference));
         jUpsets.push_back(jUpset);
     }
@@ -875,3 +913,90 @@ void MapStats::exportUpsets(
     stream << std::setw(4) << data << std::endl;
     stream.close();
 }
+
+/*!
+ */
+void MapStats::writeState(BinaryWriter &writer) const
+{
+    writer.write(_gameCount);
+    for (const std::map<std::string, Probabilities> &mapStats : _mapStats)
+    {
+        writer.write(mapStats);
+    }
+    writer.write(_teamStats);
+    writer.write(_lastTeamELOs);
+    writer.write(_gameCountsPerMonthAndPlayer);
+    writer.write(_averageDuration);
+    writer.write(_upsetsMonthly);
+    writer.write(_upsetsLast12Month);
+    writer.write(_upsetsLast30Days);
+    writer.write(_upsetsAllTime);
+    writer.write(_longestGames);
+}
+
+/*!
+ */
+void MapStats::readState(BinaryReader &reader)
+{
+    reader.read(_gameCount);
+    for (std::map<std::string, Probabilities> &mapStats : _mapStats)
+    {
+        reader.read(mapStats);
+    }
+    reader.read(_teamStats);
+    reader.read(_lastTeamELOs);
+    reader.read(_gameCountsPerMonthAndPlayer);
+    reader.read(_averageDuration);
+    reader.read(_upsetsMonthly);
+    reader.read(_upsetsLast12Month);
+    reader.read(_upsetsLast30Days);
+    reader.read(_upsetsAllTime);
+    reader.read(_longestGames);
+
+    std::chrono::sys_days today = std::chrono::floor<std::chrono::days>(std::chrono::system_clock::now());
+
+    _upsetsLast12Month.eraseIf([&](const Upset &upset) { return std::chrono::sys_days(upset.date) < today - std::chrono::days(365); });
+    _upsetsLast30Days.eraseIf([&](const Upset &upset) { return std::chrono::sys_days(upset.date) < today - std::chrono::days(31); });
+}
+
+/*!
+ */
+void MapPlayed::writeState(BinaryWriter &writer) const
+{
+    writer.write(mapName);
+    writer.write(count);
+    writer.write(differentPlayers);
+}
+
+/*!
+ */
+void MapPlayed::readState(BinaryReader &reader)
+{
+    reader.read(mapName);
+    reader.read(count);
+    reader.read(differentPlayers);
+}
+
+/*!
+ */
+void Upset::writeState(BinaryWriter &writer) const
+{
+    writer.write(gameId);
+    writer.write(date);
+    writer.write(winnerElo);
+    writer.write(loserElo);
+    writer.write(eloDifference);
+    writer.write(duration);
+}
+
+/*!
+ */
+void Upset::readState(BinaryReader &reader)
+{
+    reader.read(gameId);
+    reader.read(date);
+    reader.read(winnerElo);
+    reader.read(loserElo);
+    reader.read(eloDifference);
+    reader.read(duration);
+}
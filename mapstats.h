@@ -1,15 +1,23 @@
  
 #pragma once
 
+#include <array>
 #include <chrono>
-#include <functional>
 #include <map>
 #include <set>
+#include <span>
 
 #include "rating.h"
 #include "faction.h"
 #include "game.h"
 #include "probabilities.h"
+#include "topk.h"
+
+// Forward declarations:
+class BinaryReader;
+class BinaryWriter;
+class GameStore;
+class Players;
 
 struct MapPlayed
 {
@@ -17,48 +25,33 @@ struct MapPlayed
     uint32_t count = 0;
     std::set<uint32_t> differentPlayers;
     bool operator<(const MapPlayed &other) const { return (count != other.count) ? count > other.count : mapName > other.mapName; }
+
+    void writeState(BinaryWriter &writer) const;
+    void readState(BinaryReader &reader);
 };
 
+//! Upset or long game. Players, factions and map are taken from the game. Ratings are kept,
+//! because games from before a checkpoint don't have them.
 struct Upset
 {
+    uint32_t gameId = 0;
     std::chrono::year_month_day date;
-    std::vector<uint32_t> winners;
-    std::vector<uint32_t> losers;
-    std::string map;
-    std::vector<factions::Faction> winnerFactions;
-    std::vector<factions::Faction> loserFactions;
-    std::vector<int> winnerElo;
-    std::vector<int> loserElo;
-    double eloDifference;
+    std::array<int, 2> winnerElo = { 0, 0 };
+    std::array<int, 2> loserElo = { 0, 0 };
+    double eloDifference = 0.0;
     uint32_t duration = 0;
 
     // Need the biggest difference on top.
     bool operator<(const Upset &other) const { return eloDifference > other.eloDifference; }
 
-    factions::Faction winnerFaction() const { return faction(winnerFactions); }
-    factions::Faction loserFaction() const { return faction(loserFactions); }
+    void writeState(BinaryWriter &writer) const;
+    void readState(BinaryReader &reader);
+};
 
-private:
-    factions::Faction faction(const std::vector<factions::Faction> &factions) const
-    {
-        if (std::all_of(factions.begin(), factions.end(),
-            [&](factions::Faction faction){ return faction == factions::Soviet; }))
-        {
-            return factions::Soviet;
-        }
-        else if (std::all_of(factions.begin(), factions.end(),
-            [&](factions::Faction faction){ return faction == factions::Allied; }))
-        {
-            return factions::Allied;
-        }
-        else if (std::all_of(factions.begin(), factions.end(),
-            [&](factions::Faction faction){ return faction == factions::Yuri; }))
-        {
-            return factions::Yuri;
-        }
-
-        return factions::Combined;
-    }
+//! Longest games on top.
+struct LongerGame
+{
+    bool operator()(const Upset &a, const Upset &b) const { return a.duration > b.duration; }
 };
 
 struct Team
@@ -91,11 +84,11 @@ public:
     //! Add a game to the stats.
     void processGame(const Game &game, const Players &players);
 
-    //! Export alltime, yearly and monthly upsets.
-    void exportUpsets(const std::filesystem::path &directory, const Players &players);
+    //! Export alltime, yearly and monthly upsets. Takes players and factions from the games.
+    void exportUpsets(const std::filesystem::path &directory, const Players &players, const GameStore &games);
 
-    //! Export the longest games.
-    void exportLongestGames(const std::filesystem::path &directory, const Players &player);
+    //! Export the longest games. Takes players and factions from the games.
+    void exportLongestGames(const std::filesystem::path &directory, const Players &player, const GameStore &games);
 
     //! Export the maps played for each month.
     void exportMapsPlayed(const std::filesystem::path &directory);
@@ -103,9 +96,20 @@ public:
     //! Export best teams for Blitz2v2.
     void exportBestTeams(const std::filesystem::path &directory, const Players &players);
 
+    //! Write the statistics collected so far to a checkpoint.
+    void writeState(BinaryWriter &writer) const;
+
+    //! Read the statistics from a checkpoint. Upsets of the last 12 month and of the last 30 days
+    //! are relative to the current date. Upsets, which are too old by now, are removed. Upsets,
+    //! which had been pushed out of these lists by those, can't be recovered.
+    void readState(BinaryReader &reader);
+
 private:
+    //! Name of the map of the game as used in the statistics.
+    std::string mapName(const Game &game) const;
+
     //! Export the given list of upsets.
-    void exportUpsets(const std::filesystem::path &directory, const std::multiset<Upset> &upsets, const std::string &filename, const std::string &description, const Players &players) const;
+    void exportUpsets(const std::filesystem::path &directory, std::span<const Upset> upsets, const std::string &filename, const std::string &description, const Players &players, const GameStore &games) const;
 
     //! Game mode used.
     gamemodes::GameMode _gameMode;
@@ -116,7 +120,7 @@ private:
     //! Overall map statistics each map.
     std::map<std::string, Probabilities> _mapStats[factions::UnknownSetup];
 
-    //! Teams statistics for blitz-2v2.
+    //! Teams statistics for blitz-2v2. Keep history to get the results of a few days ago.
     std::map<uint64_t, Probabilities> _teamStats;
     std::map<uint64_t, std::vector<std::pair<double, double>>> _lastTeamELOs;
 
@@ -135,19 +139,22 @@ private:
     std::map<std::string, std::pair<uint32_t, uint32_t>> _averageDuration;
 
     //! Upsets per month.
-    std::map<std::chrono::year_month_day, std::multiset<Upset>> _upsetsMonthly;
+    std::map<std::chrono::year_month_day, TopK<Upset, 20>> _upsetsMonthly;
 
     //! Upsets per month.
-    std::multiset<Upset> _upsetsLast12Month;
+    TopK<Upset, 50> _upsetsLast12Month;
 
     //! Upsets last 30 days.
-    std::multiset<Upset> _upsetsLast30Days;
+    TopK<Upset, 50> _upsetsLast30Days;
 
     //! Upsets per year.
-    std::multiset<Upset> _upsetsAllTime;
+    TopK<Upset, 100> _upsetsAllTime;
 
     //! Longest ranked match games.
-    std::multiset<Upset, std::function<bool (const Upset&, const Upset&)>> _longestGames;
+    TopK<Upset, 25, LongerGame> _longestGames;
+
+    //! Maps, which are ignored. Only used to log each of them once.
+    std::set<std::string> _ignoredMaps;
 
 }; // class MapStats
 
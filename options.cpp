@@ -5,6 +5,7 @@
 
 #include "logging.h"
 #include "options.h"
+#include "stringtools.h"
 
 /*!
  */
@@ -26,6 +27,9 @@ Options::Options(int argc, char* argv[])
          cxxopts::value<std::string>()->default_value("verbose"))
         ("m,gamemode", "Set the game mode. Every available ladder abbreviation is valid.",
          cxxopts::value<std::string>())
+        ("gamemodes", "Process several game modes at once, separated by commas. Games and users are loaded one "
+                      "ladder after another, ratings are computed in parallel.",
+         cxxopts::value<std::string>())
         ("o,output-dir", "Output directory for generated JSON files.",
          cxxopts::value<std::string>())
         ("H,host", "Host name for sql connection. Overrides environment variable MYSQL_HOST. If both not set, localhost is used.",
@@ -37,7 +41,37 @@ Options::Options(int argc, char* argv[])
         ("u,user", "User name for sql connection. Overrides environment variable MYSQL_USER.",
          cxxopts::value<std::string>())
         ("t,tournament-games", "Add tournament games from this file.",
-         cxxopts::value<std::string>());
+         cxxopts::value<std::string>())
+        ("resume-from", "Resume from a checkpoint file written by --save-checkpoint. Falls back to a full "
+                        "computation if the checkpoint does not fit.",
+         cxxopts::value<std::string>())
+        ("save-checkpoint", "Save the rating state after the last processed day to this file.",
+         cxxopts::value<std::string>())
+        ("games-cache", "Keep all fetched games in this file and only fetch new or modified games from the database. "
+                        "Games are only fetched again if games.updated_at changes. Games deleted from the database and "
+                        "changes to the reports alone are not noticed. Delete the file to fetch all games again.",
+         cxxopts::value<std::string>())
+        ("offline", "Don't connect to the database. Games, duplicates and users are taken from the file given by "
+                    "--games-cache. Ratings are not written.")
+        ("jsonl-source", "Take games and users from JSONL files in this directory instead of the database. "
+                         "Ratings are written to the same directory.",
+         cxxopts::value<std::string>())
+        ("volatility-solver", "Root finding for the new volatility (illinois, brent). Brent is bounded and "
+                              "usually needs fewer iterations, but results differ slightly.",
+         cxxopts::value<std::string>()->default_value("illinois"))
+        ("initial-rating-search", "Search for the initial rating of new players (grid, root). Root finding needs "
+                                  "far fewer trials, but results differ slightly.",
+         cxxopts::value<std::string>()->default_value("grid"))
+        ("threads", "Number of threads to update, apply and decay the ratings of all players at the end of each day. "
+                    "Shared by all ladders. Results are the same for any number.",
+         cxxopts::value<uint32_t>()->default_value("1"))
+        ("sweep", "Replay all games for each combination of engine parameters in this JSON file and write "
+                  "log-loss and Brier score of each set to <ladder>_sweep.json. Nothing else is exported.",
+         cxxopts::value<std::string>())
+        ("lazy-catch-up", "Skip players at the end of each day, who are inactive and whose deviation no longer grows. "
+                          "They catch up when they play again. Results are the same.")
+        ("prediction-report", "Score the predicted result of each game and write log-loss, Brier score and calibration by "
+                              "month, faction setup and deviation to <ladder>_predictions.json.");
 
 
     auto result = options.parse(argc, argv);
@@ -85,9 +119,103 @@ Options::Options(int argc, char* argv[])
         }
     }
 
+    if (result.count("sweep"))
+    {
+        sweepGrid = result["sweep"].as<std::string>();
+        if (!std::filesystem::exists(sweepGrid))
+        {
+            std::cerr << "The file '" << sweepGrid << "' does not exist." << std::endl;
+            setQuitWithErrorCode(1);
+            return;
+        }
+    }
+
+    if (result.count("resume-from"))
+    {
+        resumeFrom = result["resume-from"].as<std::string>();
+    }
+
+    if (result.count("save-checkpoint"))
+    {
+        saveCheckpoint = result["save-checkpoint"].as<std::string>();
+    }
+
+    if (result.count("games-cache"))
+    {
+        gamesCache = result["games-cache"].as<std::string>();
+    }
+
+    if (result.count("jsonl-source"))
+    {
+        jsonlSource = result["jsonl-source"].as<std::string>();
+        if (!std::filesystem::is_directory(jsonlSource))
+        {
+            std::cerr << "The directory '" << jsonlSource << "' does not exist." << std::endl;
+            setQuitWithErrorCode(1);
+            return;
+        }
+    }
+
+    std::optional<glicko::VolatilitySolver> solver = glicko::toVolatilitySolver(result["volatility-solver"].as<std::string>());
+    if (!solver.has_value())
+    {
+        std::cerr << "Unknown volatility solver. Use illinois or brent." << std::endl;
+        setQuitWithErrorCode(1);
+        return;
+    }
+    volatilitySolver = *solver;
+
+    std::optional<glicko::InitialRatingSearch> search = glicko::toInitialRatingSearch(result["initial-rating-search"].as<std::string>());
+    if (!search.has_value())
+    {
+        std::cerr << "Unknown initial rating search. Use grid or root." << std::endl;
+        setQuitWithErrorCode(1);
+        return;
+    }
+    initialRatingSearch = *search;
+    threads = std::max(result["threads"].as<uint32_t>(), 1u);
+    lazyCatchUp = result["lazy-catch-up"].as<bool>();
+    predictionReport = result["prediction-report"].as<bool>();
+
     gameMode = gamemodes::Unknown;
 
-    if (!result.count("gamemode"))
+    if (result.count("gamemode") && result.count("gamemodes"))
+    {
+        std::cerr << "Use either --gamemode or --gamemodes." << std::endl;
+        setQuitWithErrorCode(1);
+        return;
+    }
+    else if (result.count("gamemodes"))
+    {
+        std::istringstream stream(result["gamemodes"].as<std::string>());
+        std::string abbreviation;
+        while (std::getline(stream, abbreviation, ','))
+        {
+            abbreviation = stringtools::trimmed(abbreviation);
+            if (!abbreviation.empty() && std::find(ladderAbbreviations.begin(), ladderAbbreviations.end(), abbreviation) == ladderAbbreviations.end())
+            {
+                ladderAbbreviations.push_back(abbreviation);
+            }
+        }
+
+        if (ladderAbbreviations.empty())
+        {
+            std::cerr << "No game modes given with --gamemodes." << std::endl;
+            setQuitWithErrorCode(1);
+            return;
+        }
+
+        if (ladderAbbreviations.size() > 1 && !tournamentFile.empty())
+        {
+            std::cerr << "Tournament games can only be added when processing a single game mode." << std::endl;
+            setQuitWithErrorCode(1);
+            return;
+        }
+
+        ladderAbbreviation = ladderAbbreviations.front();
+        gameMode = gamemodes::toGameMode(ladderAbbreviation);
+    }
+    else if (!result.count("gamemode"))
     {
         std::cout << "Missing game mode. Use option --gamemode to specify. Fully supported game "
                      "modes are blitz, ra2, yr, and blitz-2v2, but others might work, too." << std::endl;
@@ -102,6 +230,7 @@ Options::Options(int argc, char* argv[])
                       << " elo for ra2-new-maps will work." << std::endl;
         }
         gameMode = gamemodes::toGameMode(ladderAbbreviation);
+        ladderAbbreviations.push_back(ladderAbbreviation);
     }
 
     if (result.count("port") > 0)
@@ -128,6 +257,7 @@ Options::Options(int argc, char* argv[])
     exportFullStats = result["statistics"].as<bool>();
     cncnetDuplicates = result["cncnet-duplicates"].as<bool>();
     noDuplicates = result["no-duplicates"].as<bool>();
+    offline = result["offline"].as<bool>();
 
     timeShiftInHours = result["timeshift"].as<int>();
 
@@ -159,6 +289,26 @@ Options::Options(int argc, char* argv[])
         endDate = std::chrono::floor<std::chrono::days>(std::chrono::system_clock::now());
     }
 
+    if (offline)
+    {
+        for (const std::string &abbreviation : ladderAbbreviations)
+        {
+            std::filesystem::path file = forLadder(abbreviation).gamesCache;
+            if (file.empty() || !std::filesystem::exists(file))
+            {
+                std::cerr << "Running offline requires an existing games cache. Use --games-cache." << std::endl;
+                setQuitWithErrorCode(1);
+                return;
+            }
+        }
+        return;
+    }
+
+    if (!jsonlSource.empty())
+    {
+        return;
+    }
+
     if (mySqlUser().empty())
     {
         std::cerr << "No MySql user. Either use --user or set MYSQL_USER." << std::endl;
@@ -182,6 +332,30 @@ void Options::setQuitWithErrorCode(int returnValue)
     _quit = true;
 }
 
+/*!
+ */
+Options Options::forLadder(const std::string &abbreviation) const
+{
+    Options options = *this;
+    options.ladderAbbreviation = abbreviation;
+    options.gameMode = gamemodes::toGameMode(abbreviation);
+    options.ladderAbbreviations = { abbreviation };
+
+    // Each ladder needs files of its own.
+    if (ladderAbbreviations.size() > 1)
+    {
+        for (std::filesystem::path *file : { &options.resumeFrom, &options.saveCheckpoint, &options.gamesCache })
+        {
+            if (!file->empty())
+            {
+                *file = file->parent_path() / (file->stem().string() + "-" + abbreviation + file->extension().string());
+            }
+        }
+    }
+
+    return options;
+}
+
 /*!
  */
 bool Options::quit() const
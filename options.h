@@ -2,12 +2,20 @@
 #pragma once
 
 #include <filesystem>
+#include <string>
+#include <vector>
 
 #include "gamemode.h"
+#include "rating.h"
 
 struct Options
 {
     Options(int argc, char* argv[]);
+
+    //! Options for processing a single ladder out of several ones. Files for checkpoints and
+    //! caches get the ladder abbreviation appended to their names if there is more than one ladder.
+    Options forLadder(const std::string &abbreviation) const;
+
     bool quit() const;
     int returnValue() const;
 
@@ -30,15 +38,27 @@ public:
 public:
     gamemodes::GameMode gameMode;
     std::string ladderAbbreviation;
+    std::vector<std::string> ladderAbbreviations;
     std::filesystem::path outputDirectory;
     std::filesystem::path tournamentFile;
+    std::filesystem::path resumeFrom;
+    std::filesystem::path saveCheckpoint;
+    std::filesystem::path gamesCache;
+    std::filesystem::path jsonlSource;
+    std::filesystem::path sweepGrid;
     std::chrono::time_point<std::chrono::system_clock, std::chrono::days> endDate;
     int timeShiftInHours;
+    glicko::VolatilitySolver volatilitySolver = glicko::VolatilitySolver::Illinois;
+    glicko::InitialRatingSearch initialRatingSearch = glicko::InitialRatingSearch::Grid;
+    uint32_t threads = 1;
+    bool lazyCatchUp = false;
+    bool predictionReport = false;
     bool dryRun;
     bool exportFullStats;
     bool allGames;
     bool cncnetDuplicates;
     bool noDuplicates;
+    bool offline;
 
 private:
     std::string host;
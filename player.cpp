@@ -1,7 +1,11 @@
  
 #include <cmath>
 #include <set>
+#include <stdexcept>
 
+#include "binarystream.h"
+#include "decaytable.h"
+#include "engineparameters.h"
 #include "faction.h"
 #include "knownplayers.h"
 #include "logging.h"
@@ -41,7 +45,7 @@ Player::Player(uint32_t userId, uint32_t primaryUserId, const std::string &usern
     // Init ratings.
     for (size_t i = 0; i < _ratings.size(); i++)
     {
-        _ratings[i] = Rating(initialValues.first, initialValues.second, glicko::initialVolatility);
+        _ratings[i] = Rating(initialValues.first, initialValues.second, EngineParameters::current(gameMode).initialVolatility);
     }
 
     // Init peak ratings.
@@ -154,6 +158,13 @@ double Player::deviation(factions::Faction faction) const
     return _ratings[faction].deviation() * glicko::scaleFactor;
 }
 
+/*!
+ */
+double Player::yesterdaysDeviation(factions::Faction faction) const
+{
+    return _yesterdaysRatings[faction].deviation() * glicko::scaleFactor;
+}
+
 /*!
  */
 double Player::elo(factions::Faction faction) const
@@ -328,6 +339,22 @@ double Player::volatility(factions::Faction faction) const
     return _ratings[faction].volatility();
 }
 
+/*!
+ */
+void Player::setInitialVolatility(double volatility)
+{
+    if (gameCount() > 0)
+    {
+        Log::error() << "Setting the initial volatility of player " << _userId << ", who has played already.";
+    }
+
+    for (size_t i = 0; i < _ratings.size(); i++)
+    {
+        _ratings[i] = Rating(_ratings[i].rating(), _ratings[i].deviation(), volatility, true);
+        _yesterdaysRatings[i] = _ratings[i];
+    }
+}
+
 /*!
  */
 void Player::update()
@@ -376,15 +403,51 @@ void Player::update()
 
 /*!
  */
-void Player::decay(int days, gamemodes::GameMode gameMode)
+bool Player::isSettled(gamemodes::GameMode gameMode) const
 {
+    if (pendingGameCount() > 0 || isActive())
+    {
+        return false;
+    }
+
     for (size_t i = 0; i < _ratings.size(); i++)
     {
-        for (int j = 0; j < days; j++)
+        factions::Faction faction = factions::toFaction(i);
+
+        // The next apply() copies the ratings to yesterdays ratings.
+        if (_updated[i] || _ratings[i].rating() != _yesterdaysRatings[i].rating() || _ratings[i].deviation() != _yesterdaysRatings[i].deviation()
+            || _ratings[i].volatility() != _yesterdaysRatings[i].volatility() || _ratings[i].gameCount() != _yesterdaysRatings[i].gameCount())
         {
-            _ratings[i].decay(this->wasActive(), gamemodes::decayFactor(gameMode), gamemodes::maxDeviationAfterActive(gameMode));
+            return false;
+        }
+
+        // Same check as in apply().
+        if (deviation(faction) < gamemodes::deviationThresholdActive(gameMode, elo(faction)))
+        {
+            return false;
+        }
+
+        Rating decayed = _ratings[i];
+        decayed.decay(this->wasActive(), gamemodes::decayFactor(gameMode), gamemodes::maxDeviationAfterActive(gameMode));
+        if (decayed.deviation() != _ratings[i].deviation())
+        {
+            return false;
         }
     }
+
+    return true;
+}
+
+/*!
+ */
+void Player::decay(int days, gamemodes::GameMode gameMode)
+{
+    const DecayTable &table = DecayTable::forGameMode(gameMode);
+
+    for (size_t i = 0; i < _ratings.size(); i++)
+    {
+        _ratings[i].decay(this->wasActive(), days, table, gamemodes::maxDeviationAfterActive(gameMode));
+    }
 }
 
 /*!
@@ -466,6 +529,22 @@ void Player::apply(std::chrono::year_month_day date, bool decay, gamemodes::Game
 
     }
 
+    addToHistory(date);
+}
+
+/*!
+ */
+void Player::applySettled(std::chrono::year_month_day date)
+{
+    addToHistory(date);
+}
+
+/*!
+ */
+void Player::addToHistory(std::chrono::year_month_day date)
+{
+    RatingHistory::Values values;
+
     for (size_t i = 0; i < factions::count(); i++)
     {
         double result = -1.0;
@@ -480,35 +559,17 @@ void Player::apply(std::chrono::year_month_day date, bool decay, gamemodes::Game
             }
         }
 
-        auto y = static_cast<int>(date.year());
-        auto m = static_cast<unsigned>(static_cast<unsigned>(date.month()));
-        auto d = static_cast<unsigned>(static_cast<unsigned>(date.day()));
-        uint32_t intDate = static_cast<uint32_t>(y) * 10000 + m * 100 + d;
-
-        _eloByDate[intDate][i] = std::pair<double, double>(result, deviation);
+        values[i] = std::pair<double, double>(result, deviation);
     }
+
+    _history.add(std::chrono::sys_days{date}, values);
 }
 
 /*!
  */
 int Player::daysActive() const
 {
-    int result = 0;
-
-    for (auto it = _eloByDate.begin(); it != _eloByDate.end(); ++it)
-    {
-        const std::array<std::pair<double, double>, factions::count()> &eloByDate = it->second;
-        for (size_t i = 0; i < eloByDate.size(); i++)
-        {
-            if (eloByDate[i].first > 0.0)
-            {
-                result++;
-                break;
-            }
-        }
-    }
-
-    return result;
+    return _history.daysActive();
 }
 
 /*!
@@ -569,32 +630,9 @@ int Player::daysToInactivity(gamemodes::GameMode gameMode) const
  */
 int Player::daysInactive() const
 {
-    int result = 0;
-
-    for (auto it = _eloByDate.begin(); it != _eloByDate.end(); ++it)
-    {
-        const std::array<std::pair<double, double>, factions::count()> &eloByDate = it->second;
-        bool foundActivity = false;
-
-        // Now iterate over faction.
-        for (size_t i = 0; i < eloByDate.size() && !foundActivity; i++)
-        {
-            if (eloByDate[i].first > 0.0)
-            {
-                result = 0;
-                // Activity for a single faction set inactive days to 0.
-                foundActivity = true;
-            }
-        }
-
-        if (!foundActivity)
-        {
-            result++;
-        }
-
-    }
-    return result;
+    return _history.daysInactive();
 }
+
 /*!
  */
 void Player::processGame(const Game& game, int index, bool instantProcessing, const Players &players)
@@ -659,22 +697,23 @@ void Player::processGame(const Game& game, int index, bool instantProcessing, co
         opponent = game.userId(index ^ 1);
         opponentFaction = game.faction(index ^ 1);
 
-        if (!players.contains(opponent))
+        // Slots are only assigned to existing players.
+        if (game.playerSlot(index ^ 1) == Players::noSlot && !players.contains(opponent))
         {
             std::stringstream ss;
             ss << "Unable to find opponent " << opponent << " while processing game.";
             throw std::runtime_error(ss.str());
         }
 
-        std::array<double, 3> rating = players[opponent].rating(opponentFaction).toArray();
+        std::array<double, 3> rating = players.participant(game, index ^ 1).rating(opponentFaction).toArray();
 
         //instantProcessing = true;
         if (instantProcessing)
         {
-            _ratings[faction].update({ rating }, { result }, Rating::CalculationType::Normal);
+            _ratings[faction].update(rating, result, Rating::CalculationType::Normal);
             _updated[faction] = true;
 
-            _ratings[factions::Combined].update({ rating }, { result }, Rating::CalculationType::Normal);
+            _ratings[factions::Combined].update(rating, result, Rating::CalculationType::Normal);
             _updated[factions::Combined] = true;
         }
         else
@@ -689,13 +728,14 @@ void Player::processGame(const Game& game, int index, bool instantProcessing, co
     else
     {
         // ELO for 2v2 games.
-        double myElo = players[game.userId(playerIndex)].rating(faction).elo();
+        double myElo = players.participant(game, playerIndex).rating(faction).elo();
         uint32_t mateIndex = game.mateIndex(playerIndex);
-        double mateElo = players[game.userId(mateIndex)].rating(game.faction(mateIndex)).elo();
-        double mateDeviation = players[game.userId(mateIndex)].rating(game.faction(mateIndex)).eloDeviation();
+        double mateElo = players.participant(game, mateIndex).rating(game.faction(mateIndex)).elo();
+        double mateDeviation = players.participant(game, mateIndex).rating(game.faction(mateIndex)).eloDeviation();
 
-        double myStrength = std::pow(myElo, glicko::exponentFactor2v2);
-        double mateStrength = std::pow(mateElo, glicko::exponentFactor2v2);
+        double exponentFactor2v2 = EngineParameters::current().exponentFactor2v2;
+        double myStrength = std::pow(myElo, exponentFactor2v2);
+        double mateStrength = std::pow(mateElo, exponentFactor2v2);
 
         double myShare = myStrength / (myStrength + mateStrength);
 
@@ -705,23 +745,23 @@ void Player::processGame(const Game& game, int index, bool instantProcessing, co
         }
 
         std::pair<uint32_t, uint32_t> opponents = game.opponentsIndices(playerIndex);
-        double opponent1Elo = players[game.userId(opponents.first)].rating(game.faction(opponents.first)).elo();
-        double opponent2Elo = players[game.userId(opponents.second)].rating(game.faction(opponents.second)).elo();
-        double opponent1Deviation = players[game.userId(opponents.first)].rating(game.faction(opponents.first)).eloDeviation();
-        double opponent2Deviation = players[game.userId(opponents.second)].rating(game.faction(opponents.second)).eloDeviation();
+        double opponent1Elo = players.participant(game, opponents.first).rating(game.faction(opponents.first)).elo();
+        double opponent2Elo = players.participant(game, opponents.second).rating(game.faction(opponents.second)).elo();
+        double opponent1Deviation = players.participant(game, opponents.first).rating(game.faction(opponents.first)).eloDeviation();
+        double opponent2Deviation = players.participant(game, opponents.second).rating(game.faction(opponents.second)).eloDeviation();
 
         double finalElo = (opponent1Elo + opponent2Elo) * myShare;
         double finalDeviation = (opponent1Deviation + opponent2Deviation + mateDeviation) / 3.0;
 
         std::array<double, 3> opponent{((finalElo - glicko::initialRating) / glicko::scaleFactor ),
                                        (finalDeviation / glicko::scaleFactor),
-                                       glicko::initialVolatility};
+                                       EngineParameters::current().initialVolatility};
 
         if (instantProcessing)
         {
-            _ratings[faction].update({ opponent }, { result });
+            _ratings[faction].update(opponent, result);
             _updated[faction] = true;
-            _ratings[factions::Combined].update({ opponent }, { result });
+            _ratings[factions::Combined].update(opponent, result);
             _updated[factions::Combined] = true;
         }
         else
@@ -746,44 +786,31 @@ void Player::processGame(const Game& game, int index, bool instantProcessing, co
     }
 
     // Does this game count for highest rated victories? 2v2 games are not taken into account.
-    if (game.playerCount() == 2 && game.winnerIndex() == index && game.deviation(index) < 200.0 && players[opponent].wasActive() && game.isUnderdogWin())
+    if (game.playerCount() == 2 && game.winnerIndex() == index && game.deviation(index) < 200.0 && players.participant(game, index ^ 1).wasActive() && game.isUnderdogWin())
     {
         double diff = (game.rating(index ^ 1) - game.deviation(index ^ 1)) - (game.rating(index) + game.deviation(index));
-        _hightestRatedVictories.insert({ game.id(), diff });
-        if (_hightestRatedVictories.size() > 20)
-        {
-            _hightestRatedVictories.erase(_hightestRatedVictories.begin());
-        }
+        _hightestRatedVictories.add({ game.id(), diff });
     }
 
 
     // Does this game count for lowest rated defeats? 2v2 games are not taken into account.
-    if (game.playerCount() == 2 && game.winnerIndex() == (index ^ 1) && game.deviation(index) < 200.0 && players[opponent].wasActive() && game.isUnderdogWin())
+    if (game.playerCount() == 2 && game.winnerIndex() == (index ^ 1) && game.deviation(index) < 200.0 && players.participant(game, index ^ 1).wasActive() && game.isUnderdogWin())
     {
         double diff = (game.rating(index) - game.deviation(index)) - (game.rating(index ^ 1) + game.deviation(index ^ 1));
-        _lowestRatedDefeats.insert({ game.id(), diff });
-        if (_lowestRatedDefeats.size() > 20)
-        {
-            _lowestRatedDefeats.erase(_lowestRatedDefeats.begin());
-        }
+        _lowestRatedDefeats.add({ game.id(), diff });
     }
 
     if (!game.isDraw() && game.playerCount() == 2)
     {
-        // Update player vs player stats and maps stats. Only applies to games
-        // with 2 players.
-        Probabilities &probs = _vsPlayer[game.userId(index ^ 1)];
-        Rating myRating(game.rating(index), game.deviation(index), glicko::initialVolatility);
-        Rating otherRating(game.rating(index ^ 1), game.deviation(index ^ 1), glicko::initialVolatility);
-        double expectedWinningPercentage = myRating.e_star(otherRating.toArray(), 0.0);
-        probs.addGame(expectedWinningPercentage, game.sysDate(), game.winnerIndex() == index);
-
-        // Map statistics (currently only for blitz).
+        // Update maps stats (currently only for blitz). Only applies to games with 2 players.
+        // Player vs player stats are kept by Players for the whole ladder.
         int mapIndex = blitzmap::toIndex(game.mapName());
         if (mapIndex >= 0)
         {
+            Rating myRating(game.rating(index), game.deviation(index), glicko::initialVolatility);
+            Rating otherRating(game.rating(index ^ 1), game.deviation(index ^ 1), glicko::initialVolatility);
             factions::Setup setup = factions::fromFactions(game.faction(index), game.faction(index ^ 1));
-            Probabilities &probs = _mapStats[setup][mapIndex];
+            Probabilities &probs = _mapStats[{ setup, mapIndex }];
             double expectedWinRate = myRating.e_star(otherRating.toArray(), 0.0);
             probs.addGame(expectedWinRate, game.sysDate(), game.winnerIndex() == index);
         }
@@ -906,14 +933,14 @@ std::chrono::year_month_day Player::lastGame() const
 
 /*!
  */
-const std::set<HighestRatedVictories>& Player::highestRatedVictories() const
+const TopK<HighestRatedVictories, 20>& Player::highestRatedVictories() const
 {
     return _hightestRatedVictories;
 }
 
 /*!
  */
-const std::set<LowestRatedDefeats>& Player::lowestRatedDefeats() const
+const TopK<LowestRatedDefeats, 20>& Player::lowestRatedDefeats() const
 {
     return _lowestRatedDefeats;
 }
@@ -922,41 +949,30 @@ const std::set<LowestRatedDefeats>& Player::lowestRatedDefeats() const
  */
 void Player::finalize()
 {
-    for (auto it = _vsPlayer.begin(); it != _vsPlayer.end(); ++it)
+    for (auto it = _mapStats.begin(); it != _mapStats.end(); ++it)
     {
-        if (!it->second.isFinalized())
-        {
-            it->second.finalize();
-        }
-    }
-
-    for (size_t i = 0; i < factions::UnknownSetup; i++)
-    {
-        for (int j = 0; j < blitzmap::count(); j++)
-        {
-            Probabilities &probs = _mapStats[i][j];
-            probs.finalize();
-        }
+        it->second.finalize();
     }
 }
 
-/*!
- */
-const std::map<uint32_t, Probabilities>& Player::vsOtherPlayers() const
-{
-    return _vsPlayer;
-}
-
 /*!
  */
 const Probabilities& Player::mapStats(factions::Setup setup, int mapIndex) const
 {
-    if (static_cast<size_t>(setup) >= _mapStats.size() || mapIndex < 0 || static_cast<size_t>(mapIndex) >= _mapStats[setup].size())
+    if (setup >= factions::UnknownSetup || mapIndex < 0 || static_cast<size_t>(mapIndex) >= blitzmap::count())
     {
         throw std::out_of_range("Indices for map stats are out of range.");
     }
 
-    return _mapStats[setup][mapIndex];
+    // Maps never played have no entry.
+    static const Probabilities noGames = []() {
+        Probabilities probabilities;
+        probabilities.finalize();
+        return probabilities;
+    }();
+
+    auto it = _mapStats.find({ setup, mapIndex });
+    return it != _mapStats.end() ? it->second : noGames;
 }
 
 /*!
@@ -965,15 +981,16 @@ std::map<uint32_t, std::pair<double, double>> Player::historicalElo(factions::Fa
 {
     std::map<uint32_t, std::pair<double, double>> result;
 
-    for (auto it = _eloByDate.begin(); it != _eloByDate.end(); ++it)
-    {
-        uint32_t date = it->first;
-        const std::array<std::pair<double, double>, factions::count()> &ratingAndDeviation = it->second;
-        if (ratingAndDeviation[faction].first > 0.0)
+    _history.forEachDay(faction, [&result](std::chrono::sys_days day, double rating, double deviation) {
+        if (rating > 0.0)
         {
-            result[date] = ratingAndDeviation[faction];
+            std::chrono::year_month_day date{day};
+            auto y = static_cast<int>(date.year());
+            auto m = static_cast<unsigned>(date.month());
+            auto d = static_cast<unsigned>(date.day());
+            result[static_cast<uint32_t>(y) * 10000 + m * 100 + d] = std::pair<double, double>(rating, deviation);
         }
-    }
+    });
 
     return result;
 }
@@ -1059,3 +1076,111 @@ int Player::daysSinceLastTimeGoingActive(factions::Faction faction) const
     return diff.count();
 }
 
+/*!
+ */
+void Player::writeState(BinaryWriter &writer) const
+{
+    if (pendingGameCount() > 0)
+    {
+        throw std::runtime_error("Trying to write a player with pending games.");
+    }
+
+    writer.write(_wins);
+    writer.write(_losses);
+    writer.write(_draws);
+    writer.write(_initialRating);
+    writer.write(_gamesToBecomeActive);
+    writer.write(_ratings);
+    writer.write(_yesterdaysRatings);
+    writer.write(_ratingCombined);
+    writer.write(_gameCount);
+    writer.write(_peakRatings);
+    writer.write(_lastGame);
+    writer.write(_firstGame);
+    writer.write(_updated);
+    writer.write(_statusList);
+    writer.write(_factionStatusList);
+    writer.write(_history);
+    writer.write(_hightestRatedVictories);
+    writer.write(_lowestRatedDefeats);
+    writer.write(_mapStats);
+    writer.write(_gamesAtActivation);
+}
+
+/*!
+ */
+void Player::readState(BinaryReader &reader)
+{
+    reader.read(_wins);
+    reader.read(_losses);
+    reader.read(_draws);
+    reader.read(_initialRating);
+    reader.read(_gamesToBecomeActive);
+    reader.read(_ratings);
+    reader.read(_yesterdaysRatings);
+    reader.read(_ratingCombined);
+    reader.read(_gameCount);
+    reader.read(_peakRatings);
+    reader.read(_lastGame);
+    reader.read(_firstGame);
+    reader.read(_updated);
+    reader.read(_statusList);
+    reader.read(_factionStatusList);
+    reader.read(_history);
+    reader.read(_hightestRatedVictories);
+    reader.read(_lowestRatedDefeats);
+    reader.read(_mapStats);
+    reader.read(_gamesAtActivation);
+}
+
+/*!
+ */
+void PeakRating::writeState(BinaryWriter &writer) const
+{
+    writer.write(date);
+    writer.write(adjustedElo);
+    writer.write(deviation);
+    writer.write(faction);
+}
+
+/*!
+ */
+void PeakRating::readState(BinaryReader &reader)
+{
+    reader.read(date);
+    reader.read(adjustedElo);
+    reader.read(deviation);
+    reader.read(faction);
+}
+
+/*!
+ */
+void HighestRatedVictories::writeState(BinaryWriter &writer) const
+{
+    writer.write(gameId);
+    writer.write(ratingDifference);
+}
+
+/*!
+ */
+void HighestRatedVictories::readState(BinaryReader &reader)
+{
+    reader.read(gameId);
+    reader.read(ratingDifference);
+}
+
+/*!
+ */
+void LowestRatedDefeats::writeState(BinaryWriter &writer) const
+{
+    writer.write(gameId);
+    writer.write(ratingDifference);
+}
+
+/*!
+ */
+void LowestRatedDefeats::readState(BinaryReader &reader)
+{
+    reader.read(gameId);
+    reader.read(ratingDifference);
+}
@@ -12,6 +12,12 @@
 #include "gamemode.h"
 #include "probabilities.h"
 #include "rating.h"
+#include "ratinghistory.h"
+#include "topk.h"
+
+// Forward declarations:
+class BinaryReader;
+class BinaryWriter;
 
 struct PeakRating
 {
@@ -19,22 +25,27 @@ struct PeakRating
     double adjustedElo = -1.0;
     double deviation;
     factions::Faction faction;
+
+    void writeState(BinaryWriter &writer) const;
+    void readState(BinaryReader &reader);
 };
 
 struct HighestRatedVictories
 {
     uint32_t gameId;
     double ratingDifference;
+    void writeState(BinaryWriter &writer) const;
+    void readState(BinaryReader &reader);
     bool operator<(const HighestRatedVictories &hrd) const
     {
-        // Want highest difference at the top.
+        // Want highest difference at the top. Later games first on equal differences.
         if (ratingDifference != hrd.ratingDifference)
         {
-            return ratingDifference < hrd.ratingDifference;
+            return ratingDifference > hrd.ratingDifference;
         }
         else
         {
-            return gameId < hrd.gameId;
+            return gameId > hrd.gameId;
         }
     }
 };
@@ -43,16 +54,18 @@ struct LowestRatedDefeats
 {
     uint32_t gameId;
     double ratingDifference;
+    void writeState(BinaryWriter &writer) const;
+    void readState(BinaryReader &reader);
     bool operator<(const LowestRatedDefeats &hrd) const
     {
-        // Want highest difference at the top.
+        // Want highest difference at the top. Later games first on equal differences.
         if (ratingDifference != hrd.ratingDifference)
         {
-            return ratingDifference < hrd.ratingDifference;
+            return ratingDifference > hrd.ratingDifference;
         }
         else
         {
-            return gameId < hrd.gameId;
+            return gameId > hrd.gameId;
         }
     }
 };
@@ -138,18 +151,32 @@ public:
     //! Get the rating deviation of the player.
     double deviation(factions::Faction faction) const;
 
+    //! Get yesterdays rating deviation of the player.
+    double yesterdaysDeviation(factions::Faction faction) const;
+
     //! Get the glicko-2 volatility of the player.
     double volatility(factions::Faction faction) const;
 
+    //! Set the volatility of all ratings. Only meant for players, who haven't played yet.
+    void setInitialVolatility(double volatility);
+
     //! Process the given game.
     void processGame(const Game& game, int index, bool instantUpdate, const Players &players);
 
     //! Apply all pending games.
     void apply(std::chrono::year_month_day date, bool decay, gamemodes::GameMode gameMode);
 
+    //! Same as apply() for a settled player, see isSettled(). Only adds the day to the history.
+    void applySettled(std::chrono::year_month_day date);
+
     //! Update a players rating.
     void update();
 
+    //! Check if rating periods without games would only add the player as inactive to the
+    //! history. That is the case once the player is inactive for all factions and the
+    //! deviations no longer grow. Nothing changes until the player plays again.
+    bool isSettled(gamemodes::GameMode gameMode) const;
+
     //! Check how many days can pass until this players becomes inactive.
     //! Returns 0 if the player is already inactive.
     int daysToInactivity(gamemodes::GameMode gameMode) const;
@@ -226,13 +253,10 @@ public:
     void finalize();
 
     //! Get the highest rated victories of this player.
-    const std::set<HighestRatedVictories>& highestRatedVictories() const;
+    const TopK<HighestRatedVictories, 20>& highestRatedVictories() const;
 
     //! Get the lowest rated defeats of this player.
-    const std::set<LowestRatedDefeats>& lowestRatedDefeats() const;
-
-    //! Get the stats against other players.
-    const std::map<uint32_t, Probabilities>& vsOtherPlayers() const;
+    const TopK<LowestRatedDefeats, 20>& lowestRatedDefeats() const;
 
     //! Get the probabilities for a specific map.
     const Probabilities& mapStats(factions::Setup setup, int mapIndex) const;
@@ -250,7 +274,18 @@ public:
     //! given faction.
     int daysSinceLastTimeGoingActive(factions::Faction faction) const;
 
+    //! Write everything computed from the games processed so far to a checkpoint. Names, alias
+    //! and account are not part of it, they are loaded from the database on each run. Must not
+    //! be called with games pending.
+    void writeState(BinaryWriter &writer) const;
+
+    //! Read the state written by writeState().
+    void readState(BinaryReader &reader);
+
 private:
+    //! Add the current ratings of active factions to the history.
+    void addToHistory(std::chrono::year_month_day date);
+
     //! User id. 0 if invalid player.
     uint32_t _userId = 0;
 
@@ -258,13 +293,13 @@ private:
     uint32_t _primaryUserId = 0;
 
     //! Number of wins.
-    uint32_t _wins;
+    uint32_t _wins = 0;
 
     //! Number of losses.
-    uint32_t _losses;
+    uint32_t _losses = 0;
 
     //! Number of draws.
-    uint32_t _draws;
+    uint32_t _draws = 0;
 
     //! Account name.
     std::string _account;
@@ -329,28 +364,24 @@ private:
     //! the same as above, but for each faction.
     std::array<std::vector<std::chrono::year_month_day>, factions::count()> _factionStatusList;
 
-    //! ELO by date for each faction. First value of the pair is the elo, second
-    //! the deviation. Key using std::chrono::year_month_day is not working properly.
-    //! That's why its converted to uint32_t.
-    std::map<uint32_t, std::array<std::pair<double, double>, factions::count()>> _eloByDate;
+    //! ELO and deviation by date for each faction.
+    RatingHistory _history;
 
     //! List of highest rated victories. Stripped down to 20 elements max.
-    std::set<HighestRatedVictories> _hightestRatedVictories;
+    TopK<HighestRatedVictories, 20> _hightestRatedVictories;
 
     //! List of lowest rated victories. Stripped down to 20 elements max.
-    std::set<LowestRatedDefeats> _lowestRatedDefeats;
-
-    //! Statistics against each other player. Contains the expected and the actual result.
-    std::map<uint32_t, Probabilities> _vsPlayer;
+    TopK<LowestRatedDefeats, 20> _lowestRatedDefeats;
 
-    //! Map statistics for each faction setup.
-    std::array<std::array<Probabilities, blitzmap::count()>, factions::UnknownSetup> _mapStats;
+    //! Map statistics by faction setup and map index. Only contains maps played, so ladders
+    //! without map statistics don't allocate anything.
+    std::map<std::pair<factions::Setup, int>, Probabilities> _mapStats;
 
     //! List of player names for each ladder.
     std::map<std::string, std::set<std::string>> _names;
 
     //! Number of games played at the last point of going active.
-    std::array<uint32_t, factions::count()> _gamesAtActivation;
+    std::array<uint32_t, factions::count()> _gamesAtActivation = { 0 };
 
 }; // class Player
 
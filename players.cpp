@@ -1,4 +1,5 @@
  
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -6,11 +7,15 @@
 
 #include "nlohmann/json.hpp"
 
+#include "binarystream.h"
 #include "cplusplus.h"
+#include "engineparameters.h"
+#include "gamestore.h"
 #include "knownplayers.h"
 #include "logging.h"
 #include "players.h"
 #include "stringtools.h"
+#include "threadpool.h"
 
 /*!
  */
@@ -32,7 +37,7 @@ size_t Players::count() const
  */
 bool Players::contains(uint32_t userId) const
 {
-    return _players.contains(userId);
+    return _slots.contains(userId);
 }
 
 /*!
@@ -49,14 +54,22 @@ std::vector<uint32_t> Players::userIds() const
     std::vector<uint32_t> userIds;
     userIds.reserve(_players.size());
 
-    for (const auto& [userId, player] : _players)
+    for (const Player &player : _players)
     {
-        userIds.push_back(userId);
+        userIds.push_back(player.userId());
     }
 
     return userIds;
 }
 
+/*!
+ */
+uint32_t Players::slot(uint32_t userId) const
+{
+    std::unordered_map<uint32_t, uint32_t>::const_iterator it = _slots.find(userId);
+    return (it != _slots.end()) ? it->second : noSlot;
+}
+
 /*!
  */
 Player &Players::operator [](uint32_t index)
@@ -66,14 +79,16 @@ Player &Players::operator [](uint32_t index)
         Log::error() << "Player with user id 0 is not supposed to exist.";
     }
 
-    auto it = _players.find(index);
-    if (it == _players.end())
+    auto it = _slots.find(index);
+    if (it == _slots.end())
     {
         Log::fatal() << "No player for index " << index << ".";
         throw std::runtime_error("Accessing non-existing player.");
     }
 
-    return it->second;
+    wake(it->second);
+
+    return _players[it->second];
 }
 
 /*!
@@ -85,26 +100,64 @@ const Player& Players::operator[](uint32_t index) const
         Log::error() << "Player with user id 0 is not supposed to exist.";
     }
 
-    auto it = _players.find(index);
-    if (it == _players.end())
+    auto it = _slots.find(index);
+    if (it == _slots.end())
     {
         Log::fatal() << "No player for index " << index << ". An exception will be thrown.";
         throw std::runtime_error("Accessing non-existing player.");
     }
 
-    return it->second;
+    return _players[it->second];
+}
+
+/*!
+ */
+Player& Players::participant(const Game &game, uint32_t index)
+{
+    uint32_t slot = game.playerSlot(index);
+    if (slot >= _players.size() || _players[slot].userId() != game.userId(index))
+    {
+        return (*this)[game.userId(index)];
+    }
+
+    wake(slot);
+
+    return _players[slot];
+}
+
+/*!
+ */
+const Player& Players::participant(const Game &game, uint32_t index) const
+{
+    uint32_t slot = game.playerSlot(index);
+    if (slot >= _players.size() || _players[slot].userId() != game.userId(index))
+    {
+        return (*this)[game.userId(index)];
+    }
+
+    return _players[slot];
 }
 
 /*!
  */
 void Players::add(const Player &player, const std::string &ladderAbbreviation)
 {
-    if (_players.contains(player.userId()))
+    auto [it, isNew] = _slots.try_emplace(player.userId(), static_cast<uint32_t>(_players.size()));
+    if (isNew)
+    {
+        _players.push_back(player);
+    }
+    else
     {
         Log::error() << "User id " << player.userId() << " already exists.";
+        _players[it->second] = player;
     }
 
-    _players[player.userId()] = player;
+    bool wasSkipped = _skippedAfter.erase(it->second) > 0;
+    if (_awakeSlots.has_value() && (isNew || wasSkipped))
+    {
+        _awakeSlots->push_back(it->second);
+    }
 
     const std::map<std::string, std::set<std::string>> &names = player.names();
 
@@ -126,47 +179,195 @@ bool Players::isTestAccount(uint32_t userId) const
 
 /*!
  */
-void Players::update()
+void Players::setThreadPool(ThreadPool *threadPool)
+{
+    _threadPool = threadPool;
+}
+
+/*!
+ */
+void Players::setLazyCatchUp(bool lazyCatchUp)
+{
+    if (!lazyCatchUp)
+    {
+        catchUp();
+    }
+
+    _lazyCatchUp = lazyCatchUp;
+}
+
+/*!
+ */
+void Players::catchUp()
+{
+    while (!_skippedAfter.empty())
+    {
+        wake(_skippedAfter.begin()->first);
+    }
+
+    _awakeSlots.reset();
+}
+
+/*!
+ */
+void Players::wake(uint32_t slot)
 {
-    for (auto it = _players.begin(); it != _players.end(); ++it)
+    std::unordered_map<uint32_t, size_t>::iterator it = _skippedAfter.find(slot);
+    if (it == _skippedAfter.end())
+    {
+        return;
+    }
+
+    // Nothing but the history changes while being settled. Decaying does not change anything either.
+    Player &player = _players[slot];
+    for (size_t i = it->second + 1; i < _ratingPeriods.size(); i++)
     {
-        Player &player = it->second;
+        player.applySettled(_ratingPeriods[i].date);
+    }
+
+    _skippedAfter.erase(it);
+    _awakeSlots->push_back(slot);
+}
 
+/*!
+ */
+std::vector<Player*> Players::playersToProcess()
+{
+    std::vector<Player*> players;
+    if (_awakeSlots.has_value())
+    {
+        // In the order of the slots, so the players are visited in the order of the storage.
+        std::sort(_awakeSlots->begin(), _awakeSlots->end());
+
+        players.reserve(_awakeSlots->size());
+        for (uint32_t slot : *_awakeSlots)
+        {
+            players.push_back(&_players[slot]);
+        }
+
+        return players;
+    }
+
+    players.reserve(_players.size());
+    for (Player &player : _players)
+    {
+        players.push_back(&player);
+    }
+
+    return players;
+}
+
+/*!
+ */
+void Players::forEachPlayer(const std::function<void(Player&)> &function)
+{
+    std::vector<Player*> players = playersToProcess();
+
+    size_t chunkCount = (players.size() + chunkSize - 1) / chunkSize;
+    std::vector<Log::Messages> messages(chunkCount);
+    std::vector<glicko::SolverStatistics> statistics(chunkCount);
+
+    // Threads of the pool use the parameters of the calling thread.
+    std::optional<EngineParameters> parameters = EngineParameters::threadParameters();
+
+    auto processChunk = [&](size_t chunk)
+    {
+        // The statistics of the calling thread are kept aside, it might process chunks as well.
+        glicko::SolverStatistics threadStatistics = std::exchange(glicko::solverStatistics(), {});
+        std::optional<EngineParameters> threadParameters = std::exchange(EngineParameters::threadParameters(), parameters);
+        Log::startCapture();
+
+        for (size_t i = chunk * chunkSize; i < std::min(players.size(), (chunk + 1) * chunkSize); i++)
+        {
+            function(*players[i]);
+        }
+
+        messages[chunk] = Log::stopCapture();
+        statistics[chunk] = std::exchange(glicko::solverStatistics(), threadStatistics);
+        EngineParameters::threadParameters() = threadParameters;
+    };
+
+    if (_threadPool != nullptr)
+    {
+        _threadPool->parallelFor(chunkCount, processChunk);
+    }
+    else
+    {
+        for (size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            processChunk(chunk);
+        }
+    }
+
+    for (size_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+        Log::write(messages[chunk]);
+        glicko::solverStatistics().merge(statistics[chunk]);
+    }
+}
+
+/*!
+ */
+void Players::update()
+{
+    forEachPlayer([](Player &player) {
         if (player.gameCount() == 0 && player.pendingGameCount() == 0)
         {
-            continue;
+            return;
         }
 
+        glicko::SolverStatistics &statistics = glicko::solverStatistics();
+        uint64_t iterations = statistics.iterations;
         player.update();
-    }
+        statistics.addPlayer(player.userId(), statistics.iterations - iterations);
+    });
 }
 
 /*!
  */
 bool Players::hasPendingGames() const
 {
-    bool hasPendingGames = false;
-
-    for (std::unordered_map<uint32_t, Player>::const_iterator it = _players.begin(); it != _players.end() && !hasPendingGames; ++it)
+    if (_awakeSlots.has_value())
     {
-        hasPendingGames |= (it->second.pendingGameCount() > 0);
+        // Skipped players don't have any games.
+        return std::any_of(_awakeSlots->begin(), _awakeSlots->end(), [this](uint32_t slot) { return _players[slot].pendingGameCount() > 0; });
     }
 
-    return hasPendingGames;
+    return std::any_of(_players.begin(), _players.end(), [](const Player &player) { return player.pendingGameCount() > 0; });
 }
 
 /*!
  */
 void Players::apply(std::chrono::year_month_day date, bool decay, gamemodes::GameMode gameMode)
 {
-    for (std::unordered_map<uint32_t, Player>::iterator it = _players.begin(); it != _players.end(); ++it)
-    {
-        Player &player = it->second;
+    _ratingPeriods.push_back({ date, decay, 0 });
+
+    forEachPlayer([&](Player &player) {
         player.apply(date, decay, gameMode);
-        if (it->first == dts::to_underlying(KnownPlayers::BlitzBot))
+        if (player.userId() == dts::to_underlying(KnownPlayers::BlitzBot))
         {
-            Log::debug() << "The blitz bots current rating is " << it->second.elo(factions::Combined) << ".";
+            Log::debug() << "The blitz bots current rating is " << player.elo(factions::Combined) << ".";
         }
+    });
+
+    if (_lazyCatchUp)
+    {
+        // Skip players from now on, who would only add inactive days to their history.
+        std::vector<uint32_t> awakeSlots;
+        for (Player *player : playersToProcess())
+        {
+            uint32_t slot = static_cast<uint32_t>(player - _players.data());
+            if (player->isSettled(gameMode))
+            {
+                _skippedAfter[slot] = _ratingPeriods.size() - 1;
+            }
+            else
+            {
+                awakeSlots.push_back(slot);
+            }
+        }
+
+        _awakeSlots = std::move(awakeSlots);
     }
 }
 
@@ -174,11 +375,143 @@ void Players::apply(std::chrono::year_month_day date, bool decay, gamemodes::Gam
  */
 void Players::decay(int days, gamemodes::GameMode gameMode)
 {
-    for (std::unordered_map<uint32_t, Player>::iterator it = _players.begin(); it != _players.end(); ++it)
+    if (!_ratingPeriods.empty())
     {
-        Player &player = it->second;
+        _ratingPeriods.back().decayDays += days;
+    }
+
+    forEachPlayer([&](Player &player) {
         player.decay(days, gameMode);
+    });
+}
+
+/*!
+ */
+HeadToHead& Players::headToHead()
+{
+    return _headToHead;
+}
+
+/*!
+ */
+const HeadToHead& Players::headToHead() const
+{
+    return _headToHead;
+}
+
+/*!
+ */
+void Players::writeState(BinaryWriter &writer) const
+{
+    if (!_skippedAfter.empty())
+    {
+        Log::error() << _skippedAfter.size() << " players have not caught up. Their history in the checkpoint is incomplete.";
+    }
+
+    writer.write(_ratingPeriods);
+
+    // Sort by user id to get identical files for identical states.
+    std::vector<uint32_t> userIds = this->userIds();
+    std::sort(userIds.begin(), userIds.end());
+
+    writer.write(static_cast<uint64_t>(userIds.size()));
+    for (uint32_t userId : userIds)
+    {
+        writer.write(userId);
+        writer.write(_players[_slots.at(userId)]);
     }
+
+    writer.write(_headToHead);
+}
+
+/*!
+ */
+bool Players::readState(BinaryReader &reader, gamemodes::GameMode gameMode)
+{
+    std::vector<RatingPeriod> ratingPeriods;
+    reader.read(ratingPeriods);
+
+    uint64_t count = 0;
+    reader.read(count);
+
+    // Restore into copies first, so a failure does not leave half restored players behind.
+    // The copies are kept by slot.
+    std::unordered_map<uint32_t, Player> restored;
+    for (uint64_t i = 0; i < count && reader.ok(); i++)
+    {
+        uint32_t userId = 0;
+        reader.read(userId);
+
+        uint32_t slot = this->slot(userId);
+        if (slot == noSlot)
+        {
+            Log::warning() << "Player " << userId << " from checkpoint is unknown.";
+            return false;
+        }
+
+        Player player = _players[slot];
+        reader.read(player);
+        restored.emplace(slot, std::move(player));
+    }
+
+    HeadToHead headToHead;
+    reader.read(headToHead);
+
+    if (!reader.ok())
+    {
+        Log::warning() << "Checkpoint data for players is incomplete.";
+        return false;
+    }
+
+    for (uint32_t slot = 0; slot < _players.size(); slot++)
+    {
+        std::unordered_map<uint32_t, Player>::iterator restoredIt = restored.find(slot);
+        if (restoredIt != restored.end())
+        {
+            _players[slot] = std::move(restoredIt->second);
+            continue;
+        }
+
+        // New player. Catch up with everybody else.
+        for (const RatingPeriod &ratingPeriod : ratingPeriods)
+        {
+            _players[slot].apply(ratingPeriod.date, ratingPeriod.decay, gameMode);
+            if (ratingPeriod.decayDays > 0)
+            {
+                _players[slot].decay(ratingPeriod.decayDays, gameMode);
+            }
+        }
+    }
+
+    _ratingPeriods = std::move(ratingPeriods);
+    _headToHead = std::move(headToHead);
+
+    // All players have been restored or have caught up.
+    _skippedAfter.clear();
+    _awakeSlots.reset();
+
+    Log::info() << "Restored " << restored.size() << " players from checkpoint, "
+                << (_players.size() - restored.size()) << " players are new.";
+
+    return true;
+}
+
+/*!
+ */
+void RatingPeriod::writeState(BinaryWriter &writer) const
+{
+    writer.write(date);
+    writer.write(decay);
+    writer.write(decayDays);
+}
+
+/*!
+ */
+void RatingPeriod::readState(BinaryReader &reader)
+{
+    reader.read(date);
+    reader.read(decay);
+    reader.read(decayDays);
 }
 
 /*!
@@ -187,9 +520,9 @@ uint32_t Players::activePlayerCount() const
 {
     uint32_t result = 0;
 
-    for (std::unordered_map<uint32_t, Player>::const_iterator it = _players.begin(); it != _players.end(); ++it)
+    for (const Player &player : _players)
     {
-        result += it->second.isActive() ? 1 : 0;
+        result += player.isActive() ? 1 : 0;
     }
 
     return result;
@@ -242,12 +575,12 @@ std::map<uint32_t, uint32_t> Players::exportActivePlayers(const std::filesystem:
     std::vector<const Player*> filteredAndSortedPlayers;
     std::vector<const Player*> filteredAndSortedPlayersYesterday;
 
-    for (auto it = _players.cbegin(); it != _players.cend(); ++it)
+    for (const Player &player : _players)
     {
-        if (it->second.isActive())
+        if (player.isActive())
         {
-            filteredAndSortedPlayers.push_back(&(it->second));
-            filteredAndSortedPlayersYesterday.push_back(&(it->second));
+            filteredAndSortedPlayers.push_back(&player);
+            filteredAndSortedPlayersYesterday.push_back(&player);
         }
     }
 
@@ -366,9 +699,8 @@ std::map<uint32_t, uint32_t> Players::exportBestOfAllTime(
     std::vector<const Player*> filteredAndSortedPlayers;
     std::map<uint32_t, uint32_t> rankByUserId;
 
-    for (auto it = _players.cbegin(); it != _players.cend(); ++it)
+    for (const Player &player : _players)
     {
-        const Player &player = it->second;
         PeakRating peak = (gameMode == gamemodes::Blitz2v2 || gameMode == gamemodes::RedAlert2_2v2) ? player.peakRating(factions::Combined) : player.peakRating();
         if (peak.adjustedElo > 0.0)
         {
@@ -449,9 +781,8 @@ void Players::exportMostDaysActive(
 
     std::vector<const Player*> filteredAndSortedPlayers;
 
-    for (auto it = _players.cbegin(); it != _players.cend(); ++it)
+    for (const Player &player : _players)
     {
-        const Player &player = it->second;
         if (player.daysActive() > 0)
         {
             filteredAndSortedPlayers.push_back(&player);
@@ -527,11 +858,11 @@ void Players::exportAlphabeticalOrder(
 
     auto sorter =  [] (const Player *a, const Player *b) { return a->lowerLexicalOrder(*b); };
 
-    for (auto it = _players.cbegin(); it != _players.cend(); ++it)
+    for (const Player &player : _players)
     {
-        if (it->second.wasActive())
+        if (player.wasActive())
         {
-            filteredAndSortedPlayers.push_back(&(it->second));
+            filteredAndSortedPlayers.push_back(&player);
         }
     }
 
@@ -613,15 +944,15 @@ void Players::exportAllPlayers(
 
     auto sorter =  [] (const Player *a, const Player *b) { return a->userId() < b->userId(); };
 
-    for (auto it = _players.cbegin(); it != _players.cend(); ++it)
+    for (const Player &player : _players)
     {
-        if (it->second.gameCount() == 0)
+        if (player.gameCount() == 0)
         {
-            Log::info() << "Ignoring player #" << it->second.userId() << " because no game has been played.";
+            Log::info() << "Ignoring player #" << player.userId() << " because no game has been played.";
         }
         else
         {
-            filteredAndSortedPlayers.push_back(&(it->second));
+            filteredAndSortedPlayers.push_back(&player);
         }
     }
 
@@ -693,12 +1024,12 @@ void Players::exportNewPlayers(const std::filesystem::path &directory, gamemodes
 
     auto sorter =  [] (const Player *a, const Player *b) { return a->lowerLexicalOrder(*b); };
 
-    for (auto it = _players.cbegin(); it != _players.cend(); ++it)
+    for (const Player &player : _players)
     {
         // Need to ask for more than 0 games, otherwise we might get an alt account.
-        if (!it->second.isActive() && it->second.gameCount() > 0 && it->second.daysFromLastGame() <= 30)
+        if (!player.isActive() && player.gameCount() > 0 && player.daysFromLastGame() <= 30)
         {
-            filteredAndSortedPlayers.push_back(&(it->second));
+            filteredAndSortedPlayers.push_back(&player);
         }
     }
 
@@ -745,9 +1076,11 @@ void Players::exportNewPlayers(const std::filesystem::path &directory, gamemodes
  */
 void Players::finalize()
 {
-    for (std::unordered_map<uint32_t, Player>::iterator it = _players.begin(); it != _players.end(); ++it)
+    catchUp();
+
+    for (Player &player : _players)
     {
-        it->second.finalize();
+        player.finalize();
     }
 }
 
@@ -756,31 +1089,31 @@ void Players::finalize()
 void Players::exportPlayerDetails(
     const std::filesystem::path &directory,
     std::vector<uint32_t> userIds,
-    const std::map<uint32_t, Game> &games,
+    const GameStore &games,
     const std::string &ladderAbbreviation) const
 {
     using json = nlohmann::json;
 
     if (userIds.empty())
     {
-        for (const std::pair<uint32_t, Player> &pair : _players)
+        for (const Player &player : _players)
         {
-            if (pair.second.gameCount() > 0)
+            if (player.gameCount() > 0)
             {
-                userIds.push_back(pair.first);
+                userIds.push_back(player.userId());
             }
         }
     }
 
     for (uint32_t id : userIds)
     {
-        if (!_players.contains(id))
+        if (!contains(id))
         {
             Log::warning() << "Player with id " << id << " not found. Nothing to export.";
             continue;
         }
 
-        const Player &player = _players.at(id);
+        const Player &player = _players[_slots.at(id)];
         json jplayer = json::object();
 
         jplayer["alias"] = player.alias();
@@ -791,13 +1124,8 @@ void Players::exportPlayerDetails(
 
         json jHighestRatedVictories = json::array();
 
-        // Reverse the list since it's upside down.
-        const std::set<HighestRatedVictories>& highestRatedVictories = player.highestRatedVictories();
-        std::vector<HighestRatedVictories> hrvs(highestRatedVictories.begin(), highestRatedVictories.end());
-        std::reverse(hrvs.begin(), hrvs.end());
-
         int counter = 1;
-        for (const HighestRatedVictories &highestRatedVictory : hrvs)
+        for (const HighestRatedVictories &highestRatedVictory : player.highestRatedVictories())
         {
             if (highestRatedVictory.ratingDifference <= 0.0)
             {
@@ -809,7 +1137,7 @@ void Players::exportPlayerDetails(
             jGame["id"] = game.id();
             int us = game.winnerIndex();
             int them = us ^ 1;
-            const Player &opponent = _players.at(game.userId(them));
+            const Player &opponent = _players[_slots.at(game.userId(them))];
             jGame["faction"] = factions::shortName(game.faction(us));
             jGame["opponent"] = game.userId(them);
             jGame["opponent_alias"] = opponent.alias();
@@ -826,13 +1154,8 @@ void Players::exportPlayerDetails(
 
         json jLowestRatedDefeats = json::array();
 
-        // Reverse the list since it's upside down.
-        const std::set<LowestRatedDefeats>& lowestRatedDefeats = player.lowestRatedDefeats();
-        std::vector<LowestRatedDefeats> lrds(lowestRatedDefeats.begin(), lowestRatedDefeats.end());
-        std::reverse(lrds.begin(), lrds.end());
-
         counter = 1;
-        for (const LowestRatedDefeats &lowestRatedDefeat : lrds)
+        for (const LowestRatedDefeats &lowestRatedDefeat : player.lowestRatedDefeats())
         {
             if (lowestRatedDefeat.ratingDifference <= 0.0)
             {
@@ -844,7 +1167,7 @@ void Players::exportPlayerDetails(
             jGame["id"] = game.id();
             int us = game.winnerIndex() ^ 1;
             int them = us ^ 1;
-            const Player &opponent = _players.at(game.userId(them));
+            const Player &opponent = _players[_slots.at(game.userId(them))];
             jGame["faction"] = factions::shortName(game.faction(us));
             jGame["opponent"] = game.userId(them);
             jGame["opponent_alias"] = opponent.alias();
@@ -863,18 +1186,23 @@ void Players::exportPlayerDetails(
 
         json jVs = json::array();
 
-        const std::map<uint32_t, Probabilities>& vsOthers = player.vsOtherPlayers();
-        std::set<std::pair<uint32_t, Probabilities>> vsSet;
-        for (auto it = vsOthers.cbegin(); it != vsOthers.cend(); ++it)
-        {
-            vsSet.insert({it->first, it->second});
-        }
-        std::vector<std::pair<uint32_t, Probabilities>> vsVector(vsSet.begin(), vsSet.end());
+        std::vector<std::pair<uint32_t, Probabilities>> vsVector = _headToHead.opponents(player.userId());
+        std::sort(vsVector.begin(), vsVector.end(), [](const std::pair<uint32_t, Probabilities> &a, const std::pair<uint32_t, Probabilities> &b) {
+            if (a.second.result() != b.second.result())
+            {
+                return a.second.result() > b.second.result();
+            }
+            else if (a.second.wins() != b.second.wins())
+            {
+                return a.second.wins() > b.second.wins();
+            }
+            return a.first < b.first;
+        });
         int vsIndex = 1;
         for (std::pair<uint32_t, Probabilities> &probs : vsVector)
         {
             json jopponent = json::object();
-            const Player &opponent = _players.at(probs.first);
+            const Player &opponent = _players[_slots.at(probs.first)];
 
             // We need to set some rules here:
             // - Minimum 20 games
@@ -1015,11 +1343,11 @@ void Players::exportPlayerDetails(
  */
 uint32_t Players::userIdFromAlias(const std::string &alias) const
 {
-    for (auto it = _players.begin(); it != _players.end(); ++it)
+    for (const Player &player : _players)
     {
-        if (it->second.hasAlias() && it->second.alias() == alias)
+        if (player.hasAlias() && player.alias() == alias)
         {
-            return it->first;
+            return player.userId();
         }
     }
 
@@ -2,19 +2,41 @@
 #pragma once
 
 #include <array>
+#include <functional>
+#include <limits>
+#include <optional>
 
 #include <nlohmann/json.hpp>
 
 #include "faction.h"
 #include "gamemode.h"
+#include "headtohead.h"
 #include "player.h"
 
 // Forward declarations:
-class Games;
+class BinaryReader;
+class BinaryWriter;
+class GameStore;
+class ThreadPool;
+
+//! A rating period, which has been applied to all players. The given number of
+//! decay days has been applied right after the period.
+struct RatingPeriod
+{
+    std::chrono::year_month_day date;
+    bool decay = true;
+    int decayDays = 0;
+
+    void writeState(BinaryWriter &writer) const;
+    void readState(BinaryReader &reader);
+};
 
 class Players
 {
 public:
+    //! Slot of players, which don't exist.
+    static const uint32_t noSlot = std::numeric_limits<uint32_t>::max();
+
     //! Constructor.
     Players();
 
@@ -30,32 +52,56 @@ public:
     //! Do we have pending games?
     bool hasPendingGames() const;
 
-    //! Get all user ids.
+    //! Get all user ids in the order the players have been added.
     std::vector<uint32_t> userIds() const;
 
+    //! Get the slot of a player, which is its position in the storage. Slots are given in the
+    //! order the players are added and don't change afterwards. Returns noSlot if the player
+    //! does not exist.
+    uint32_t slot(uint32_t userId) const;
+
     //! Get the index of a player based on his alias.
     //! Returns 0 if no player is found.
     uint32_t userIdFromAlias(const std::string &alias) const;
 
-    //! Add a players. Needs to have a valid user id.
+    //! Add a players. Needs to have a valid user id. References to players become invalid.
     void add(const Player &player, const std::string &ladderAbbreviation);
 
-    //! Array subscript operator. Returns player by user id.
+    //! Array subscript operator. Returns player by user id. Catches up with the rating periods
+    //! the player has skipped, see setLazyCatchUp().
     Player& operator[](uint32_t index);
 
     //! Const array subscript operator. Returns player by user id.
     const Player& operator[](uint32_t index) const;
 
+    //! Get a participant of the game. Uses the slot stored in the game, see Game::setPlayerSlot(),
+    //! and falls back to the user id if the slot does not match. Catches up like operator[].
+    Player& participant(const Game &game, uint32_t index);
+    const Player& participant(const Game &game, uint32_t index) const;
+
     //! Get the number of currently active players.
     uint32_t activePlayerCount() const;
 
     //! Is this account a test account?
     bool isTestAccount(uint32_t userId) const;
 
+    //! Use the given pool for update(), apply() and decay(). The pool must outlive the players.
+    //! Results don't depend on it.
+    void setThreadPool(ThreadPool *threadPool);
+
+    //! Skip players in apply() and decay(), once nothing but their history changes without
+    //! games. They catch up with the skipped rating periods when accessed by the non-const
+    //! operator[] or by catchUp(). Results are the same, but the daily work depends on the
+    //! number of players, who recently played, instead of all players.
+    void setLazyCatchUp(bool lazyCatchUp);
+
+    //! Let all skipped players catch up. Needed before writing the state.
+    void catchUp();
+
     //! Update the ratings.
     void update();
 
-    //! Finalize player calculations.
+    //! Finalize player calculations. Lets all skipped players catch up.
     void finalize();
 
     //! Apply pending games to all players.
@@ -64,6 +110,18 @@ public:
     //! Decay all players ratings.
     void decay(int days, gamemodes::GameMode gameMode);
 
+    //! Results of all 1v1 pairings.
+    HeadToHead& headToHead();
+    const HeadToHead& headToHead() const;
+
+    //! Write the state of all players to a checkpoint. Skipped players must have caught up.
+    void writeState(BinaryWriter &writer) const;
+
+    //! Read the state of all players from a checkpoint. Each player in the checkpoint has to
+    //! exist already. Players not in the checkpoint run through all rating periods applied so
+    //! far, just like they would have in a full run. Nothing is changed if reading fails.
+    bool readState(BinaryReader &reader, gamemodes::GameMode gameMode);
+
     // Exporting methods for actual rankings.
 public:
     //! Export list of active players, sorted by rating. The is the actual ELO list.
@@ -86,11 +144,40 @@ public:
     void exportNewPlayers(const std::filesystem::path &directory, gamemodes::GameMode gameMode) const;
 
     //! Export detailed information about each player.
-    void exportPlayerDetails(const std::filesystem::path &directory, std::vector<uint32_t> userIds, const std::map<uint32_t, Game> &games, const std::string &ladderAbbreviation) const;
+    void exportPlayerDetails(const std::filesystem::path &directory, std::vector<uint32_t> userIds, const GameStore &games, const std::string &ladderAbbreviation) const;
 
 private:
-    //! Players ordered by their user id.
-    std::unordered_map<uint32_t, Player> _players;
+    //! Call the function for all players. Players are split into chunks of a fixed size, which
+    //! run on the thread pool. Log messages and solver statistics are collected per chunk and
+    //! added in the order of the players, so the output does not depend on the thread count.
+    void forEachPlayer(const std::function<void(Player&)> &function);
+
+    //! Players processed by forEachPlayer(). All players, unless some are skipped.
+    std::vector<Player*> playersToProcess();
+
+    //! Let the player in the given slot catch up, if it has been skipped.
+    void wake(uint32_t slot);
+
+    //! Number of players per chunk of forEachPlayer().
+    static const size_t chunkSize = 64;
+
+    //! Players in the order they have been added. Never shrinks, so slots stay valid.
+    std::vector<Player> _players;
+
+    //! Slot of each player by user id.
+    std::unordered_map<uint32_t, uint32_t> _slots;
+
+    //! Optional pool to process players in parallel.
+    ThreadPool *_threadPool = nullptr;
+
+    //! Skip settled players, see setLazyCatchUp().
+    bool _lazyCatchUp = false;
+
+    //! Slots of the players, which are not skipped. Not set if no player is skipped.
+    std::optional<std::vector<uint32_t>> _awakeSlots;
+
+    //! Slots of skipped players and the last rating period applied to them.
+    std::unordered_map<uint32_t, size_t> _skippedAfter;
 
 private:
     //! Get the user id from a nick. First key is the ladder.
@@ -99,5 +186,11 @@ private:
     //! List of user ids, which are just test accounts.
     std::set<uint32_t> _testAccounts;
 
+    //! All rating periods applied so far.
+    std::vector<RatingPeriod> _ratingPeriods;
+
+    //! Results of all 1v1 pairings.
+    HeadToHead _headToHead;
+
 }; // class Players
 
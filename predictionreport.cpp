@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#include <nlohmann/json.hpp>
+
+#include "game.h"
+#include "predictionreport.h"
+
+namespace
+{
+
+/*!
+ * Number of games, log-loss and Brier score as json.
+ */
+nlohmann::json toJson(const PredictionScore &score)
+{
+    nlohmann::json data = nlohmann::json::object();
+    data["games"] = score.games;
+    data["log_loss"] = score.meanLogLoss();
+    data["brier"] = score.meanBrier();
+    return data;
+}
+
+}
+
+/*!
+ */
+void PredictionReport::add(const Game &game, std::chrono::sys_days day)
+{
+    double expected = PredictionScore::expectedResult(game);
+    double actual = PredictionScore::actualResult(game);
+
+    _overall.add(expected, actual);
+
+    std::chrono::year_month_day date{day};
+    _months[static_cast<uint32_t>(static_cast<int>(date.year())) * 100 + static_cast<unsigned>(date.month())].add(expected, actual);
+
+    if (game.playerCount() == 2 && game.faction(0) < factions::Combined && game.faction(1) < factions::Combined)
+    {
+        _setups[factions::fromFactions(game.faction(0), game.faction(1))].add(expected, actual);
+    }
+
+    double deviation = 0.0;
+    for (uint32_t i = 0; i < game.playerCount(); i++)
+    {
+        deviation = std::max(deviation, game.deviation(i));
+    }
+    _deviationBands[std::min(static_cast<size_t>(deviation / deviationBandWidth), deviationBandCount - 1)].add(expected, actual);
+
+    CalibrationBucket &bucket = _calibration[std::min(static_cast<size_t>(expected * calibrationBucketCount), calibrationBucketCount - 1)];
+    bucket.games++;
+    bucket.expected += expected;
+    bucket.actual += actual;
+}
+
+/*!
+ */
+const PredictionScore& PredictionReport::overall() const
+{
+    return _overall;
+}
+
+/*!
+ */
+void PredictionReport::exportReport(const std::filesystem::path &directory, gamemodes::GameMode gameMode) const
+{
+    using json = nlohmann::json;
+
+    json data = json::object();
+    data["description"] = "Quality of the predicted results, taken before each game";
+    data["overall"] = toJson(_overall);
+
+    data["months"] = json::array();
+    for (const auto &[month, score] : _months)
+    {
+        std::ostringstream oss;
+        oss << (month / 100) << "-" << std::setw(2) << std::setfill('0') << (month % 100);
+
+        json jsonMonth = toJson(score);
+        jsonMonth["month"] = oss.str();
+        data["months"].push_back(jsonMonth);
+    }
+
+    data["setups"] = json::array();
+    for (size_t i = 0; i < _setups.size(); i++)
+    {
+        if (_setups[i].games > 0)
+        {
+            json jsonSetup = toJson(_setups[i]);
+            jsonSetup["setup"] = factions::toString(static_cast<factions::Setup>(i));
+            data["setups"].push_back(jsonSetup);
+        }
+    }
+
+    data["deviations"] = json::array();
+    for (size_t i = 0; i < _deviationBands.size(); i++)
+    {
+        json jsonBand = toJson(_deviationBands[i]);
+        jsonBand["from"] = i * deviationBandWidth;
+        if (i + 1 < _deviationBands.size())
+        {
+            jsonBand["to"] = (i + 1) * deviationBandWidth;
+        }
+        data["deviations"].push_back(jsonBand);
+    }
+
+    // Expected and actual results should be close in each bucket.
+    data["calibration"] = json::array();
+    for (size_t i = 0; i < _calibration.size(); i++)
+    {
+        const CalibrationBucket &bucket = _calibration[i];
+
+        json jsonBucket = json::object();
+        jsonBucket["from"] = static_cast<double>(i) / calibrationBucketCount;
+        jsonBucket["to"] = static_cast<double>(i + 1) / calibrationBucketCount;
+        jsonBucket["games"] = bucket.games;
+        jsonBucket["expected"] = bucket.games > 0 ? bucket.expected / static_cast<double>(bucket.games) : 0.0;
+        jsonBucket["actual"] = bucket.games > 0 ? bucket.actual / static_cast<double>(bucket.games) : 0.0;
+        data["calibration"].push_back(jsonBucket);
+    }
+
+    std::ofstream stream(directory / (gamemodes::shortName(gameMode) + "_predictions.json"));
+    stream << std::setw(4) << data << std::endl;
+    stream.close();
+}
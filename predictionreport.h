@@ -0,0 +1,67 @@
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <map>
+
+#include "faction.h"
+#include "gamemode.h"
+#include "predictionscore.h"
+
+// Forward declarations:
+class Game;
+
+/*!
+ * Quality of the predicted results of all processed games, computed along the way. Each game is
+ * scored with the ratings its players have at the start of its rating day, after the previous
+ * day and the decay have been applied. Scores are kept per month, per faction
+ * setup and per deviation band, along with a calibration table. Each bucket only keeps sums.
+ */
+class PredictionReport
+{
+public:
+    //! Width (elo) of a deviation band. Games are put into the band of the highest deviation.
+    static constexpr double deviationBandWidth = 25.0;
+
+    //! Number of deviation bands. The last one includes everything above.
+    static const size_t deviationBandCount = 14;
+
+    //! Number of equally wide calibration buckets of the expected result.
+    static const size_t calibrationBucketCount = 10;
+
+    //! Add a game of the given rating day. Ratings at the start of the day must have been set to the game.
+    void add(const Game &game, std::chrono::sys_days day);
+
+    //! Score of all games added so far.
+    const PredictionScore& overall() const;
+
+    //! Write the report to <game mode>_predictions.json in the given directory.
+    void exportReport(const std::filesystem::path &directory, gamemodes::GameMode gameMode) const;
+
+private:
+    //! Games with similar expected results.
+    struct CalibrationBucket
+    {
+        uint64_t games = 0;
+        double expected = 0.0;
+        double actual = 0.0;
+    };
+
+    //! All games.
+    PredictionScore _overall;
+
+    //! Games by month (year * 100 + month).
+    std::map<uint32_t, PredictionScore> _months;
+
+    //! 1v1 games by faction setup, seen from the first player.
+    std::array<PredictionScore, factions::UnknownSetup> _setups;
+
+    //! Games by the highest deviation of all players.
+    std::array<PredictionScore, deviationBandCount> _deviationBands;
+
+    //! Games by the expected result of the first player.
+    std::array<CalibrationBucket, calibrationBucketCount> _calibration;
+
+}; // class PredictionReport
@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <cmath>
+
+#include "game.h"
+#include "predictionscore.h"
+#include "rating.h"
+
+/*!
+ */
+void PredictionScore::add(double expected, double result)
+{
+    // Certain predictions would add an infinite loss.
+    double p = std::clamp(expected, 1e-15, 1.0 - 1e-15);
+
+    games++;
+    logLoss -= result * std::log(p) + (1.0 - result) * std::log(1.0 - p);
+    brier += (expected - result) * (expected - result);
+}
+
+/*!
+ */
+void PredictionScore::merge(const PredictionScore &other)
+{
+    games += other.games;
+    logLoss += other.logLoss;
+    brier += other.brier;
+}
+
+/*!
+ */
+double PredictionScore::meanLogLoss() const
+{
+    return games > 0 ? logLoss / static_cast<double>(games) : 0.0;
+}
+
+/*!
+ */
+double PredictionScore::meanBrier() const
+{
+    return games > 0 ? brier / static_cast<double>(games) : 0.0;
+}
+
+/*!
+ */
+double PredictionScore::expectedResult(const Game &game)
+{
+    if (game.playerCount() == 2)
+    {
+        Rating myRating(game.rating(0), game.deviation(0), glicko::initialVolatility);
+        Rating otherRating(game.rating(1), game.deviation(1), glicko::initialVolatility);
+        return myRating.e_star(otherRating.toArray(), 0.0);
+    }
+
+    // Same as the team statistics.
+    uint32_t mateIndex = game.mateIndex(0);
+    std::pair<uint32_t, uint32_t> opponents = game.opponentsIndices(0);
+    Rating teamRating(game.rating(0) + game.rating(mateIndex), game.deviation(0) + game.deviation(mateIndex), glicko::initialVolatility);
+    Rating opponentsRating(game.rating(opponents.first) + game.rating(opponents.second),
+                           game.deviation(opponents.first) + game.deviation(opponents.second), glicko::initialVolatility);
+    return teamRating.e_star(opponentsRating.toArray(), 0.0);
+}
+
+/*!
+ */
+double PredictionScore::actualResult(const Game &game)
+{
+    if (game.isDraw())
+    {
+        return 0.5;
+    }
+
+    return game.hasWon(0) ? 1.0 : 0.0;
+}
@@ -0,0 +1,43 @@
+
+#pragma once
+
+#include <cstdint>
+
+// Forward declarations:
+class Game;
+
+/*!
+ * Quality of predicted results. Only sums are kept, so the score can be added up game by game
+ * and scores of several parts can be merged.
+ */
+struct PredictionScore
+{
+    //! Number of predicted games.
+    uint64_t games = 0;
+
+    //! Sum of the log-loss of all games.
+    double logLoss = 0.0;
+
+    //! Sum of the squared differences between expected and actual result (Brier score).
+    double brier = 0.0;
+
+    //! Add a game with the given expected and actual result (1 win, 0.5 draw, 0 loss).
+    void add(double expected, double result);
+
+    //! Add the games of another score.
+    void merge(const PredictionScore &other);
+
+    //! Average log-loss per game. Lower is better, 0.693 is as good as guessing.
+    double meanLogLoss() const;
+
+    //! Average Brier score per game. Lower is better, 0.25 is as good as guessing.
+    double meanBrier() const;
+
+    //! Expected result of the first player, together with the team mate in team games. Taken
+    //! from the ratings set to the game before it is processed, like the player statistics.
+    static double expectedResult(const Game &game);
+
+    //! Actual result of the first player, together with the team mate in team games.
+    static double actualResult(const Game &game);
+
+}; // struct PredictionScore
@@ -1,40 +1,58 @@
 
+#include <algorithm>
 #include <exception>
 
+#include "binarystream.h"
 #include "probabilities.h"
 #include "knownplayers.h"
 #include "logging.h"
 #include "rating.h"
 
-bool Probabilities::_initialized = false;
+std::once_flag Probabilities::_initialized;
 std::array<double, 10000> Probabilities::_eloDifference;
 
 /*!
  */
-void Probabilities::initialize()
+Probabilities::Probabilities(bool keepHistory) :
+    _keepHistory(keepHistory)
 {
-    if (Probabilities::_initialized)
-    {
-        throw std::runtime_error("Probabilities have already been initialized.");
-    }
+}
 
-    Rating rating;
+/*!
+ */
+Probabilities Probabilities::fromTotals(uint32_t games, uint32_t wins, double expectedSum)
+{
+    Probabilities::initialize();
+
+    Probabilities probabilities;
+    probabilities._games = games;
+    probabilities._wins = wins;
+    probabilities._expectedSum = expectedSum;
+    probabilities.finalize();
+    return probabilities;
+}
 
-    double currentRating = 0.0;
-    while (currentRating <= 3000.0)
-    {
-        Rating myRating(currentRating, glicko::initialDeviation, glicko::initialVolatility);
-        double winningProbability = myRating.e_star(rating.toArray(), 0.0);
+/*!
+ */
+void Probabilities::initialize()
+{
+    std::call_once(Probabilities::_initialized, []() {
+        Rating rating;
 
-        winningProbability *= 10000;
-        winningProbability += 0.5;
+        double currentRating = 0.0;
+        while (currentRating <= 3000.0)
+        {
+            Rating myRating(currentRating, glicko::initialDeviation, glicko::initialVolatility);
+            double winningProbability = myRating.e_star(rating.toArray(), 0.0);
 
-        Probabilities::_eloDifference[static_cast<int>(winningProbability)] = currentRating - glicko::initialRating;
+            winningProbability *= 10000;
+            winningProbability += 0.5;
 
-        currentRating += 0.01;
-    }
+            Probabilities::_eloDifference[static_cast<int>(winningProbability)] = currentRating - glicko::initialRating;
 
-    Probabilities::_initialized = true;
+            currentRating += 0.01;
+        }
+    });
 }
 
 /*!
@@ -55,7 +73,7 @@ uint32_t Probabilities::losses() const
  */
 uint32_t Probabilities::count() const
 {
-    return static_cast<uint32_t>(_winningProbabilities.size());
+    return _games;
 }
 
 /*!
@@ -67,64 +85,61 @@ void Probabilities::addGame(double winningProbability, std::chrono::sys_days dat
         throw std::runtime_error("Trying to add probability to a finalized class.");
     }
 
-    if (!Probabilities::_initialized)
-    {
-        Probabilities::initialize();
-    }
+    Probabilities::initialize();
 
-    _winningProbabilities.push_back(winningProbability);
-    _dates.push_back(date);
-    _win.push_back(isWin);
+    _games++;
+    _expectedSum += winningProbability;
 
     if (isWin)
     {
         _wins++;
     }
+
+    if (_keepHistory)
+    {
+        if (!_days.empty() && _days.back().date == date)
+        {
+            _days.back().games = _games;
+            _days.back().wins = _wins;
+            _days.back().expected = _expectedSum;
+        }
+        else
+        {
+            std::chrono::sys_days latest = _days.empty() ? date : std::max(_days.back().latest, date);
+            _days.push_back({ date, latest, _games, _wins, _expectedSum });
+        }
+    }
 }
 
 /*!
  */
 ProbResult Probabilities::result(std::chrono::sys_days date) const
 {
-    ProbResult result{0, 0, 0.0, 0.0, 0.0};
-
-    if (_winningProbabilities.empty())
-    {
-        return result;
-    }
-
-    for (size_t i = 0; i < _winningProbabilities.size(); i++)
+    if (!_keepHistory)
     {
-        if (_dates[i] > date)
-            break;
-        result.expected += _winningProbabilities[i];
-        result.games++;
-        result.wins += _win[i] ? 1 : 0;
-        result.lastGame = std::chrono::year_month_day{ _dates[i] };
+        throw std::runtime_error("Trying to get probability up to a date without history.");
     }
 
-    result.expected /= static_cast<double>(result.games);
-    result.actual = static_cast<double>(result.wins) / static_cast<double>(result.games);
-
-    double expEloDiffSum = Probabilities::_eloDifference[static_cast<uint32_t>(result.expected * 10000 + 0.5)];
-    double curEloDiffSum = Probabilities::_eloDifference[static_cast<uint32_t>(result.actual * 10000 + 0.5)];
+    ProbResult result{0, 0, 0.0, 0.0, 0.0};
 
-    Rating myRating(glicko::initialRating, glicko::initialDeviation, glicko::initialVolatility);
-    double eloDiffAcc = curEloDiffSum - expEloDiffSum;
+    // All games before the first one after the date.
+    auto it = std::upper_bound(_days.begin(), _days.end(), date, [](std::chrono::sys_days value, const Day &day) {
+        return value < day.latest;
+    });
 
-    if (result.games == result.wins)
+    if (it == _days.begin())
     {
-        result.normalized = 1.0;
-    }
-    else if (result.wins == 0)
-    {
-        result.normalized = 0.0;
-    }
-    else
-    {
-        result.normalized = myRating.e_star(myRating.toArray(), eloDiffAcc);
+        return result;
     }
 
+    const Day &day = *std::prev(it);
+    result.games = day.games;
+    result.wins = day.wins;
+    result.lastGame = std::chrono::year_month_day{ day.date };
+    result.expected = day.expected / static_cast<double>(result.games);
+    result.actual = static_cast<double>(result.wins) / static_cast<double>(result.games);
+    result.normalized = normalize(result.expected, result.actual, result.games, result.wins);
+
     return result;
 }
 
@@ -134,39 +149,36 @@ void Probabilities::finalize()
 {
     _isFinalized = true;
 
-    if (_winningProbabilities.empty())
+    if (_games == 0)
     {
         return;
     }
 
-    for (double winningProbability : _winningProbabilities)
+    _expected = _expectedSum / static_cast<double>(_games);
+    _actual = static_cast<double>(_wins) / static_cast<double>(_games);
+    _normalized = normalize(_expected, _actual, _games, _wins);
+}
+
+/*!
+ */
+double Probabilities::normalize(double expected, double actual, uint32_t games, uint32_t wins)
+{
+    if (games == wins)
     {
-        _expected += winningProbability;
+        return 1.0;
+    }
+    else if (wins == 0)
+    {
+        return 0.0;
     }
 
-    _expected /= static_cast<double>(_winningProbabilities.size());
-
-    uint32_t games = count();
-    _actual = static_cast<double>(_wins) / static_cast<double>(games);
-
-    double expEloDiffSum = Probabilities::_eloDifference[static_cast<uint32_t>(_expected * 10000 + 0.5)];
-    double curEloDiffSum = Probabilities::_eloDifference[static_cast<uint32_t>(_actual * 10000 + 0.5)];
+    double expEloDiffSum = Probabilities::_eloDifference[static_cast<uint32_t>(expected * 10000 + 0.5)];
+    double curEloDiffSum = Probabilities::_eloDifference[static_cast<uint32_t>(actual * 10000 + 0.5)];
 
     Rating myRating(glicko::initialRating, glicko::initialDeviation, glicko::initialVolatility);
     double eloDiffAcc = curEloDiffSum - expEloDiffSum;
 
-    if (games == _wins)
-    {
-        _normalized = 1.0;
-    }
-    else if (_wins == 0)
-    {
-        _normalized = 0.0;
-    }
-    else
-    {
-        _normalized = myRating.e_star(myRating.toArray(), eloDiffAcc);
-    }
+    return myRating.e_star(myRating.toArray(), eloDiffAcc);
 }
 
 /*!
@@ -265,3 +277,56 @@ bool operator<(std::pair<uint32_t, const Probabilities&> a, std::pair<uint32_t,
         return &a < &b;
     }
 }
+
+/*!
+ */
+void Probabilities::writeState(BinaryWriter &writer) const
+{
+    if (_isFinalized)
+    {
+        throw std::runtime_error("Trying to write a finalized probability class.");
+    }
+
+    writer.write(_keepHistory);
+    writer.write(_days);
+    writer.write(_games);
+    writer.write(_wins);
+    writer.write(_expectedSum);
+}
+
+/*!
+ */
+void Probabilities::readState(BinaryReader &reader)
+{
+    Probabilities::initialize();
+
+    reader.read(_keepHistory);
+    reader.read(_days);
+    reader.read(_games);
+    reader.read(_wins);
+    reader.read(_expectedSum);
+    _expected = 0.0;
+    _isFinalized = false;
+}
+
+/*!
+ */
+void Probabilities::Day::writeState(BinaryWriter &writer) const
+{
+    writer.write(date);
+    writer.write(latest);
+    writer.write(games);
+    writer.write(wins);
+    writer.write(expected);
+}
+
+/*!
+ */
+void Probabilities::Day::readState(BinaryReader &reader)
+{
+    reader.read(date);
+    reader.read(latest);
+    reader.read(games);
+    reader.read(wins);
+    reader.read(expected);
+}
@@ -4,9 +4,14 @@
 #include <array>
 #include <chrono>
 #include <cstdint>
+#include <mutex>
 #include <string>
 #include <vector>
 
+// Forward declarations:
+class BinaryReader;
+class BinaryWriter;
+
 struct ProbResult
 {
     uint32_t games;
@@ -17,10 +22,20 @@ struct ProbResult
     std::chrono::year_month_day lastGame;
 };
 
+/*!
+ * Expected and actual results of a series of games. Only sums are kept. With history, the sums
+ * are also kept for each day games have been added, to get the results up to a given date.
+ */
 class Probabilities
 {
 public:
+    //! Constructor. Without history, result(date) can't be used.
+    explicit Probabilities(bool keepHistory = false);
+
+    //! Finalized probabilities of games summed up elsewhere.
+    static Probabilities fromTotals(uint32_t games, uint32_t wins, double expectedSum);
 
+    //! Initialize the table of elo differences. Only done once, safe to call from several threads.
     static void initialize();
 
     //! Get the number of wins.
@@ -32,7 +47,8 @@ public:
     //! Get the number of total games played.
     uint32_t count() const;
 
-    //! Get the result for all games up to (including) the given date.
+    //! Get the result for all games up to (including) the given date. Games are taken in the order
+    //! they have been added until the first game after the date. Needs history.
     ProbResult result(std::chrono::sys_days date) const;
 
     //! Add a win with the given winning probability.
@@ -56,16 +72,50 @@ public:
     //! Get the result in elo diffence.
     double eloDifference() const;
 
+    //! Write the games added so far to a checkpoint. Must not be finalized.
+    void writeState(BinaryWriter &writer) const;
+
+    //! Read the games from a checkpoint.
+    void readState(BinaryReader &reader);
+
 private:
-    //! Winning probabilities for each game. Will be e
-    //! valuated during finalization.
-    std::vector<double> _winningProbabilities;
+    //! Sums of all games added up to a day.
+    struct Day
+    {
+        //! Date of the games.
+        std::chrono::sys_days date;
+
+        //! Latest date of all games so far. Games aren't necessarily added in order.
+        std::chrono::sys_days latest;
+
+        //! Number of games so far.
+        uint32_t games;
+
+        //! Number of wins so far.
+        uint32_t wins;
+
+        //! Sum of the winning probabilities so far.
+        double expected;
+
+        void writeState(BinaryWriter &writer) const;
+        void readState(BinaryReader &reader);
+    };
+
+    //! Normalized winning probability for the given expected and actual win rate.
+    static double normalize(double expected, double actual, uint32_t games, uint32_t wins);
+
+    //! Keep the sums of each day?
+    bool _keepHistory;
+
+    //! Sums up to each day with games, if history is kept. Consecutive games of the same day are
+    //! combined.
+    std::vector<Day> _days;
 
-    //! The dates of the games.
-    std::vector<std::chrono::sys_days> _dates;
+    //! Number of games.
+    uint32_t _games = 0;
 
-    //! Wins and losses.
-    std::vector<bool> _win;
+    //! Sum of the winning probabilities.
+    double _expectedSum = 0.0;
 
     //! Number of wins.
     uint32_t _wins = 0;
@@ -84,7 +134,7 @@ private:
     bool _isFinalized = false;
 
     //! Elo differences not initialized by default.
-    static bool _initialized;
+    static std::once_flag _initialized;
 
     //! Elo difference for winning probabily between 0.0000% to 0.9999%.
     static std::array<double, 10000> _eloDifference;
@@ -1,6 +1,11 @@
  
+#include <atomic>
 #include <cassert>
 
+#include "binarystream.h"
+#include "decaytable.h"
+#include "engineparameters.h"
+#include "glickokernel.h"
 #include "logging.h"
 #include "rating.h"
 
@@ -10,7 +15,7 @@ Rating::Rating()
 {
     _rating = (glicko::initialRating - glicko::initialRating) / glicko::scaleFactor;
     _deviation = glicko::initialDeviation / glicko::scaleFactor;
-    _volatility = glicko::initialVolatility;
+    _volatility = EngineParameters::current().initialVolatility;
 
     _pendingRating = _rating;
     _pendingDeviation = _deviation;
@@ -79,102 +84,184 @@ double Rating::e(const std::array<double, 3> &opponent) const
 
 /*!
  */
-double Rating::variance(const std::vector<std::array<double, 3>> &opponents)
+double Rating::volatility(double delta, double variance) const
 {
-    double variance = 0.0;
-
-    for (size_t i = 0; i < opponents.size(); i++)
-    {
-        double e = this->e(opponents[i]);
-        variance += std::pow(g(std::get<glicko::Deviation>(opponents[i])), 2) * e * (1.0 - e);
-    }
-
-    return 1.0 / variance;
-}
-
-/*!
- */
-double Rating::delta(const std::vector<std::array<double, 3>> &opponents, const std::vector<double>& results, double variance)
-{
-    double delta = 0.0;
-
-    for (size_t i = 0; i < opponents.size(); i++)
-    {
-        delta += g(std::get<glicko::Deviation>(opponents[i])) * (results[i] - e(opponents[i]));
-    }
-
-    return delta * variance;
-}
-
-/*!
- */
-double Rating::volatility(const std::vector<std::array<double, 3>> &opponents, const std::vector<double>& results, double variance)
-{
-    // Step 4
-    const double delta = this->delta(opponents, results, variance);
-
     // Step 5
     // 5.1
     const double a = log(pow(_volatility, 2));
-    auto f = [&, this](double x)
+    const double delta2 = pow(delta, 2);
+    const double deviation2 = pow(_deviation, 2);
+    const double tau = EngineParameters::current().tau;
+    const double tau2 = pow(tau, 2);
+    auto f = [&](double x)
     {
-        return exp(x) * (pow(delta, 2) - pow(_deviation, 2) - variance - exp(x)) / (2 * pow(pow(_deviation, 2) + variance + exp(x), 2)) - (x - a) / pow(glicko::tau, 2);
+        double ex = exp(x);
+        return ex * (delta2 - deviation2 - variance - ex) / (2 * pow(deviation2 + variance + ex, 2)) - (x - a) / tau2;
     };
 
     // 5.2
     double A = a;
-    double B, k;
-    if (pow(delta, 2) > pow(_deviation, 2) + variance)
+    double fA = f(A);
+    double B, fB, k;
+    if (delta2 > deviation2 + variance)
     {
-        B = log(pow(delta, 2) - pow(_deviation, 2) - variance);
+        B = log(delta2 - deviation2 - variance);
+        fB = f(B);
     }
     else
     {
         k = 1.0;
-        while (f(a - k * glicko::tau) < 0)
+        while ((fB = f(a - k * tau)) < 0)
         {
             k = k + 1;
         }
-        B = a - k * glicko::tau;
+        B = a - k * tau;
     }
 
-    // 5.3
-    double fA = f(A);
-    double fB = f(B);
-    double C, fC;
+    // 5.3 and 5.4
+    glicko::SolverStatistics &statistics = glicko::solverStatistics();
+    uint32_t iterations = 0;
+    uint32_t relaxations = 0;
+    bool converged = true;
 
-    // 5.4
+    if (glicko::volatilitySolver() == glicko::VolatilitySolver::Brent)
+    {
+        // Without convergence the best iterate is still within the bracket and closer than its ends.
+        A = findRootBrent(f, A, B, fA, fB, glicko::convergence, glicko::maxSolverIterations, iterations, converged);
+    }
+    else
+    {
+        // GLICKO-BUG: Does not converge in any case. Needed to add a counter
+        //           : to use worse values.
+        uint32_t steps = 0;
+        double convergence = glicko::convergence;
+        double C, fC;
 
-    // GLICKO-BUG: Does not converge in any case. Needed to add a counter
-    //           : to use worse values.
-    uint32_t steps = 0;
-    double convergence = glicko::convergence;
+        while (std::abs(B - A) > convergence)
+        {
+            C = A + (A - B) * fA / (fB - fA);
+            fC = f(C);
+            if (fC * fB < 0.0)
+            {
+                A = B;
+                fA = fB;
+            }
+            else
+            {
+                fA = fA / 2.0;
+            }
+            B = C;
+            fB = fC;
+            steps++;
+            iterations++;
+            if (steps > 100000)
+            {
+                steps = 0;
+                convergence *= 10;
+                relaxations++;
+            }
+        }
+    }
+
+    statistics.add(iterations, relaxations, converged);
 
-    while (std::abs(B - A) > convergence)
+    // 5.5
+    return exp(A / 2.0);
+}
+
+/*!
+ */
+template<typename F>
+double Rating::findRootBrent(F f, double a, double b, double fa, double fb, double convergence, uint32_t maxIterations,
+                             uint32_t &iterations, bool &converged)
+{
+    // Brent's method: inverse quadratic interpolation and secant steps, falling back to bisection
+    // whenever they don't shrink the bracket fast enough. The root stays bracketed by b and c.
+    double c = b;
+    double fc = fb;
+    double d = 0.0;
+    double e = 0.0;
+
+    for (iterations = 0; ; iterations++)
     {
-        C = A + (A - B) * fA / (fB - fA);
-        fC = f(C);
-        if (fC * fB < 0.0)
+        if ((fb > 0.0 && fc > 0.0) || (fb < 0.0 && fc < 0.0))
         {
-            A = B;
-            fA = fB;
+            c = a;
+            fc = fa;
+            d = b - a;
+            e = d;
         }
-        else
+
+        if (std::abs(fc) < std::abs(fb))
         {
-            fA = fA / 2.0;
+            a = b;
+            b = c;
+            c = a;
+            fa = fb;
+            fb = fc;
+            fc = fa;
         }
-        B = C;
-        fB = fC;
-        steps++;
-        if (steps > 100000)
+
+        double tolerance = 2.0 * std::numeric_limits<double>::epsilon() * std::abs(b) + 0.5 * convergence;
+        double middle = 0.5 * (c - b);
+        if (std::abs(middle) <= tolerance || fb == 0.0)
         {
-            steps = 0;
-            convergence *= 10;
+            converged = true;
+            return b;
         }
-    }
 
-    // 5.5
-    return exp(A / 2.0);
+        // b is the iterate with the smallest |f| at this point.
+        if (iterations == maxIterations)
+        {
+            converged = false;
+            return b;
+        }
+
+        if (std::abs(e) >= tolerance && std::abs(fa) > std::abs(fb))
+        {
+            double s = fb / fa;
+            double p, q;
+            if (a == c)
+            {
+                p = 2.0 * middle * s;
+                q = 1.0 - s;
+            }
+            else
+            {
+                double r = fb / fc;
+                q = fa / fc;
+                p = s * (2.0 * middle * q * (q - r) - (b - a) * (r - 1.0));
+                q = (q - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+
+            if (p > 0.0)
+            {
+                q = -q;
+            }
+            p = std::abs(p);
+
+            if (2.0 * p < std::min(3.0 * middle * q - std::abs(tolerance * q), std::abs(e * q)))
+            {
+                e = d;
+                d = p / q;
+            }
+            else
+            {
+                d = middle;
+                e = d;
+            }
+        }
+        else
+        {
+            d = middle;
+            e = d;
+        }
+
+        a = b;
+        fa = fb;
+        b += (std::abs(d) > tolerance) ? d : (middle > 0.0 ? tolerance : -tolerance);
+        fb = f(b);
+    }
 }
 
 /*!
@@ -187,8 +274,8 @@ uint32_t Rating::gameCount() const
 /*!
  */
 void Rating::updateWithNoWin(
-    const std::vector<std::array<double, 3>>& opponents,
-    const std::vector<double>& results,
+    glicko::Opponents opponents,
+    glicko::Results results,
     bool extendedLogging)
 {
     assert(opponents.size() == results.size());
@@ -206,7 +293,7 @@ void Rating::updateWithNoWin(
 
     for (size_t i = 0; i < opponents.size(); i++)
     {
-        rating.updateNormally({opponents[i]}, {results[i]});
+        rating.updateNormally(opponents.subspan(i, 1), results.subspan(i, 1));
         rating.apply();
     }
 
@@ -222,8 +309,8 @@ void Rating::updateWithNoWin(
 /*!
  */
 void Rating::updateWithFirstWin(
-    const std::vector<std::array<double, 3>>& opponents,
-    const std::vector<double>& results,
+    glicko::Opponents opponents,
+    glicko::Results results,
     bool useBest,
     bool extendedLogging)
 {
@@ -258,27 +345,26 @@ void Rating::updateWithFirstWin(
 
 /*!
  */
-void Rating::updateNormally(const std::vector<std::array<double, 3>>& opponents, const std::vector<double>& results)
+void Rating::updateNormally(glicko::Opponents opponents, glicko::Results results)
 {
-    double variance = this->variance(opponents);
+    // Variance and delta in a single pass over the opponents. The buffer is reused to not
+    // allocate for every player.
+    thread_local glicko::OpponentBuffer buffer;
+    buffer.assign(opponents, results);
+    glicko::PeriodSums sums = glicko::accumulate(_rating, buffer.ratings, buffer.deviations, buffer.results);
+
+    double variance = 1.0 / sums.variance;
 
-    _pendingVolatility = this->volatility(opponents, results, variance); // Based on old deviation and vola.
+    _pendingVolatility = this->volatility(sums.improvement * variance, variance); // Based on old deviation and vola.
     _pendingDeviation = sqrt(pow(_deviation, 2) + pow(_pendingVolatility, 2));
     _pendingDeviation = 1.0 / sqrt((1.0 / pow(_pendingDeviation, 2)) + (1 / variance));
 
-    double ratingDeviationSum = 0.0;
-
-    for (size_t i = 0; i < opponents.size(); i++)
-    {
-        ratingDeviationSum += this->g(std::get<glicko::Deviation>(opponents[i])) * (results[i] - this->e(opponents[i]));
-    }
-
-    _pendingRating += (pow(_pendingDeviation, 2) * ratingDeviationSum);
+    _pendingRating += (pow(_pendingDeviation, 2) * sums.improvement);
 }
 
 /*!
  */
-Rating::CalculationType Rating::update(const std::vector<std::array<double, 3>>& opponents, const std::vector<double>& results, CalculationType calculationType)
+Rating::CalculationType Rating::update(glicko::Opponents opponents, glicko::Results results, CalculationType calculationType)
 {
     _pendingGames += opponents.size();
 
@@ -316,6 +402,13 @@ Rating::CalculationType Rating::update(const std::vector<std::array<double, 3>>&
     }
 }
 
+/*!
+ */
+Rating::CalculationType Rating::update(const std::array<double, 3> &opponent, double result, CalculationType calculationType)
+{
+    return update(glicko::Opponents(&opponent, 1), glicko::Results(&result, 1), calculationType);
+}
+
 /*!
  */
 void Rating::decay(bool wasActive, double factor, double maxDeviationAfterActive)
@@ -323,13 +416,34 @@ void Rating::decay(bool wasActive, double factor, double maxDeviationAfterActive
     // Convert internal deviation to true deviation.
     double trueDeviation = deviation() * glicko::scaleFactor;
 
-    // This is a custom deviation function.
-    trueDeviation = std::min(wasActive ? maxDeviationAfterActive : 350.0, trueDeviation + (std::pow(std::log(trueDeviation) / std::log(factor), factor) / 100.0f));
+    trueDeviation = std::min(wasActive ? maxDeviationAfterActive : 350.0, decayStep(trueDeviation, factor));
 
     // Back to internal deviation.
     _deviation = trueDeviation / glicko::scaleFactor;
 }
 
+/*!
+ */
+void Rating::decay(bool wasActive, int days, const DecayTable &table, double maxDeviationAfterActive)
+{
+    if (days <= 0)
+    {
+        return;
+    }
+
+    // Once the maximum is reached, it is kept. So clamping the result is the same as clamping every day.
+    double trueDeviation = std::min(wasActive ? maxDeviationAfterActive : 350.0, table.deviationAfter(eloDeviation(), days));
+    _deviation = trueDeviation / glicko::scaleFactor;
+}
+
+/*!
+ */
+double Rating::decayStep(double trueDeviation, double factor)
+{
+    // This is a custom deviation function.
+    return trueDeviation + (std::pow(std::log(trueDeviation) / std::log(factor), factor) / 100.0f);
+}
+
 /*!
  */
 void Rating::apply()
@@ -387,69 +501,133 @@ double Rating::eloDeviation() const
 
 /*!
  */
-std::optional<double> Rating::findInitialRatingImproved(const std::vector<std::array<double, 3>>& opponents, const std::vector<double>& results)
+std::optional<double> Rating::findInitialRatingImproved(glicko::Opponents opponents, glicko::Results results)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    double improvedElo = (glicko::initialRatingSearch() == glicko::InitialRatingSearch::Root)
+        ? findInitialRatingByRoot(opponents, results)
+        : findInitialRatingOnGrid(opponents, results);
+
+    glicko::SolverStatistics &statistics = glicko::solverStatistics();
+    statistics.initialRatingSearches++;
+    statistics.initialRatingTime += std::chrono::steady_clock::now() - start;
+
+    return improvedElo;
+}
+
+/*!
+ */
+double Rating::findInitialRatingOnGrid(glicko::Opponents opponents, glicko::Results results)
 {
     double bestDiff = std::numeric_limits<double>::max();
     double improvedElo;
-    double currentElo = 3000.0;
 
-    while (currentElo > 100.0)
+    // Try all start values of a pass and keep the one changing the least.
+    auto tryPass = [&](double currentElo, double destinationElo, double step)
     {
-        Rating rating(currentElo, glicko::initialDeviation, glicko::initialVolatility);
-        rating.updateWithNoWin(opponents, results, false);
-        rating.apply();
+        std::vector<double> elos;
+        while (currentElo > destinationElo)
+        {
+            elos.push_back(currentElo);
+            currentElo -= step;
+        }
 
-        if (abs(currentElo - rating.elo()) < bestDiff)
+        std::vector<double> resultingElos = tryInitialRatings(elos, opponents, results);
+
+        for (size_t i = 0; i < elos.size(); i++)
         {
-            bestDiff = abs(currentElo - rating.elo());
-            improvedElo = rating.elo();
+            if (abs(elos[i] - resultingElos[i]) < bestDiff)
+            {
+                bestDiff = abs(elos[i] - resultingElos[i]);
+                improvedElo = resultingElos[i];
+            }
         }
+    };
 
-        currentElo -= 100.0;
-    }
+    tryPass(glicko::maxInitialRating, glicko::minInitialRating, 100.0);
+    tryPass(improvedElo + 50.0, improvedElo - 50.0, 10.0);
+    tryPass(improvedElo + 5.0, improvedElo - 5.0, 1.0);
 
-    currentElo = improvedElo + 50.0;
-    double destinationElo = improvedElo - 50.0;
+    return improvedElo;
+}
 
-    while (currentElo > destinationElo)
+/*!
+ */
+double Rating::findInitialRatingByRoot(glicko::Opponents opponents, glicko::Results results)
+{
+    // The rating is self-consistent, if processing the games does not change it. Look for a
+    // change of sign from the highest start value downwards.
+    std::vector<double> elos(glicko::initialRatingBracketPoints);
+    for (uint32_t i = 0; i < elos.size(); i++)
     {
-        Rating rating(currentElo, glicko::initialDeviation, glicko::initialVolatility);
-        rating.updateWithNoWin(opponents, results, false);
-        rating.apply();
+        elos[i] = glicko::maxInitialRating - i * (glicko::maxInitialRating - glicko::minInitialRating) / (elos.size() - 1);
+    }
 
-        if (abs(currentElo - rating.elo()) < bestDiff)
+    std::vector<double> resultingElos = tryInitialRatings(elos, opponents, results);
+
+    size_t best = 0;
+    for (size_t i = 0; i < elos.size(); i++)
+    {
+        double change = resultingElos[i] - elos[i];
+        if (std::abs(change) < std::abs(resultingElos[best] - elos[best]))
         {
-            bestDiff = abs(currentElo - rating.elo());
-            improvedElo = rating.elo();
+            best = i;
         }
 
-        currentElo -= 10.0;
+        if (i > 0 && (change > 0.0) != (resultingElos[i - 1] - elos[i - 1] > 0.0))
+        {
+            auto f = [&](double elo)
+            {
+                return tryInitialRating(elo, opponents, results) - elo;
+            };
+
+            uint32_t iterations = 0;
+            bool converged = false;
+            double root = findRootBrent(f, elos[i - 1], elos[i], resultingElos[i - 1] - elos[i - 1], change,
+                                        glicko::initialRatingConvergence, glicko::maxInitialRatingIterations, iterations, converged);
+
+            if (converged)
+            {
+                return tryInitialRating(root, opponents, results);
+            }
+        }
     }
 
-    currentElo = improvedElo + 5.0;
-    destinationElo = improvedElo - 5.0;
+    // No root in range. Take the start value changing the least, just like the grid.
+    return resultingElos[best];
+}
 
-    while (currentElo > destinationElo)
+/*!
+ */
+std::vector<double> Rating::tryInitialRatings(std::span<const double> elos, glicko::Opponents opponents, glicko::Results results)
+{
+    std::vector<double> resultingElos(elos.size());
+
+    for (size_t i = 0; i < elos.size(); i++)
     {
-        Rating rating(currentElo, glicko::initialDeviation, glicko::initialVolatility);
-        rating.updateWithNoWin(opponents, results, false);
-        rating.apply();
+        resultingElos[i] = tryInitialRating(elos[i], opponents, results);
+    }
 
-        if (abs(currentElo - rating.elo()) < bestDiff)
-        {
-            bestDiff = abs(currentElo - rating.elo());
-            improvedElo = rating.elo();
-        }
+    return resultingElos;
+}
 
-        currentElo -= 1.0;
-    }
+/*!
+ */
+double Rating::tryInitialRating(double elo, glicko::Opponents opponents, glicko::Results results)
+{
+    Rating rating(elo, glicko::initialDeviation, EngineParameters::current().initialVolatility);
+    rating.updateWithNoWin(opponents, results, false);
+    rating.apply();
 
-    return improvedElo;
+    glicko::solverStatistics().initialRatingTrials++;
+
+    return rating.elo();
 }
 
 /*!
  */
-bool Rating::hasWinsAndLossesInResults(const std::vector<double> &results) const
+bool Rating::hasWinsAndLossesInResults(glicko::Results results) const
 {
     // No rating yet. Make sure pending games contains wins and losses.
     bool hasWins = false;
@@ -462,3 +640,170 @@ bool Rating::hasWinsAndLossesInResults(const std::vector<double> &results) const
 
     return (hasWins && hasLosses);
 }
+
+/*!
+ */
+void Rating::writeState(BinaryWriter &writer) const
+{
+    writer.write(_rating);
+    writer.write(_deviation);
+    writer.write(_volatility);
+    writer.write(_pendingRating);
+    writer.write(_pendingDeviation);
+    writer.write(_pendingVolatility);
+    writer.write(_totalGames);
+    writer.write(_calculationType);
+    writer.write(_pendingGames);
+}
+
+/*!
+ */
+void Rating::readState(BinaryReader &reader)
+{
+    reader.read(_rating);
+    reader.read(_deviation);
+    reader.read(_volatility);
+    reader.read(_pendingRating);
+    reader.read(_pendingDeviation);
+    reader.read(_pendingVolatility);
+    reader.read(_totalGames);
+    reader.read(_calculationType);
+    reader.read(_pendingGames);
+}
+
+namespace
+{
+
+//! Solver used for all ratings.
+std::atomic<glicko::VolatilitySolver> currentVolatilitySolver = glicko::VolatilitySolver::Illinois;
+
+//! Initial rating search used for all ratings.
+std::atomic<glicko::InitialRatingSearch> currentInitialRatingSearch = glicko::InitialRatingSearch::Grid;
+
+}
+
+/*!
+ */
+void glicko::setInitialRatingSearch(InitialRatingSearch search)
+{
+    currentInitialRatingSearch = search;
+}
+
+/*!
+ */
+glicko::InitialRatingSearch glicko::initialRatingSearch()
+{
+    return currentInitialRatingSearch;
+}
+
+/*!
+ */
+std::optional<glicko::InitialRatingSearch> glicko::toInitialRatingSearch(const std::string &name)
+{
+    if (name == "grid")
+    {
+        return InitialRatingSearch::Grid;
+    }
+    else if (name == "root")
+    {
+        return InitialRatingSearch::Root;
+    }
+
+    return std::nullopt;
+}
+
+/*!
+ */
+void glicko::setVolatilitySolver(VolatilitySolver solver)
+{
+    currentVolatilitySolver = solver;
+}
+
+/*!
+ */
+glicko::VolatilitySolver glicko::volatilitySolver()
+{
+    return currentVolatilitySolver;
+}
+
+/*!
+ */
+std::optional<glicko::VolatilitySolver> glicko::toVolatilitySolver(const std::string &name)
+{
+    if (name == "illinois")
+    {
+        return VolatilitySolver::Illinois;
+    }
+    else if (name == "brent")
+    {
+        return VolatilitySolver::Brent;
+    }
+
+    return std::nullopt;
+}
+
+/*!
+ */
+void glicko::SolverStatistics::add(uint32_t iterations, uint32_t relaxations, bool converged)
+{
+    calls++;
+    this->iterations += iterations;
+    this->relaxations += relaxations;
+    maxIterations = std::max(maxIterations, iterations);
+    unconverged += converged ? 0 : 1;
+}
+
+/*!
+ */
+void glicko::SolverStatistics::addPlayer(uint32_t userId, uint64_t iterations)
+{
+    if (iterations == 0 || (worstPlayers.size() == maxWorstPlayers && iterations <= worstPlayers.back().second))
+    {
+        return;
+    }
+
+    auto it = std::find_if(worstPlayers.begin(), worstPlayers.end(), [&](const auto &entry) { return entry.first == userId; });
+    if (it != worstPlayers.end())
+    {
+        if (it->second >= iterations)
+        {
+            return;
+        }
+        worstPlayers.erase(it);
+    }
+
+    auto position = std::find_if(worstPlayers.begin(), worstPlayers.end(), [&](const auto &entry) { return entry.second < iterations; });
+    worstPlayers.insert(position, { userId, iterations });
+
+    if (worstPlayers.size() > maxWorstPlayers)
+    {
+        worstPlayers.pop_back();
+    }
+}
+
+/*!
+ */
+void glicko::SolverStatistics::merge(const SolverStatistics &other)
+{
+    calls += other.calls;
+    iterations += other.iterations;
+    maxIterations = std::max(maxIterations, other.maxIterations);
+    relaxations += other.relaxations;
+    unconverged += other.unconverged;
+    initialRatingSearches += other.initialRatingSearches;
+    initialRatingTrials += other.initialRatingTrials;
+    initialRatingTime += other.initialRatingTime;
+
+    for (const auto &[userId, playerIterations] : other.worstPlayers)
+    {
+        addPlayer(userId, playerIterations);
+    }
+}
+
+/*!
+ */
+glicko::SolverStatistics& glicko::solverStatistics()
+{
+    thread_local SolverStatistics statistics;
+    return statistics;
+}
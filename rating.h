@@ -2,13 +2,21 @@
 #pragma once
 
 #include <array>
+#include <chrono>
 #include <cmath>
 #include <optional>
 #include <ostream>
+#include <span>
+#include <string>
 #include <vector>
 
 #include "faction.h"
 
+// Forward declarations:
+class BinaryReader;
+class BinaryWriter;
+class DecayTable;
+
 namespace glicko
 {
 
@@ -42,12 +50,120 @@ static const double convergence = 0.000001;
 
 //! Glicko-2 paper states, what reasonable choices are between 0.3 and 1.2 and the system
 //! should be tested to decide which value give the best accuracy in terms of prediction.
+//! This and the other defaults can be tried out with a sweep, see EngineParameters.
 static const double tau = 0.5;
 
 //! This is an extension to Glicko-2 to make it work with team games. The exponent factor
 //! is used to determine a players share of a win/loss in a 2v2 game. This
 //! value has been set after evaluation thousands of games.
 static const double exponentFactor2v2 = 1.11;
+
+//! Opponents of a rating period (rating, deviation and volatility). A view, so updates don't need
+//! a container of their own, neither for a single game nor for a whole day.
+using Opponents = std::span<const std::array<double, 3>>;
+
+//! Results of the games against the opponents (1 win, 0 loss).
+using Results = std::span<const double>;
+
+//! Root finding for the new volatility (step 5 of Glicko-2).
+enum class VolatilitySolver : int32_t
+{
+    //! Illinois algorithm as suggested by the paper. Relaxes the convergence every 100000 steps.
+    Illinois = 0,
+
+    //! Brent's method. Always keeps the root bracketed and stops after maxSolverIterations.
+    Brent = 1
+};
+
+//! Hard limit of iterations for the Brent solver. Bisection alone needs about 50 iterations.
+static const uint32_t maxSolverIterations = 200;
+
+//! Search for the initial rating of new players.
+enum class InitialRatingSearch : int32_t
+{
+    //! Grid from 3000 down to 100 in steps of 100, refined in steps of 10 and 1.
+    Grid = 0,
+
+    //! Look for a sign change of the rating change on a few points and find the root in between.
+    Root = 1
+};
+
+//! Lowest and highest start value of the initial rating search.
+static const double minInitialRating = 100.0;
+static const double maxInitialRating = 3000.0;
+
+//! Number of equally spaced start values used to bracket the root.
+static const uint32_t initialRatingBracketPoints = 5;
+
+//! Tolerance (elo) and limit of iterations for the root of the initial rating search.
+static const double initialRatingConvergence = 0.5;
+static const uint32_t maxInitialRatingIterations = 20;
+
+//! Select the initial rating search for all ratings. Meant to be called once before processing.
+extern void setInitialRatingSearch(InitialRatingSearch search);
+
+//! The initial rating search in use.
+extern InitialRatingSearch initialRatingSearch();
+
+//! Initial rating search by name (grid, root).
+extern std::optional<InitialRatingSearch> toInitialRatingSearch(const std::string &name);
+
+//! Select the volatility solver for all ratings. Meant to be called once before processing.
+extern void setVolatilitySolver(VolatilitySolver solver);
+
+//! The volatility solver in use.
+extern VolatilitySolver volatilitySolver();
+
+//! Solver by name (illinois, brent).
+extern std::optional<VolatilitySolver> toVolatilitySolver(const std::string &name);
+
+/*!
+ * Counters of the volatility solver. Kept per thread, each ladder is processed by its own thread.
+ */
+struct SolverStatistics
+{
+    //! Number of players kept in worstPlayers.
+    static const size_t maxWorstPlayers = 5;
+
+    //! Number of volatility computations.
+    uint64_t calls = 0;
+
+    //! Iterations of all computations.
+    uint64_t iterations = 0;
+
+    //! Iterations of the slowest computation.
+    uint32_t maxIterations = 0;
+
+    //! Number of times the Illinois solver had to relax the convergence.
+    uint64_t relaxations = 0;
+
+    //! Number of times the Brent solver hit the iteration limit.
+    uint64_t unconverged = 0;
+
+    //! Players (user id) needing the most iterations within a single update, most first.
+    std::vector<std::pair<uint32_t, uint64_t>> worstPlayers;
+
+    //! Number of initial rating searches.
+    uint64_t initialRatingSearches = 0;
+
+    //! Number of start values tried by all initial rating searches.
+    uint64_t initialRatingTrials = 0;
+
+    //! Time spent on initial rating searches.
+    std::chrono::nanoseconds initialRatingTime{0};
+
+    //! Add a single computation.
+    void add(uint32_t iterations, uint32_t relaxations, bool converged);
+
+    //! Add the iterations needed for a single update of a player.
+    void addPlayer(uint32_t userId, uint64_t iterations);
+
+    //! Add the counters of another thread.
+    void merge(const SolverStatistics &other);
+};
+
+//! Statistics of the current thread.
+extern SolverStatistics& solverStatistics();
 }
 
 //! Rating based on the Glicko2 rating system.
@@ -87,6 +203,12 @@ public:
     void decay(bool wasActive, double factor, double maxDeviationAfterActive);
     void decay(bool wasActive, int factor, int maxDeviationAfterActive) = delete;
 
+    //! Decay for several days at once, looked up in the table of the game mode.
+    void decay(bool wasActive, int days, const DecayTable &table, double maxDeviationAfterActive);
+
+    //! Deviation (elo) after a single day of decay. Not clamped.
+    static double decayStep(double trueDeviation, double factor);
+
     //! Get the elo. Automatically performs the transformation of glicko2 to elo;
     double elo() const;
 
@@ -111,21 +233,42 @@ private:
     //! Computation of weight factor g.
     double g(double deviation) const;
 
+    //! Find a root of f within [a, b] using Brent's method. f(a) and f(b) must have different signs.
+    //! If the iteration limit has been hit, converged is false and the iterate with the smallest
+    //! |f| is returned.
+    template<typename F>
+    static double findRootBrent(F f, double a, double b, double fa, double fb, double convergence, uint32_t maxIterations,
+                                uint32_t &iterations, bool &converged);
+
     //! Find a decent initial rating for a very weak player. Glicko-2 seems to have some
     //! issues in this case.
-    std::optional<double> findInitialRatingImproved(const std::vector<std::array<double, 3>>& opponents, const std::vector<double>& results);
+    std::optional<double> findInitialRatingImproved(glicko::Opponents opponents, glicko::Results results);
+
+    //! Search of findInitialRatingImproved() on a coarse to fine grid (about 50 trials).
+    static double findInitialRatingOnGrid(glicko::Opponents opponents, glicko::Results results);
+
+    //! Search of findInitialRatingImproved() as root finding of the change of the rating (8 to 10 trials).
+    static double findInitialRatingByRoot(glicko::Opponents opponents, glicko::Results results);
+
+    //! Elo after processing all games game by game, starting with each of the given ratings.
+    static std::vector<double> tryInitialRatings(std::span<const double> elos, glicko::Opponents opponents, glicko::Results results);
+
+    //! Elo after processing all games game by game, starting with the given rating.
+    static double tryInitialRating(double elo, glicko::Opponents opponents, glicko::Results results);
 
 public:
-    double variance(const std::vector<std::array<double, 3>>& opponents);
-    double delta(const std::vector<std::array<double, 3>>& opponents, const std::vector<double> &results, double variance);
-    double volatility(const std::vector<std::array<double, 3>>& opponents, const std::vector<double> &results, double variance);
+    //! Step 5 of Glicko-2: the new volatility for the given delta and variance.
+    double volatility(double delta, double variance) const;
+
+    void updateWithNoWin(glicko::Opponents opponents, glicko::Results results, bool extendedLogging);
+    void updateWithFirstWin(glicko::Opponents opponents, glicko::Results results, bool useBest, bool extendedLogging);
+    void updateNormally(glicko::Opponents opponents, glicko::Results results);
+    CalculationType update(glicko::Opponents opponents, glicko::Results results, CalculationType calculationType = CalculationType::AutoSelect);
 
-    void updateWithNoWin(const std::vector<std::array<double, 3>>& opponents, const std::vector<double>& results, bool extendedLogging);
-    void updateWithFirstWin(const std::vector<std::array<double, 3>>& opponents, const std::vector<double>& results, bool useBest, bool extendedLogging);
-    void updateNormally(const std::vector<std::array<double, 3>>& opponents, const std::vector<double>& results);
-    CalculationType update(const std::vector<std::array<double, 3>>& opponents, const std::vector<double>& results, CalculationType calculationType = CalculationType::AutoSelect);
+    //! Same as above for a single game.
+    CalculationType update(const std::array<double, 3> &opponent, double result, CalculationType calculationType = CalculationType::AutoSelect);
 
-    bool hasWinsAndLossesInResults(const std::vector<double> &results) const;
+    bool hasWinsAndLossesInResults(glicko::Results results) const;
 
     CalculationType currentCalculationType() const { return _calculationType; }
 
@@ -133,6 +276,12 @@ public:
     std::array<double, 3> toArray() const;
     std::array<double, 3> toEloArray() const;
 
+    //! Write the rating to a checkpoint.
+    void writeState(BinaryWriter &writer) const;
+
+    //! Read the rating from a checkpoint.
+    void readState(BinaryReader &reader);
+
     //! Mu, the actual rating.
     double _rating;
 
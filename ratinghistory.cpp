@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cmath>
+
+#include "binarystream.h"
+#include "ratinghistory.h"
+
+/*!
+ */
+void RatingHistory::add(std::chrono::sys_days day, const Values &values)
+{
+    if (_dayRuns.empty())
+    {
+        _firstDay = day;
+    }
+
+    uint16_t offset = static_cast<uint16_t>((day - _firstDay).count());
+
+    if (!_dayRuns.empty() && _dayRuns.back().first + _dayRuns.back().second == offset)
+    {
+        _dayRuns.back().second++;
+    }
+    else
+    {
+        _dayRuns.emplace_back(offset, 1);
+    }
+
+    bool active = false;
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        Change change;
+        change.day = offset;
+        change.deviation = static_cast<uint16_t>(std::clamp(std::lround(values[i].second * 100.0), 0L, 65535L));
+        change.rating = static_cast<int32_t>(std::lround(values[i].first * 100.0));
+
+        std::vector<Change> &changes = _changes[i];
+        if (changes.empty() || changes.back().rating != change.rating || changes.back().deviation != change.deviation)
+        {
+            changes.push_back(change);
+        }
+
+        active = active || values[i].first > 0.0;
+    }
+
+    if (active)
+    {
+        _daysActive++;
+        _daysInactive = 0;
+    }
+    else
+    {
+        _daysInactive++;
+    }
+}
+
+/*!
+ */
+bool RatingHistory::empty() const
+{
+    return _dayRuns.empty();
+}
+
+/*!
+ */
+int RatingHistory::daysActive() const
+{
+    return _daysActive;
+}
+
+/*!
+ */
+int RatingHistory::daysInactive() const
+{
+    return _daysInactive;
+}
+
+/*!
+ */
+std::pair<double, double> RatingHistory::at(factions::Faction faction, std::chrono::sys_days day) const
+{
+    const std::vector<Change> &changes = _changes[faction];
+    if (changes.empty() || day < _firstDay)
+    {
+        return { -1.0, 0.0 };
+    }
+
+    int64_t offset = (day - _firstDay).count();
+    auto it = std::upper_bound(changes.begin(), changes.end(), offset, [](int64_t value, const Change &change) {
+        return value < change.day;
+    });
+
+    --it;
+    return { it->rating / 100.0, it->deviation / 100.0 };
+}
+
+/*!
+ */
+void RatingHistory::forEachDay(factions::Faction faction, const std::function<void(std::chrono::sys_days, double, double)> &function) const
+{
+    const std::vector<Change> &changes = _changes[faction];
+    size_t index = 0;
+
+    for (const auto &[first, count] : _dayRuns)
+    {
+        for (uint32_t offset = first; offset < static_cast<uint32_t>(first) + count; offset++)
+        {
+            while (index + 1 < changes.size() && changes[index + 1].day <= offset)
+            {
+                index++;
+            }
+
+            function(_firstDay + std::chrono::days{offset}, changes[index].rating / 100.0, changes[index].deviation / 100.0);
+        }
+    }
+}
+
+/*!
+ */
+void RatingHistory::writeState(BinaryWriter &writer) const
+{
+    writer.write(_firstDay);
+    writer.write(_dayRuns);
+    writer.write(_changes);
+    writer.write(_daysActive);
+    writer.write(_daysInactive);
+}
+
+/*!
+ */
+void RatingHistory::readState(BinaryReader &reader)
+{
+    reader.read(_firstDay);
+    reader.read(_dayRuns);
+    reader.read(_changes);
+    reader.read(_daysActive);
+    reader.read(_daysInactive);
+}
+
+/*!
+ */
+void RatingHistory::Change::writeState(BinaryWriter &writer) const
+{
+    writer.write(day);
+    writer.write(deviation);
+    writer.write(rating);
+}
+
+/*!
+ */
+void RatingHistory::Change::readState(BinaryReader &reader)
+{
+    reader.read(day);
+    reader.read(deviation);
+    reader.read(rating);
+}
@@ -0,0 +1,85 @@
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "faction.h"
+
+// Forward declarations:
+class BinaryReader;
+class BinaryWriter;
+
+/*!
+ * Rating and deviation of each faction of a player for each rating day. Only changes are
+ * stored, so the long inactive stretches of most players take almost no memory. Days are
+ * stored as offset to the first day (up to 65535 days), values are rounded to 0.01.
+ */
+class RatingHistory
+{
+public:
+    //! Rating and deviation of each faction on a single day. The rating of inactive factions is -1.
+    using Values = std::array<std::pair<double, double>, factions::count()>;
+
+    //! Add the values of a day. Days have to be added in ascending order.
+    void add(std::chrono::sys_days day, const Values &values);
+
+    //! Check if no day has been added yet.
+    bool empty() const;
+
+    //! Number of days with at least one active faction.
+    int daysActive() const;
+
+    //! Number of days since the last day with an active faction (all days if there is none).
+    int daysInactive() const;
+
+    //! Rating and deviation of the faction as of the given day, i.e. the values of the last day
+    //! added up to this day. The rating is -1 before the first day.
+    std::pair<double, double> at(factions::Faction faction, std::chrono::sys_days day) const;
+
+    //! Call the function with rating and deviation of the faction for each day added.
+    void forEachDay(factions::Faction faction, const std::function<void(std::chrono::sys_days, double, double)> &function) const;
+
+    //! Write the state into a binary buffer.
+    void writeState(BinaryWriter &writer) const;
+
+    //! Read the state written by writeState().
+    void readState(BinaryReader &reader);
+
+private:
+    //! Values of a faction from a day on.
+    struct Change
+    {
+        //! Offset to the first day.
+        uint16_t day;
+
+        //! Deviation in units of 0.01.
+        uint16_t deviation;
+
+        //! Rating in units of 0.01.
+        int32_t rating;
+
+        void writeState(BinaryWriter &writer) const;
+        void readState(BinaryReader &reader);
+    };
+
+    //! The first day added.
+    std::chrono::sys_days _firstDay{};
+
+    //! Consecutive days added. Offset of the first day and number of days.
+    std::vector<std::pair<uint16_t, uint16_t>> _dayRuns;
+
+    //! Changes of each faction. The first change is at offset 0.
+    std::array<std::vector<Change>, factions::count()> _changes;
+
+    //! Number of days with at least one active faction.
+    int _daysActive = 0;
+
+    //! Number of days since the last day with an active faction.
+    int _daysInactive = 0;
+
+}; // class RatingHistory
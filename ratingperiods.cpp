@@ -0,0 +1,63 @@
+#include <algorithm>
+
+#include "logging.h"
+#include "ratingperiods.h"
+#include "stringtools.h"
+
+/*!
+ */
+RatingPeriods::RatingPeriods(std::span<Game* const> games, int timeShiftInHours) :
+    _games(games)
+{
+    size_t first = 0;
+    while (first < games.size())
+    {
+        std::chrono::sys_days day = games[first]->ratingDate(timeShiftInHours);
+
+        size_t last = first + 1;
+        while (last < games.size() && games[last]->ratingDate(timeShiftInHours) == day)
+        {
+            last++;
+        }
+
+        if (!_periods.empty() && _periods.back().day >= day)
+        {
+            Log::error() << "Games are not sorted. Rating period " << stringtools::fromDate(day) << " follows "
+                         << stringtools::fromDate(_periods.back().day) << ".";
+        }
+
+        _periods.push_back({ day, games.subspan(first, last - first) });
+        first = last;
+    }
+}
+
+/*!
+ */
+size_t RatingPeriods::size() const
+{
+    return _periods.size();
+}
+
+/*!
+ */
+const RatingDay& RatingPeriods::operator[](size_t index) const
+{
+    return _periods[index];
+}
+
+/*!
+ */
+size_t RatingPeriods::firstAfter(std::chrono::sys_days day) const
+{
+    auto it = std::upper_bound(_periods.begin(), _periods.end(), day, [](std::chrono::sys_days value, const RatingDay &period) {
+        return value < period.day;
+    });
+    return static_cast<size_t>(it - _periods.begin());
+}
+
+/*!
+ */
+size_t RatingPeriods::gamesBefore(size_t index) const
+{
+    return (index < _periods.size()) ? static_cast<size_t>(_periods[index].games.data() - _games.data()) : _games.size();
+}
@@ -0,0 +1,54 @@
+
+
+#pragma once
+
+#include <chrono>
+#include <span>
+#include <vector>
+
+#include "game.h"
+
+//! All games of a single rating period (one day).
+struct RatingDay
+{
+    //! The day of the rating period.
+    std::chrono::sys_days day;
+
+    //! The games of the day, ordered by the end of the game.
+    std::span<Game* const> games;
+};
+
+/*!
+ * Games grouped by rating period. The rating day of each game (the day the game ended, after
+ * applying the time shift) is computed only once, so processing the games day by day does
+ * not need any date arithmetic.
+ */
+class RatingPeriods
+{
+public:
+    //! Constructor. The games have to be sorted by the end of the game and must outlive the periods.
+    RatingPeriods(std::span<Game* const> games, int timeShiftInHours);
+
+    //! Number of rating periods.
+    size_t size() const;
+
+    //! Get the rating period with the given index.
+    const RatingDay& operator[](size_t index) const;
+
+    //! Index of the first rating period after the given day. size() if there is none.
+    size_t firstAfter(std::chrono::sys_days day) const;
+
+    //! Number of games in all rating periods before the given index.
+    size_t gamesBefore(size_t index) const;
+
+    std::vector<RatingDay>::const_iterator begin() const { return _periods.begin(); }
+    std::vector<RatingDay>::const_iterator end() const { return _periods.end(); }
+
+private:
+    //! All games.
+    std::span<Game* const> _games;
+
+    //! All rating periods in chronological order.
+    std::vector<RatingDay> _periods;
+
+}; // class RatingPeriods
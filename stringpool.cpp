@@ -0,0 +1,87 @@
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include "logging.h"
+#include "stringpool.h"
+
+namespace
+{
+
+//! Strings are stored in blocks, which are never moved or freed. That's why reading does not
+//! need a lock.
+const size_t blockSize = 4096;
+const size_t maxBlocks = 4096;
+
+struct Pool
+{
+    Pool()
+    {
+        blocks[0] = std::make_unique<std::string[]>(blockSize);
+        ids.emplace(std::string_view(blocks[0][0]), 0);
+        count = 1;
+    }
+
+    //! Guards adding strings.
+    std::mutex mutex;
+
+    //! Id of each string. The keys point into the blocks.
+    std::unordered_map<std::string_view, uint32_t> ids;
+
+    //! The strings.
+    std::array<std::unique_ptr<std::string[]>, maxBlocks> blocks;
+
+    //! Number of strings.
+    uint32_t count = 0;
+};
+
+Pool& pool()
+{
+    static Pool instance;
+    return instance;
+}
+
+}
+
+/*!
+ */
+uint32_t stringpool::intern(const std::string &value)
+{
+    Pool &p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    auto it = p.ids.find(std::string_view(value));
+    if (it != p.ids.end())
+    {
+        return it->second;
+    }
+
+    uint32_t id = p.count;
+    if (id / blockSize >= maxBlocks)
+    {
+        Log::fatal() << "String pool is full.";
+        return 0;
+    }
+
+    std::unique_ptr<std::string[]> &block = p.blocks[id / blockSize];
+    if (!block)
+    {
+        block = std::make_unique<std::string[]>(blockSize);
+    }
+
+    std::string &stored = block[id % blockSize];
+    stored = value;
+    p.ids.emplace(std::string_view(stored), id);
+    p.count++;
+
+    return id;
+}
+
+/*!
+ */
+const std::string& stringpool::get(uint32_t id)
+{
+    return pool().blocks[id / blockSize][id % blockSize];
+}
@@ -0,0 +1,22 @@
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*!
+ * Process-wide table of interned strings. Map names, ladder abbreviations and player names
+ * are repeated in countless games, games only keep the id of each string. The empty string
+ * has id 0.
+ */
+namespace stringpool
+{
+
+//! Get the id of the given string. Adds the string if needed. Thread-safe.
+extern uint32_t intern(const std::string &value);
+
+//! Get the string with the given id. Strings never move, so the reference stays valid.
+//! Thread-safe for all ids returned by intern() before.
+extern const std::string& get(uint32_t id);
+
+} // namespace stringpool
@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+
+#include <nlohmann/json.hpp>
+
+#include "game.h"
+#include "logging.h"
+#include "players.h"
+#include "ratingperiods.h"
+#include "sweep.h"
+
+/*!
+ */
+std::vector<EngineParameters> Sweep::loadGrid(const std::filesystem::path &file, gamemodes::GameMode gameMode)
+{
+    using json = nlohmann::json;
+
+    std::ifstream stream(file);
+    if (!stream)
+    {
+        Log::error() << "Unable to open parameter grid '" << file.string() << "'.";
+        return {};
+    }
+
+    json data;
+    try
+    {
+        data = json::parse(stream);
+    }
+    catch (const json::exception &e)
+    {
+        Log::error() << "Unable to parse parameter grid '" << file.string() << "': " << e.what();
+        return {};
+    }
+
+    if (!data.is_object())
+    {
+        Log::error() << "Parameter grid '" << file.string() << "' needs to be an object with a list of values for each parameter.";
+        return {};
+    }
+
+    std::vector<EngineParameters> grid = { EngineParameters::defaults(gameMode) };
+
+    for (const auto &[name, values] : data.items())
+    {
+        if (!values.is_array() || values.empty() || !std::all_of(values.begin(), values.end(), [](const json &value) { return value.is_number(); }))
+        {
+            Log::error() << "Parameter '" << name << "' needs a list of numbers.";
+            return {};
+        }
+
+        // Each value of this parameter for all combinations so far.
+        std::vector<EngineParameters> combinations;
+        for (const EngineParameters &parameters : grid)
+        {
+            for (const json &value : values)
+            {
+                EngineParameters combination = parameters;
+                if (!combination.set(name, value.get<double>()))
+                {
+                    Log::error() << "Unknown parameter '" << name << "'.";
+                    return {};
+                }
+                combinations.push_back(combination);
+            }
+        }
+
+        grid = std::move(combinations);
+    }
+
+    return grid;
+}
+
+/*!
+ */
+Sweep::Sweep(const Players &players, std::span<Game* const> games, int timeShiftInHours,
+             std::chrono::sys_days endDate, gamemodes::GameMode gameMode) :
+    _players(players),
+    _games(games),
+    _timeShiftInHours(timeShiftInHours),
+    _endDate(endDate),
+    _gameMode(gameMode)
+{
+}
+
+/*!
+ */
+std::vector<Sweep::Result> Sweep::run(const std::vector<EngineParameters> &grid, uint32_t threads) const
+{
+    std::vector<Result> results(grid.size());
+    std::atomic<size_t> next = 0;
+
+    auto work = [&]() {
+        // The parameters and statistics of the calling thread are kept aside, it works as well.
+        std::optional<EngineParameters> threadParameters = EngineParameters::threadParameters();
+        glicko::SolverStatistics threadStatistics = glicko::solverStatistics();
+        Log::setMuted(true);
+
+        for (size_t index = next++; index < grid.size(); index = next++)
+        {
+            EngineParameters::threadParameters() = grid[index];
+            results[index] = { grid[index], replay() };
+        }
+
+        Log::setMuted(false);
+        glicko::solverStatistics() = threadStatistics;
+        EngineParameters::threadParameters() = threadParameters;
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        for (uint32_t i = 1; i < std::min<size_t>(threads, grid.size()); i++)
+        {
+            workers.emplace_back(work);
+        }
+
+        work();
+    }
+
+    return results;
+}
+
+/*!
+ */
+PredictionScore Sweep::replay() const
+{
+    // Copies, because ratings are set to the games and the players change.
+    Players players = _players;
+    players.setThreadPool(nullptr);
+
+    double initialVolatility = EngineParameters::current(_gameMode).initialVolatility;
+    for (uint32_t userId : players.userIds())
+    {
+        players[userId].setInitialVolatility(initialVolatility);
+    }
+
+    std::vector<Game> games;
+    games.reserve(_games.size());
+    std::vector<Game*> validGames;
+    validGames.reserve(_games.size());
+    for (const Game *game : _games)
+    {
+        games.push_back(*game);
+    }
+    for (Game &game : games)
+    {
+        validGames.push_back(&game);
+    }
+
+    // Same order of updates as Run 3, without the statistics.
+    PredictionScore score;
+    std::chrono::sys_days previousGameDate{};
+    std::chrono::sys_days uninitializedDate{};
+
+    for (const RatingDay &period : RatingPeriods(validGames, _timeShiftInHours))
+    {
+        if (period.day >= _endDate)
+        {
+            break;
+        }
+
+        for (Game *game : period.games)
+        {
+            if (previousGameDate != uninitializedDate && period.day != previousGameDate)
+            {
+                players.update();
+                players.apply(previousGameDate, true, _gameMode);
+
+                int64_t dayDifference = (period.day - previousGameDate).count();
+                if (dayDifference > 3)
+                {
+                    players.decay(dayDifference - 3, _gameMode);
+                }
+
+                previousGameDate = period.day;
+            }
+
+            // Scored with the ratings at the start of the day, which include the previous day, like
+            // --prediction-report does.
+            for (uint32_t j = 0; j < game->playerCount(); j++)
+            {
+                const Player &player = players.participant(*game, j);
+                game->setRatingAndDeviation(j, player.elo(game->faction(j)), player.deviation(game->faction(j)));
+            }
+
+            score.add(PredictionScore::expectedResult(*game), PredictionScore::actualResult(*game));
+
+            for (uint32_t j = 0; j < game->playerCount(); j++)
+            {
+                players.participant(*game, j).processGame(*game, j, false, players);
+            }
+        }
+
+        previousGameDate = period.day;
+    }
+
+    return score;
+}
+
+/*!
+ */
+void Sweep::exportResults(const std::filesystem::path &directory, const std::vector<Result> &results)
+{
+    using json = nlohmann::json;
+
+    if (results.empty())
+    {
+        return;
+    }
+
+    std::vector<const Result*> sorted;
+    for (const Result &result : results)
+    {
+        sorted.push_back(&result);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Result *a, const Result *b) {
+        return a->score.meanLogLoss() < b->score.meanLogLoss();
+    });
+
+    json data = json::object();
+    data["description"] = "Prediction quality of each parameter set, best log-loss first";
+    data["data"] = json::array();
+
+    for (const Result *result : sorted)
+    {
+        json parameters = json::object();
+        for (const auto &[name, field] : EngineParameters::fields())
+        {
+            parameters[name] = result->parameters.*field;
+        }
+
+        json jsonResult = json::object();
+        jsonResult["parameters"] = parameters;
+        jsonResult["games"] = result->score.games;
+        jsonResult["log_loss"] = result->score.meanLogLoss();
+        jsonResult["brier"] = result->score.meanBrier();
+        data["data"].push_back(jsonResult);
+    }
+
+    gamemodes::GameMode gameMode = results.front().parameters.gameMode;
+    std::ofstream stream(directory / (gamemodes::shortName(gameMode) + "_sweep.json"));
+    stream << std::setw(4) << data << std::endl;
+    stream.close();
+}
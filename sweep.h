@@ -0,0 +1,68 @@
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "engineparameters.h"
+#include "predictionscore.h"
+
+// Forward declarations:
+class Game;
+class Players;
+
+/*!
+ * Replays all games with several sets of engine parameters and scores the predicted results.
+ * Games are loaded and filtered once, each parameter set gets a copy of the players and the
+ * games. Parameter sets are replayed in parallel, each one on a single thread.
+ */
+class Sweep
+{
+public:
+    //! Result of a single parameter set.
+    struct Result
+    {
+        EngineParameters parameters;
+        PredictionScore score;
+    };
+
+    //! Read the parameter sets from a JSON file. The file contains an object with a list of
+    //! values for each parameter to vary, e.g. {"tau": [0.3, 0.5], "decayFactor": [3.0, 3.5]}.
+    //! All combinations are tried, parameters not given keep the defaults of the game mode.
+    //! Returns an empty list on errors.
+    static std::vector<EngineParameters> loadGrid(const std::filesystem::path &file, gamemodes::GameMode gameMode);
+
+    //! Constructor. The games have to be sorted by the end of the game. Players and games must
+    //! outlive the sweep.
+    Sweep(const Players &players, std::span<Game* const> games, int timeShiftInHours,
+          std::chrono::sys_days endDate, gamemodes::GameMode gameMode);
+
+    //! Replay the games for each parameter set with the given number of threads. Results are in
+    //! the order of the parameter sets and don't depend on the number of threads.
+    std::vector<Result> run(const std::vector<EngineParameters> &grid, uint32_t threads) const;
+
+    //! Write the results ordered by log-loss to <game mode>_sweep.json in the given directory.
+    static void exportResults(const std::filesystem::path &directory, const std::vector<Result> &results);
+
+private:
+    //! Replay all games with the parameters of the calling thread, just like Run 3 does.
+    PredictionScore replay() const;
+
+    //! The players after loading, which are copied for each parameter set.
+    const Players &_players;
+
+    //! All valid games.
+    std::span<Game* const> _games;
+
+    //! Time shift for the rating day of each game.
+    int _timeShiftInHours;
+
+    //! Games on or after this day are not processed.
+    std::chrono::sys_days _endDate;
+
+    //! Game mode of the ladder.
+    gamemodes::GameMode _gameMode;
+
+}; // class Sweep
@@ -0,0 +1,102 @@
+#include <algorithm>
+
+#include "threadpool.h"
+
+/*!
+ */
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    for (uint32_t i = 1; i < threadCount; i++)
+    {
+        _threads.emplace_back([this]() { work(); });
+    }
+}
+
+/*!
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+
+    _jobAdded.notify_all();
+    _threads.clear();
+}
+
+/*!
+ */
+uint32_t ThreadPool::threadCount() const
+{
+    return static_cast<uint32_t>(_threads.size() + 1);
+}
+
+/*!
+ */
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    Job job;
+    job.task = &task;
+    job.count = count;
+
+    if (!_threads.empty() && count > 1)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _jobs.push_back(&job);
+        }
+        _jobAdded.notify_all();
+    }
+
+    runTasks(job);
+
+    // All indices are taken. Wait for the threads still working on the job.
+    std::unique_lock<std::mutex> lock(_mutex);
+    std::erase(_jobs, &job);
+    _jobLeft.wait(lock, [&job]() { return job.workers == 0; });
+}
+
+/*!
+ */
+void ThreadPool::work()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (true)
+    {
+        _jobAdded.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+
+        if (_stop)
+        {
+            return;
+        }
+
+        Job *job = _jobs.front();
+        job->workers++;
+
+        lock.unlock();
+        runTasks(*job);
+        lock.lock();
+
+        // Nothing left to take.
+        std::erase(_jobs, job);
+        job->workers--;
+        _jobLeft.notify_all();
+    }
+}
+
+/*!
+ */
+void ThreadPool::runTasks(Job &job)
+{
+    for (size_t index = job.next++; index < job.count; index = job.next++)
+    {
+        (*job.task)(index);
+    }
+}
@@ -0,0 +1,71 @@
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * A fixed number of threads working on index ranges. Threads take the next index as soon as
+ * they are done with the previous one, so long tasks don't hold up the others. Several threads
+ * may use the pool at once (one per ladder), each parallelFor() is a job of its own.
+ */
+class ThreadPool
+{
+public:
+    //! Constructor. The thread count includes the calling thread, which works as well.
+    explicit ThreadPool(uint32_t threadCount);
+
+    //! Destructor. Waits for all threads.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //! Number of threads including the calling thread.
+    uint32_t threadCount() const;
+
+    //! Call the task for each index in [0, count) and wait for all of them. The order is not
+    //! defined, so tasks must not depend on each other.
+    void parallelFor(size_t count, const std::function<void(size_t)> &task);
+
+private:
+    //! A single call of parallelFor().
+    struct Job
+    {
+        const std::function<void(size_t)> *task = nullptr;
+        size_t count = 0;
+        std::atomic<size_t> next = 0;
+        uint32_t workers = 0;
+    };
+
+    //! Main loop of each thread.
+    void work();
+
+    //! Run tasks of the job until all indices are taken.
+    static void runTasks(Job &job);
+
+    //! Protects the queue and the worker counts of the jobs.
+    std::mutex _mutex;
+
+    //! Signals new jobs.
+    std::condition_variable _jobAdded;
+
+    //! Signals a thread leaving a job.
+    std::condition_variable _jobLeft;
+
+    //! Jobs with indices left.
+    std::deque<Job*> _jobs;
+
+    //! Set when destroying the pool.
+    bool _stop = false;
+
+    //! The threads besides the calling one.
+    std::vector<std::jthread> _threads;
+
+}; // class ThreadPool
@@ -0,0 +1,107 @@
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "binarystream.h"
+
+/*!
+ * The first K values in the order given by the comparator, like a std::multiset which drops
+ * its last element as soon as there are more than K. Values are kept in place, so adding does
+ * not allocate. Values which would end up behind the last one of a full list are rejected by
+ * a single comparison. Equal values keep the order they have been added in.
+ */
+template<typename T, size_t K, typename Compare = std::less<T>>
+class TopK
+{
+public:
+    using const_iterator = typename std::array<T, K>::const_iterator;
+
+    //! Add a value. Returns false if it has been rejected.
+    bool add(const T &value)
+    {
+        if (_size == K && !_compare(value, _values[K - 1]))
+        {
+            return false;
+        }
+
+        auto position = std::upper_bound(_values.begin(), _values.begin() + _size, value, _compare);
+        if (_size < K)
+        {
+            _size++;
+        }
+
+        std::move_backward(position, _values.begin() + _size - 1, _values.begin() + _size);
+        *position = value;
+        return true;
+    }
+
+    //! Remove all values the predicate is true for. The order of the others is kept.
+    template<typename Predicate>
+    void eraseIf(Predicate predicate)
+    {
+        _size = static_cast<size_t>(std::remove_if(_values.begin(), _values.begin() + _size, predicate) - _values.begin());
+    }
+
+    //! Number of values.
+    size_t size() const
+    {
+        return _size;
+    }
+
+    //! Check if there are no values.
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    const_iterator begin() const
+    {
+        return _values.begin();
+    }
+
+    const_iterator end() const
+    {
+        return _values.begin() + _size;
+    }
+
+    //! Write the values to a checkpoint.
+    void writeState(BinaryWriter &writer) const
+    {
+        writer.write(static_cast<uint64_t>(_size));
+        for (size_t i = 0; i < _size; i++)
+        {
+            writer.write(_values[i]);
+        }
+    }
+
+    //! Read the values from a checkpoint.
+    void readState(BinaryReader &reader)
+    {
+        uint64_t size = 0;
+        reader.read(size);
+
+        _size = 0;
+        for (uint64_t i = 0; i < size && reader.ok(); i++)
+        {
+            T value;
+            reader.read(value);
+            add(value);
+        }
+    }
+
+private:
+    //! The values, the first _size ones are used.
+    std::array<T, K> _values{};
+
+    //! Number of values.
+    size_t _size = 0;
+
+    //! Order of the values.
+    [[no_unique_address]] Compare _compare;
+
+}; // class TopK